@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2020 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <QCoreApplication>
+#include "de_web_plugin.h"
+#include "de_web_plugin_private.h"
+
+#define SIM_TIMER_INTERVAL 10 // ms
+#define APS_REPLAY_MAX_BATCH 20 // records per event loop iteration
+
+#ifdef DECONZ_SIMULATION
+/*! Fills \p ind with a ZCL attribute report as if received from \p addr.
+    \param value - attribute value in little endian byte order
+ */
+static void simulatedReport(deCONZ::ApsDataIndication &ind, const deCONZ::Address &addr, quint8 endpoint,
+                            quint16 clusterId, quint16 attrId, quint8 dataType, const QByteArray &value, quint8 zclSeq)
+{
+    ind.setSrcAddressMode(deCONZ::ApsExtAddress);
+    ind.srcAddress() = addr;
+    ind.setSrcEndpoint(endpoint);
+    ind.setDstAddressMode(deCONZ::ApsNwkAddress);
+    ind.dstAddress().setNwk(0x0000);
+    ind.setDstEndpoint(0x01);
+    ind.setProfileId(HA_PROFILE_ID);
+    ind.setClusterId(clusterId);
+
+    deCONZ::ZclFrame zclFrame;
+    zclFrame.setSequenceNumber(zclSeq);
+    zclFrame.setCommandId(deCONZ::ZclReportAttributesId);
+    zclFrame.setFrameControl(deCONZ::ZclFCProfileCommand |
+                             deCONZ::ZclFCDirectionServerToClient |
+                             deCONZ::ZclFCDisableDefaultResponse);
+
+    { // payload
+        QDataStream stream(&zclFrame.payload(), QIODevice::WriteOnly);
+        stream.setByteOrder(QDataStream::LittleEndian);
+        stream << attrId;
+        stream << dataType;
+        stream.writeRawData(value.constData(), value.size());
+    }
+
+    QByteArray asdu;
+    { // ZCL frame
+        QDataStream stream(&asdu, QIODevice::WriteOnly);
+        stream.setByteOrder(QDataStream::LittleEndian);
+        zclFrame.writeToStream(stream);
+    }
+    ind.setAsdu(asdu);
+}
+
+/*! Returns \p n bytes of \p value in little endian byte order.
+ */
+static QByteArray simulatedValue(quint32 value, int n)
+{
+    QByteArray arr;
+    for (int i = 0; i < n; i++)
+    {
+        arr.append(char((value >> (i * 8)) & 0xff));
+    }
+    return arr;
+}
+
+/*! Inits the simulated traffic generator.
+    Started with --sim-report-rate=<n> the plugin feeds n attribute reports per second
+    of the known lights and sensors into apsdeDataIndication() as if they were received
+    from the network. This exercises the indication, event, rule and websocket paths
+    without radio traffic, the results are visible in the /metrics API.
+    Reports are only generated while the gateway isn't connected to the network,
+    so that default responses, polls or rule actions can't reach the real devices.
+    Only available in debug builds with DECONZ_SIMULATION.
+    Note: this runs inside deCONZ with the real ApsController, it is no standalone
+    benchmark. Confirms and ZDP responses aren't simulated.
+ */
+void DeRestPluginPrivate::initSimulation()
+{
+    simulationRate = deCONZ::appArgumentNumeric("--sim-report-rate", 0);
+    simulationIter = 0;
+    simulationBudget = 0;
+
+    simulationTimer = new QTimer(this);
+    simulationTimer->setSingleShot(false);
+    connect(simulationTimer, SIGNAL(timeout()), this, SLOT(simulationTimerFired()));
+
+    if (simulationRate > 0)
+    {
+        DBG_Printf(DBG_INFO, "simulation: generate %d attribute reports per second\n", simulationRate);
+        simulationTimer->start(SIM_TIMER_INTERVAL);
+    }
+}
+
+/*! Generates a light attribute report, alternating between on/off and level.
+    \return false if the light can't be simulated
+ */
+bool DeRestPluginPrivate::simulateLightReport(const LightNode &lightNode, deCONZ::ApsDataIndication &ind)
+{
+    if (lightNode.state() == LightNode::StateDeleted || !lightNode.haEndpoint().isValid())
+    {
+        return false;
+    }
+
+    const quint8 endpoint = lightNode.haEndpoint().endpoint();
+    const quint8 zclSeq = simulationIter & 0xff;
+
+    if ((simulationIter & 1) && lightNode.item(RStateBri))
+    {
+        simulatedReport(ind, lightNode.address(), endpoint, LEVEL_CLUSTER_ID, 0x0000, deCONZ::Zcl8BitUint,
+                        simulatedValue(simulationIter % 254 + 1, 1), zclSeq);
+    }
+    else
+    {
+        simulatedReport(ind, lightNode.address(), endpoint, ONOFF_CLUSTER_ID, 0x0000, deCONZ::ZclBoolean,
+                        simulatedValue((simulationIter >> 1) & 1, 1), zclSeq);
+    }
+
+    return true;
+}
+
+/*! Generates a measurement report for temperature, presence and light level sensors.
+    \return false if the sensor type isn't simulated
+ */
+bool DeRestPluginPrivate::simulateSensorReport(const Sensor &sensor, deCONZ::ApsDataIndication &ind)
+{
+    if (sensor.deletedState() != Sensor::StateNormal || !sensor.fingerPrint().hasEndpoint())
+    {
+        return false;
+    }
+
+    const quint8 endpoint = sensor.fingerPrint().endpoint;
+    const quint8 zclSeq = simulationIter & 0xff;
+
+    if (sensor.type() == QLatin1String("ZHATemperature"))
+    {
+        simulatedReport(ind, sensor.address(), endpoint, TEMPERATURE_MEASUREMENT_CLUSTER_ID, 0x0000, deCONZ::Zcl16BitInt,
+                        simulatedValue(1800 + simulationIter % 700, 2), zclSeq);
+    }
+    else if (sensor.type() == QLatin1String("ZHAPresence"))
+    {
+        simulatedReport(ind, sensor.address(), endpoint, OCCUPANCY_SENSING_CLUSTER_ID, 0x0000, deCONZ::Zcl8BitBitMap,
+                        simulatedValue((simulationIter >> 1) & 1, 1), zclSeq);
+    }
+    else if (sensor.type() == QLatin1String("ZHALightLevel"))
+    {
+        simulatedReport(ind, sensor.address(), endpoint, ILLUMINANCE_MEASUREMENT_CLUSTER_ID, 0x0000, deCONZ::Zcl16BitUint,
+                        simulatedValue(10000 + simulationIter % 20000, 2), zclSeq);
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/*! Generates the attribute reports of one timer interval round robin over lights and sensors.
+ */
+void DeRestPluginPrivate::simulationTimerFired()
+{
+    const size_t total = nodes.size() + sensors.size();
+
+    if (total == 0 || isInNetwork())
+    {
+        return; // never while connected, see initSimulation()
+    }
+
+    // spread the rate over the intervals and carry the remainder
+    simulationBudget += simulationRate * SIM_TIMER_INTERVAL;
+
+    while (simulationBudget >= 1000)
+    {
+        simulationBudget -= 1000;
+
+        deCONZ::ApsDataIndication ind;
+        const size_t n = simulationIter % total;
+        simulationIter++;
+
+        if (n < nodes.size() ? simulateLightReport(nodes[n], ind)
+                             : simulateSensorReport(sensors[n - nodes.size()], ind))
+        {
+            metrics.increment(QLatin1String("sim_indications_total"));
+            apsdeDataIndication(ind);
+        }
+    }
+}
+#endif // DECONZ_SIMULATION
+
+/*! Returns the value of a command line argument in the form --name=value.
+ */
+static QString argumentValue(const QString &name)
+{
+    const QString prefix = name + QLatin1Char('=');
+    for (const QString &arg : QCoreApplication::arguments())
+    {
+        if (arg.startsWith(prefix))
+        {
+            return arg.mid(prefix.size());
+        }
+    }
+    return QString();
+}
+
+/*! Inits recording and replay of APS traffic.
+    --aps-record=<file> records all indications, confirms and node events to a trace file.
+    --aps-replay=<file> feeds the indications and node events of a trace back into the plugin,
+    --aps-replay-speed=<n> accelerates the replay by factor n, 0 replays as fast as possible.
+    Replayed traffic is not recorded. Like the simulated traffic the replay is only available
+    with DECONZ_SIMULATION and only runs while the gateway isn't connected to the network.
+ */
+void DeRestPluginPrivate::initApsTrace()
+{
+    const QString recordPath = argumentValue(QLatin1String("--aps-record"));
+
+#ifdef DECONZ_SIMULATION
+    apsReplayTimer = new QTimer(this);
+    apsReplayTimer->setSingleShot(true);
+    connect(apsReplayTimer, SIGNAL(timeout()), this, SLOT(apsReplayTimerFired()));
+    apsReplaySpeed = deCONZ::appArgumentNumeric("--aps-replay-speed", 1);
+
+    const QString replayPath = argumentValue(QLatin1String("--aps-replay"));
+
+    if (!replayPath.isEmpty())
+    {
+        if (apsTraceReader.open(replayPath) && apsTraceReader.readNext(apsReplayRecord))
+        {
+            DBG_Printf(DBG_INFO, "APS trace: replay %s with speed %d\n", qPrintable(replayPath), apsReplaySpeed);
+            apsReplayTime.start();
+            apsReplayTimer->start(0);
+        }
+        return;
+    }
+#endif
+
+    if (!recordPath.isEmpty())
+    {
+        if (apsTraceWriter.open(recordPath))
+        {
+            DBG_Printf(DBG_INFO, "APS trace: record to %s\n", qPrintable(recordPath));
+        }
+    }
+}
+
+#ifdef DECONZ_SIMULATION
+/*! Feeds one trace record into the plugin.
+    Confirms are only recorded for analysis, their request ids match the tasks of the recording session only.
+ */
+void DeRestPluginPrivate::replayApsTraceRecord(const ApsTraceRecord &rec)
+{
+    if (rec.type == ApsTraceRecord::TypeIndication)
+    {
+        deCONZ::ApsDataIndication ind;
+        ind.setSrcAddressMode(deCONZ::ApsAddressMode(rec.addrMode));
+        ind.srcAddress().setExt(rec.ext);
+        ind.srcAddress().setNwk(rec.nwk);
+        ind.setDstAddressMode(deCONZ::ApsAddressMode(rec.dstAddrMode));
+        if (rec.dstAddrMode == deCONZ::ApsGroupAddress)
+        {
+            ind.dstAddress().setGroup(rec.dstNwk);
+        }
+        else
+        {
+            ind.dstAddress().setNwk(rec.dstNwk);
+        }
+        ind.setSrcEndpoint(rec.srcEndpoint);
+        ind.setDstEndpoint(rec.dstEndpoint);
+        ind.setProfileId(rec.profileId);
+        ind.setClusterId(rec.clusterId);
+        ind.setLinkQuality(rec.lqi);
+        ind.setRssi(rec.rssi);
+        ind.setAsdu(rec.asdu);
+
+        metrics.increment(QLatin1String("aps_replay_records_total{type=\"indication\"}"));
+        apsdeDataIndication(ind);
+    }
+    else if (rec.type == ApsTraceRecord::TypeNodeEvent)
+    {
+        const NodeCacheEntry *entry = getNodeCacheEntry(rec.ext);
+
+        if (entry && entry->node)
+        {
+            // attribute values are taken from the current state of the core node
+            deCONZ::NodeEvent event(deCONZ::NodeEvent::Event(rec.event), entry->node, rec.dstEndpoint, rec.clusterId);
+            metrics.increment(QLatin1String("aps_replay_records_total{type=\"node_event\"}"));
+            nodeEvent(event);
+        }
+    }
+}
+
+/*! Replays the due records of the trace and waits for the next one.
+ */
+void DeRestPluginPrivate::apsReplayTimerFired()
+{
+    int count = 0;
+
+    if (isInNetwork() && apsReplayRecord.type != ApsTraceRecord::TypeNone)
+    {
+        // never while connected, see initApsTrace()
+        DBG_Printf(DBG_INFO, "APS trace: replay stopped, gateway is connected to the network\n");
+        apsReplayRecord.type = ApsTraceRecord::TypeNone;
+        return;
+    }
+
+    while (apsReplayRecord.type != ApsTraceRecord::TypeNone)
+    {
+        const qint64 due = apsReplaySpeed > 0 ? apsReplayRecord.time / apsReplaySpeed : 0;
+        const qint64 wait = due - apsReplayTime.elapsed();
+
+        if (wait > 0)
+        {
+            apsReplayTimer->start(int(qMin(wait, qint64(1000))));
+            return;
+        }
+
+        if (count >= APS_REPLAY_MAX_BATCH)
+        {
+            apsReplayTimer->start(0); // let the event loop process the results
+            return;
+        }
+
+        replayApsTraceRecord(apsReplayRecord);
+        count++;
+
+        if (!apsTraceReader.readNext(apsReplayRecord))
+        {
+            apsReplayRecord.type = ApsTraceRecord::TypeNone;
+            DBG_Printf(DBG_INFO, "APS trace: replay finished after %d ms\n", int(apsReplayTime.elapsed()));
+        }
+    }
+}
+#endif // DECONZ_SIMULATION
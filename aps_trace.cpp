@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2020 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include "aps_trace.h"
+
+#define APS_TRACE_MAGIC   0x52544150UL // "PATR"
+#define APS_TRACE_VERSION 2 // 2: indications with LQI and RSSI
+
+/*! Creates the trace file and writes the file header.
+    \param path - trace file, will be truncated
+ */
+bool ApsTraceWriter::open(const QString &path)
+{
+    m_file.setFileName(path);
+
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        DBG_Printf(DBG_ERROR, "APS trace: can't create %s\n", qPrintable(path));
+        return false;
+    }
+
+    m_stream.setDevice(&m_file);
+    m_stream.setByteOrder(QDataStream::LittleEndian);
+    m_stream << quint32(APS_TRACE_MAGIC);
+    m_stream << quint8(APS_TRACE_VERSION);
+    m_time.start();
+    m_lastTime = 0;
+    return true;
+}
+
+/*! Writes the common part of a record.
+ */
+void ApsTraceWriter::writeHeader(ApsTraceRecord::Type type)
+{
+    const qint64 now = m_time.elapsed();
+    m_stream << quint8(type);
+    m_stream << quint32(now - m_lastTime);
+    m_lastTime = now;
+}
+
+/*! Records an APSDE-DATA.indication.
+ */
+void ApsTraceWriter::write(const deCONZ::ApsDataIndication &ind)
+{
+    if (!m_file.isOpen())
+    {
+        return;
+    }
+
+    writeHeader(ApsTraceRecord::TypeIndication);
+    m_stream << quint8(ind.srcAddressMode());
+    m_stream << quint64(ind.srcAddress().ext());
+    m_stream << quint16(ind.srcAddress().nwk());
+    m_stream << quint8(ind.dstAddressMode());
+    m_stream << quint16(ind.dstAddressMode() == deCONZ::ApsGroupAddress ? ind.dstAddress().group() : ind.dstAddress().nwk());
+    m_stream << quint8(ind.srcEndpoint());
+    m_stream << quint8(ind.dstEndpoint());
+    m_stream << quint16(ind.profileId());
+    m_stream << quint16(ind.clusterId());
+    m_stream << quint8(ind.linkQuality());
+    m_stream << qint8(ind.rssi());
+    m_stream << ind.asdu();
+}
+
+/*! Records an APSDE-DATA.confirm.
+ */
+void ApsTraceWriter::write(const deCONZ::ApsDataConfirm &conf)
+{
+    if (!m_file.isOpen())
+    {
+        return;
+    }
+
+    writeHeader(ApsTraceRecord::TypeConfirm);
+    m_stream << quint8(conf.id());
+    m_stream << quint8(conf.status());
+    m_stream << quint8(conf.dstAddressMode());
+    m_stream << quint64(conf.dstAddress().ext());
+    m_stream << quint16(conf.dstAddressMode() == deCONZ::ApsGroupAddress ? conf.dstAddress().group() : conf.dstAddress().nwk());
+    m_stream << quint8(conf.srcEndpoint());
+    m_stream << quint8(conf.dstEndpoint());
+}
+
+/*! Records a node event, the node is referenced by its IEEE address.
+ */
+void ApsTraceWriter::write(const deCONZ::NodeEvent &event)
+{
+    if (!m_file.isOpen() || !event.node())
+    {
+        return;
+    }
+
+    writeHeader(ApsTraceRecord::TypeNodeEvent);
+    m_stream << quint8(event.event());
+    m_stream << quint64(event.node()->address().ext());
+    m_stream << quint8(event.endpoint());
+    m_stream << quint16(event.clusterId());
+}
+
+/*! Opens a trace file and checks the file header.
+ */
+bool ApsTraceReader::open(const QString &path)
+{
+    m_file.setFileName(path);
+
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        DBG_Printf(DBG_ERROR, "APS trace: can't open %s\n", qPrintable(path));
+        return false;
+    }
+
+    m_stream.setDevice(&m_file);
+    m_stream.setByteOrder(QDataStream::LittleEndian);
+
+    quint32 magic = 0;
+    quint8 version = 0;
+    m_stream >> magic;
+    m_stream >> version;
+
+    if (magic != APS_TRACE_MAGIC || version != APS_TRACE_VERSION)
+    {
+        DBG_Printf(DBG_ERROR, "APS trace: %s is no trace file or has unsupported version\n", qPrintable(path));
+        m_file.close();
+        return false;
+    }
+
+    m_time = 0;
+    return true;
+}
+
+/*! Reads the next record.
+    \return false at the end of the trace or on errors
+ */
+bool ApsTraceReader::readNext(ApsTraceRecord &rec)
+{
+    if (!m_file.isOpen() || m_stream.atEnd())
+    {
+        return false;
+    }
+
+    quint8 type = 0;
+    quint32 dt = 0;
+    m_stream >> type;
+    m_stream >> dt;
+    m_time += dt;
+
+    rec = ApsTraceRecord();
+    rec.time = m_time;
+
+    if (type == ApsTraceRecord::TypeIndication)
+    {
+        rec.type = ApsTraceRecord::TypeIndication;
+        m_stream >> rec.addrMode;
+        m_stream >> rec.ext;
+        m_stream >> rec.nwk;
+        m_stream >> rec.dstAddrMode;
+        m_stream >> rec.dstNwk;
+        m_stream >> rec.srcEndpoint;
+        m_stream >> rec.dstEndpoint;
+        m_stream >> rec.profileId;
+        m_stream >> rec.clusterId;
+        m_stream >> rec.lqi;
+        m_stream >> rec.rssi;
+        m_stream >> rec.asdu;
+    }
+    else if (type == ApsTraceRecord::TypeConfirm)
+    {
+        rec.type = ApsTraceRecord::TypeConfirm;
+        m_stream >> rec.id;
+        m_stream >> rec.status;
+        m_stream >> rec.addrMode;
+        m_stream >> rec.ext;
+        m_stream >> rec.nwk;
+        m_stream >> rec.srcEndpoint;
+        m_stream >> rec.dstEndpoint;
+    }
+    else if (type == ApsTraceRecord::TypeNodeEvent)
+    {
+        rec.type = ApsTraceRecord::TypeNodeEvent;
+        m_stream >> rec.event;
+        m_stream >> rec.ext;
+        m_stream >> rec.dstEndpoint;
+        m_stream >> rec.clusterId;
+    }
+    else
+    {
+        DBG_Printf(DBG_ERROR, "APS trace: unknown record type %u\n", type);
+        m_file.close();
+        return false;
+    }
+
+    if (m_stream.status() != QDataStream::Ok)
+    {
+        m_file.close();
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2020 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef APS_TRACE_H
+#define APS_TRACE_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <deconz.h>
+
+/*! \class ApsTraceRecord
+
+    One entry of an APS trace. Only the fields of the record type are valid.
+ */
+class ApsTraceRecord
+{
+public:
+    enum Type
+    {
+        TypeNone = 0,
+        TypeIndication = 1,
+        TypeConfirm = 2,
+        TypeNodeEvent = 3
+    };
+
+    ApsTraceRecord() :
+        type(TypeNone),
+        time(0),
+        id(0),
+        status(0),
+        addrMode(0),
+        ext(0),
+        nwk(0),
+        dstAddrMode(0),
+        dstNwk(0),
+        srcEndpoint(0),
+        dstEndpoint(0),
+        profileId(0),
+        clusterId(0),
+        lqi(0),
+        rssi(0),
+        event(0)
+    {
+    }
+
+    Type type;
+    qint64 time; // ms since the start of the recording
+
+    // indication and confirm
+    quint8 id;
+    quint8 status;
+    quint8 addrMode; // source of indications, destination of confirms
+    quint64 ext; // also node of events
+    quint16 nwk; // or group
+    quint8 dstAddrMode;
+    quint16 dstNwk; // or group
+    quint8 srcEndpoint;
+    quint8 dstEndpoint; // also endpoint of node events
+    quint16 profileId;
+    quint16 clusterId; // also cluster of node events
+    quint8 lqi; // indication only
+    qint8 rssi; // indication only
+    QByteArray asdu;
+
+    // node event
+    quint8 event;
+};
+
+/*! \class ApsTraceWriter
+
+    Records APS indications, confirms and node events to a compact binary file.
+    Each record starts with its type and the ms delta to the previous record.
+ */
+class ApsTraceWriter
+{
+public:
+    ApsTraceWriter() : m_lastTime(0) { }
+    bool open(const QString &path);
+    bool isOpen() const { return m_file.isOpen(); }
+    void write(const deCONZ::ApsDataIndication &ind);
+    void write(const deCONZ::ApsDataConfirm &conf);
+    void write(const deCONZ::NodeEvent &event);
+
+private:
+    void writeHeader(ApsTraceRecord::Type type);
+
+    QFile m_file;
+    QDataStream m_stream;
+    QElapsedTimer m_time;
+    qint64 m_lastTime;
+};
+
+/*! \class ApsTraceReader
+
+    Reads the records of a file written by ApsTraceWriter.
+ */
+class ApsTraceReader
+{
+public:
+    ApsTraceReader() : m_time(0) { }
+    bool open(const QString &path);
+    bool isOpen() const { return m_file.isOpen(); }
+    bool readNext(ApsTraceRecord &rec);
+
+private:
+    QFile m_file;
+    QDataStream m_stream;
+    qint64 m_time;
+};
+
+#endif // APS_TRACE_H
@@ -95,7 +95,7 @@ bool DeRestPluginPrivate::allowedToCreateApikey(const ApiRequest &req, ApiRespon
 
     if (apsCtrl && map.contains(QLatin1String("hmac-sha256")))
     {
-        QDateTime now = QDateTime::currentDateTime();
+        const QDateTime now = CachedClock::currentDateTime();
         QByteArray remoteHmac = map["hmac-sha256"].toByteArray();
         QByteArray sec0 = apsCtrl->getParameter(deCONZ::ParamSecurityMaterial0);
         QByteArray installCode = sec0.mid(0, 16);
@@ -158,7 +158,7 @@ void DeRestPluginPrivate::authorise(ApiRequest &req, ApiResponse &rsp)
         if (apikey == i->apikey && i->state == ApiAuth::StateNormal)
         {
             apiAuthCurrent = pos;
-            i->lastUseDate = QDateTime::currentDateTimeUtc();
+            i->lastUseDate = CachedClock::currentDateTimeUtc();
 
             // fill in useragent string if not already exist
             if (i->useragent.isEmpty())
@@ -172,14 +172,7 @@ void DeRestPluginPrivate::authorise(ApiRequest &req, ApiResponse &rsp)
 
             if (req.sock)
             {
-                for (TcpClient &cl : openClients)
-                {
-                    if (cl.sock == req.sock && cl.closeTimeout > 0)
-                    {
-                        cl.closeTimeout = AUTH_KEEP_ALIVE;
-                        break;
-                    }
-                }
+                setClientCloseTimeout(req.sock, AUTH_KEEP_ALIVE);
             }
 
             if ((!(i->useragent.isEmpty()) && i->useragent.startsWith(QLatin1String("iConnect"))) || i->devicetype.startsWith(QLatin1String("iConnectHue")))
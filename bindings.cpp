@@ -12,6 +12,185 @@
 #include "de_web_plugin_private.h"
 
 #define MAX_ACTIVE_BINDING_TASKS 3
+#define MAX_REPORTING_PAYLOAD 64 // ZCL payload bytes per (read) configure reporting frame
+#define READ_REPORTING_CONFIG_TIMEOUT 10000 // ms, configure without verification after this time
+#define NO_REPORTABLE_CHANGE 0xFFFFFFFF
+#define BINDING_TO_RULE_TIME_BUDGET 20 // ms per bindingToRuleTimer tick
+
+/*! Declarative reporting configuration of a cluster.
+    Entries with a matching model id prefix take precedence over generic entries (modelIdPrefix = nullptr).
+ */
+struct ReportingConfigEntry
+{
+    quint16 clusterId;
+    const char *modelIdPrefix;
+    quint16 manufacturerCode;
+    quint8 dataType;
+    quint16 attributeId;
+    quint16 minInterval;
+    quint16 maxInterval;
+    quint32 reportableChange; // NO_REPORTABLE_CHANGE for discrete data types
+};
+
+static const ReportingConfigEntry reportingConfigTable[] = {
+    // values used by Hue bridge
+    { ILLUMINANCE_MEASUREMENT_CLUSTER_ID, nullptr, 0, deCONZ::Zcl16BitUint, 0x0000, 5, 300, 2000 }, // measured value
+    { TEMPERATURE_MEASUREMENT_CLUSTER_ID, nullptr, 0, deCONZ::Zcl16BitInt, 0x0000, 10, 300, 20 }, // measured value
+    // Eurotronic Spirit
+    { THERMOSTAT_CLUSTER_ID, "SPZB", 0, deCONZ::Zcl16BitInt, 0x0000, 1, 600, 20 }, // local temperature
+    { THERMOSTAT_CLUSTER_ID, "SPZB", 0, deCONZ::Zcl8BitUint, 0x0008, 1, 600, 1 }, // pi heating demand (valve position %)
+    { THERMOSTAT_CLUSTER_ID, "SPZB", 0, deCONZ::Zcl16BitInt, 0x0012, 65535, 65535, 0 }, // occupied heating setpoint - disable
+    { THERMOSTAT_CLUSTER_ID, "SPZB", 0, deCONZ::Zcl16BitInt, 0x0014, 65535, 65535, 0 }, // unoccupied heating setpoint - disable
+    { THERMOSTAT_CLUSTER_ID, "SPZB", VENDOR_JENNIC, deCONZ::Zcl16BitInt, 0x4003, 1, 600, 50 }, // current temperature set point
+    { THERMOSTAT_CLUSTER_ID, "SPZB", VENDOR_JENNIC, deCONZ::Zcl24BitUint, 0x4008, 1, 600, 1 }, // host flags
+    { THERMOSTAT_CLUSTER_ID, nullptr, 0, deCONZ::Zcl16BitInt, 0x0000, 0, 300, 10 }, // local temperature
+    { RELATIVE_HUMIDITY_CLUSTER_ID, nullptr, 0, deCONZ::Zcl16BitUint, 0x0000, 10, 300, 100 }, // measured value, resolution: 1%
+    { PRESSURE_MEASUREMENT_CLUSTER_ID, nullptr, 0, deCONZ::Zcl16BitUint, 0x0000, 10, 300, 20 }, // measured value
+    { BINARY_INPUT_CLUSTER_ID, nullptr, 0, deCONZ::ZclBoolean, 0x0055, 10, 300, NO_REPORTABLE_CHANGE }, // present value
+    { FAN_CONTROL_CLUSTER_ID, nullptr, 0, deCONZ::Zcl8BitEnum, 0x0000, 1, 300, NO_REPORTABLE_CHANGE } // fan speed
+};
+
+/*! Returns the model identifier of a light or sensor node. */
+static QString nodeModelId(RestNodeBase *restNode)
+{
+    const LightNode *lightNode = dynamic_cast<LightNode*>(restNode);
+    if (lightNode)
+    {
+        return lightNode->modelId();
+    }
+
+    const Sensor *sensor = dynamic_cast<Sensor*>(restNode);
+    if (sensor)
+    {
+        return sensor->modelId();
+    }
+
+    return QString();
+}
+
+/*! Returns the planned reporting configuration of a cluster from reportingConfigTable.
+    \param restNode - the light or sensor node
+    \param clusterId - the bound cluster
+ */
+static std::vector<ConfigureReportingRequest> reportingConfigFromTable(RestNodeBase *restNode, quint16 clusterId)
+{
+    std::vector<ConfigureReportingRequest> result;
+    const QString modelId = nodeModelId(restNode);
+
+    for (int pass = 0; pass < 2 && result.empty(); pass++) // 0: model specific, 1: generic
+    {
+        for (const ReportingConfigEntry &e : reportingConfigTable)
+        {
+            if (e.clusterId != clusterId)
+            {
+                continue;
+            }
+
+            if (pass == 0 && (!e.modelIdPrefix || !modelId.startsWith(QLatin1String(e.modelIdPrefix))))
+            {
+                continue;
+            }
+
+            if (pass == 1 && e.modelIdPrefix)
+            {
+                continue;
+            }
+
+            ConfigureReportingRequest rq;
+            rq.dataType = e.dataType;
+            rq.attributeId = e.attributeId;
+            rq.minInterval = e.minInterval;
+            rq.maxInterval = e.maxInterval;
+            rq.manufacturerCode = e.manufacturerCode;
+
+            if (e.reportableChange != NO_REPORTABLE_CHANGE)
+            {
+                switch (e.dataType)
+                {
+                case deCONZ::Zcl8BitUint:  rq.reportableChange8bit = static_cast<quint8>(e.reportableChange); break;
+                case deCONZ::Zcl24BitUint:
+                case deCONZ::Zcl24BitInt:  rq.reportableChange24bit = e.reportableChange; break;
+                case deCONZ::Zcl48BitUint: rq.reportableChange48bit = e.reportableChange; break;
+                default:                   rq.reportableChange16bit = static_cast<quint16>(e.reportableChange); break;
+                }
+            }
+
+            result.push_back(rq);
+        }
+    }
+
+    return result;
+}
+
+/*! Returns the size of a configure reporting attribute record, see sendConfigureReportingFrames(). */
+static int configureReportingRecordSize(const ConfigureReportingRequest &rq)
+{
+    int size = 8; // direction, attribute id, data type, min and max interval
+    if      (rq.reportableChange16bit != 0xFFFF)     { size += 2; }
+    else if (rq.reportableChange8bit != 0xFF)        { size += 1; }
+    else if (rq.reportableChange24bit != 0xFFFFFF)   { size += 3; }
+    else if (rq.reportableChange48bit != 0xFFFFFFFF) { size += 6; }
+    return size;
+}
+
+/*! Returns the size of a read reporting configuration attribute record. */
+static int readReportingConfigRecordSize(const ConfigureReportingRequest &)
+{
+    return 3; // direction, attribute id
+}
+
+/*! Splits requests into the minimal number of frames which share the manufacturer code
+    and fit into MAX_REPORTING_PAYLOAD.
+ */
+static std::vector<std::vector<ConfigureReportingRequest>> packReportingRequests(const std::vector<ConfigureReportingRequest> &requests,
+                                                                                 int (*recordSize)(const ConfigureReportingRequest &))
+{
+    std::vector<std::vector<ConfigureReportingRequest>> frames;
+    std::vector<int> sizes;
+
+    for (const ConfigureReportingRequest &rq : requests)
+    {
+        const int size = recordSize(rq);
+        size_t i = 0;
+        for (; i < frames.size(); i++)
+        {
+            if (frames[i].front().manufacturerCode == rq.manufacturerCode && sizes[i] + size <= MAX_REPORTING_PAYLOAD)
+            {
+                break;
+            }
+        }
+
+        if (i == frames.size())
+        {
+            frames.emplace_back();
+            sizes.push_back(0);
+        }
+
+        frames[i].push_back(rq);
+        sizes[i] += size;
+    }
+
+    return frames;
+}
+
+/*! Returns the size of the reportable change field of analog ZCL data types or 0 for discrete types. */
+static int zclReportableChangeSize(quint8 dataType)
+{
+    if (dataType >= 0x20 && dataType <= 0x27) { return dataType - 0x20 + 1; } // unsigned integer
+    if (dataType >= 0x28 && dataType <= 0x2f) { return dataType - 0x28 + 1; } // signed integer
+    switch (dataType)
+    {
+    case 0x38: return 2; // semi precision
+    case 0x39: return 4; // single precision
+    case 0x3a: return 8; // double precision
+    case 0xe0: // time of day
+    case 0xe1: // date
+    case 0xe2: return 4; // UTC time
+    default:
+        break;
+    }
+    return 0;
+}
 
 /*! Constructor. */
 Binding::Binding() :
@@ -138,21 +317,17 @@ bool DeRestPluginPrivate::readBindingTable(RestNodeBase *node, quint8 startIndex
         return false;
     }
 
-    std::vector<BindingTableReader>::iterator i = bindingTableReaders.begin();
-    std::vector<BindingTableReader>::iterator end = bindingTableReaders.end();
+    auto i = bindingTableReaders.find(node->address().ext());
 
-    for (; i != end; ++i)
+    if (i != bindingTableReaders.end())
     {
-        if (i->apsReq.dstAddress().ext() == node->address().ext())
+        // already running
+        if (i->state == BindingTableReader::StateIdle)
         {
-            // already running
-            if (i->state == BindingTableReader::StateIdle)
-            {
-                i->index = startIndex;
-                DBG_Assert(bindingTableReaderTimer->isActive());
-            }
-            return true;
+            i->index = startIndex;
+            DBG_Assert(bindingTableReaderTimer->isActive());
         }
+        return true;
     }
 
     BindingTableReader btReader;
@@ -160,8 +335,10 @@ bool DeRestPluginPrivate::readBindingTable(RestNodeBase *node, quint8 startIndex
     btReader.index = startIndex;
     btReader.isEndDevice = !node->node()->nodeDescriptor().receiverOnWhenIdle();
     btReader.apsReq.dstAddress() = node->address();
+    btReader.time.start();
 
-    bindingTableReaders.push_back(btReader);
+    bindingTableReaders.insert(node->address().ext(), btReader);
+    metrics.setGauge(QLatin1String("binding_table_readers"), bindingTableReaders.size());
 
     if (!bindingTableReaderTimer->isActive())
     {
@@ -182,8 +359,8 @@ bool DeRestPluginPrivate::handleMgmtBindRspConfirm(const deCONZ::ApsDataConfirm
         return false;
     }
 
-    std::vector<BindingTableReader>::iterator i = bindingTableReaders.begin();
-    std::vector<BindingTableReader>::iterator end = bindingTableReaders.end();
+    auto i = bindingTableReaders.begin();
+    const auto end = bindingTableReaders.end();
 
     for (; i != end; ++i)
     {
@@ -214,18 +391,15 @@ void DeRestPluginPrivate::handleMgmtBindRspIndication(const deCONZ::ApsDataIndic
     BindingTableReader *btReader = 0;
 
     {
-        std::vector<BindingTableReader>::iterator i = bindingTableReaders.begin();
-        std::vector<BindingTableReader>::iterator end = bindingTableReaders.end();
+        auto i = bindingTableReaders.begin();
+        const auto end = bindingTableReaders.end();
 
         if (ind.srcAddress().hasExt())
         {
-            for (; i != end; ++i)
+            i = bindingTableReaders.find(ind.srcAddress().ext());
+            if (i != end)
             {
-                if (i->apsReq.dstAddress().ext() == ind.srcAddress().ext())
-                {
-                    btReader = &(*i);
-                    break;
-                }
+                btReader = &(*i);
             }
         }
         else if (ind.srcAddress().hasNwk())
@@ -306,15 +480,22 @@ void DeRestPluginPrivate::handleMgmtBindRspIndication(const deCONZ::ApsDataIndic
     stream >> startIndex;
     stream >> listCount;
 
+    metrics.increment(QLatin1String("binding_table_pages_total"));
+
     if (entries > (startIndex + listCount))
     {
         if (btReader)
         {
             if (btReader->state == BindingTableReader::StateWaitResponse || btReader->state == BindingTableReader::StateWaitConfirm)
             {
-                // read more
+                // read more, the node is awake right now so don't wait for the timer
                 btReader->state = BindingTableReader::StateIdle;
                 btReader->index = startIndex + listCount;
+                btReader->time.start();
+                if (!sendMgmtBindRequest(*btReader))
+                {
+                    btReader->state = BindingTableReader::StateFinished;
+                }
             }
             else
             {
@@ -360,25 +541,25 @@ void DeRestPluginPrivate::handleMgmtBindRspIndication(const deCONZ::ApsDataIndic
                 DBG_Printf(DBG_ZDP, "binding already in binding to rule queue\n");
             }
 
-            std::list<BindingTask>::iterator i = bindingQueue.begin();
-            std::list<BindingTask>::iterator end = bindingQueue.end();
+            auto i = bindingQueueIndex.find(BindingTask::key(bnd, BindingTask::ActionBind));
+            if (i == bindingQueueIndex.end())
+            {
+                i = bindingQueueIndex.find(BindingTask::key(bnd, BindingTask::ActionUnbind));
+            }
 
-            for (;i != end; ++i)
+            if (i != bindingQueueIndex.end())
             {
-                if (i->binding == bnd)
+                BindingTask &task = *i.value();
+                if (task.action == BindingTask::ActionBind && task.state != BindingTask::StateFinished)
                 {
-                    if (i->action == BindingTask::ActionBind && i->state != BindingTask::StateFinished)
-                    {
-                        DBG_Printf(DBG_ZDP, "binding 0x%04X, 0x%02X already exists, drop task\n", bnd.clusterId, bnd.dstEndpoint);
-                        i->state = BindingTask::StateFinished; // already existing
-                        sendConfigureReportingRequest(*i); // (re?)configure
-                    }
-                    else if (i->action == BindingTask::ActionUnbind && i->state == BindingTask::StateCheck)
-                    {
-                        DBG_Printf(DBG_ZDP, "binding 0x%04X, 0x%02X exists, start unbind task\n", bnd.clusterId, bnd.dstEndpoint);
-                        i->state = BindingTask::StateIdle; // exists -> unbind
-                    }
-                    break;
+                    DBG_Printf(DBG_ZDP, "binding 0x%04X, 0x%02X already exists, drop task\n", bnd.clusterId, bnd.dstEndpoint);
+                    task.state = BindingTask::StateFinished; // already existing
+                    sendConfigureReportingRequest(task); // (re?)configure
+                }
+                else if (task.action == BindingTask::ActionUnbind && task.state == BindingTask::StateCheck)
+                {
+                    DBG_Printf(DBG_ZDP, "binding 0x%04X, 0x%02X exists, start unbind task\n", bnd.clusterId, bnd.dstEndpoint);
+                    task.state = BindingTask::StateIdle; // exists -> unbind
                 }
             }
         }
@@ -522,6 +703,169 @@ void DeRestPluginPrivate::handleZclConfigureReportingResponseIndication(const de
     bindingTimer->start(0); // fast process of next request
 }
 
+/*! Returns true if \p change equals the reportable change which is sent for \p rq,
+    see DeRestPluginPrivate::sendConfigureReportingFrames().
+ */
+static bool reportableChangeEquals(const ConfigureReportingRequest &rq, quint64 change)
+{
+    if (rq.reportableChange16bit != 0xFFFF)     { return change == rq.reportableChange16bit; }
+    if (rq.reportableChange8bit != 0xFF)        { return change == rq.reportableChange8bit; }
+    if (rq.reportableChange24bit != 0xFFFFFF)   { return change == rq.reportableChange24bit; }
+    if (rq.reportableChange48bit != 0xFFFFFFFF) { return change == rq.reportableChange48bit; }
+    return true; // no reportable change planned
+}
+
+/*! Returns the light or sensor which provides the cluster of a binding, or 0 if it doesn't exist (anymore).
+ */
+RestNodeBase *DeRestPluginPrivate::getRestNodeForBinding(const Binding &bnd)
+{
+    deCONZ::Address addr;
+    addr.setExt(bnd.srcAddress);
+
+    LightNode *lightNode = getLightNodeForAddress(addr, bnd.srcEndpoint);
+    if (lightNode)
+    {
+        return lightNode;
+    }
+
+    for (Sensor &sensor : sensors)
+    {
+        if (sensor.deletedState() == Sensor::StateNormal &&
+            sensor.address().ext() == bnd.srcAddress &&
+            sensor.fingerPrint().endpoint == bnd.srcEndpoint &&
+            sensor.fingerPrint().hasInCluster(bnd.clusterId))
+        {
+            return &sensor;
+        }
+    }
+
+    return nullptr;
+}
+
+/*! Handle incoming ZCL read reporting configuration response.
+    Attributes which already report with the planned intervals are marked as configured,
+    the remaining ones are configured now.
+ */
+void DeRestPluginPrivate::handleZclReadReportingConfigResponseIndication(const deCONZ::ApsDataIndication &ind, deCONZ::ZclFrame &zclFrame)
+{
+    auto check = std::find_if(reportingConfigChecks.begin(), reportingConfigChecks.end(), [&](const ReportingConfigCheck &c)
+    {
+        return c.zclSeqNum == zclFrame.sequenceNumber() &&
+               c.binding.clusterId == ind.clusterId() &&
+               c.binding.srcAddress == ind.srcAddress().ext();
+    });
+
+    if (check == reportingConfigChecks.end())
+    {
+        return;
+    }
+
+    const ReportingConfigCheck chk = *check;
+    reportingConfigChecks.erase(check);
+
+    BindingTask bt;
+    bt.binding = chk.binding;
+    bt.restNode = getRestNodeForBinding(chk.binding);
+
+    if (!bt.restNode)
+    {
+        return; // deleted meanwhile
+    }
+
+    std::vector<ConfigureReportingRequest> out = chk.requests;
+    const QDateTime now = QDateTime::currentDateTime();
+
+    QDataStream stream(zclFrame.payload());
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    while (!stream.atEnd())
+    {
+        quint8 status;
+        quint8 direction;
+        quint16 attrId;
+        quint8 dataType = 0;
+        quint16 minInterval = 0;
+        quint16 maxInterval = 0;
+        quint64 reportableChange = 0;
+        int reportableChangeSize = 0;
+
+        stream >> status;
+        stream >> direction;
+        stream >> attrId;
+
+        if (status != deCONZ::ZclSuccessStatus)
+        {
+            continue;
+        }
+
+        if (direction == 0x00) // reported
+        {
+            stream >> dataType;
+            stream >> minInterval;
+            stream >> maxInterval;
+
+            reportableChangeSize = zclReportableChangeSize(dataType); // analog types only
+            for (int n = 0; n < reportableChangeSize; n++)
+            {
+                quint8 byte;
+                stream >> byte;
+                reportableChange |= quint64(byte) << (n * 8);
+            }
+        }
+        else // received, timeout period
+        {
+            stream.skipRawData(2);
+        }
+
+        if (stream.status() != QDataStream::Ok)
+        {
+            break;
+        }
+
+        auto rq = std::find_if(out.begin(), out.end(), [&](const ConfigureReportingRequest &r)
+        {
+            return r.attributeId == attrId && r.direction == direction;
+        });
+
+        if (rq == out.end() || rq->minInterval != minInterval || rq->maxInterval != maxInterval)
+        {
+            continue;
+        }
+
+        if (reportableChangeSize > 0 && !reportableChangeEquals(*rq, reportableChange))
+        {
+            continue;
+        }
+
+        DBG_Printf(DBG_INFO, "skip configure report for cluster: 0x%04X attr: 0x%04X of node 0x%016llX (already configured)\n",
+                   ind.clusterId(), attrId, ind.srcAddress().ext());
+
+        NodeValue &val = bt.restNode->getZclValue(ind.clusterId(), attrId);
+        if (val.clusterId == ind.clusterId())
+        {
+            val.timestampLastConfigured = now;
+            val.timestampLastVerified = now;
+            val.zclSeqNum = 0;
+        }
+        metrics.increment(QLatin1String("configure_reporting_skipped_total"));
+        out.erase(rq);
+    }
+
+    for (const ConfigureReportingRequest &rq : out)
+    {
+        NodeValue &val = bt.restNode->getZclValue(ind.clusterId(), rq.attributeId);
+        if (val.clusterId == ind.clusterId())
+        {
+            val.timestampLastVerified = now;
+        }
+    }
+
+    if (!out.empty())
+    {
+        sendConfigureReportingFrames(bt, out);
+    }
+}
+
 /*! Handle bind/unbind response.
     \param ind a ZDP Bind/Unbind_rsp
  */
@@ -654,9 +998,12 @@ bool DeRestPluginPrivate::sendBindRequest(BindingTask &bt)
     return false;
 }
 
-/*! Sends a ZCL configure attribute reporting request.
+/*! Sends ZCL configure reporting requests for the attributes which aren't reporting yet.
+    The attributes are packed into as few frames as possible. For routers the current
+    configuration is verified first by Read Reporting Configuration, compliant attributes
+    aren't configured again.
     \param bt a former binding task
-    \param requests list of configure reporting requests which will be combined in a message
+    \param requests list of configure reporting requests which will be combined in messages
  */
 bool DeRestPluginPrivate::sendConfigureReportingRequest(BindingTask &bt, const std::vector<ConfigureReportingRequest> &requests)
 {
@@ -666,15 +1013,11 @@ bool DeRestPluginPrivate::sendConfigureReportingRequest(BindingTask &bt, const s
         return false;
     }
 
-    zclSeq++;
-    if (zclSeq == 0) // don't use zero, simplify matching
-    {
-        zclSeq = 1;
-    }
-    const quint8 zclSeqNum = zclSeq; // to match in configure reporting response handler
     LightNode *lightNode = dynamic_cast<LightNode*>(bt.restNode);
     QDateTime now = QDateTime::currentDateTime();
     std::vector<ConfigureReportingRequest> out;
+    std::vector<ConfigureReportingRequest> verify;
+    const bool verifySupported = bt.restNode->node() && bt.restNode->node()->nodeDescriptor().receiverOnWhenIdle();
 
     for (const ConfigureReportingRequest &rq : requests)
     {
@@ -696,10 +1039,17 @@ bool DeRestPluginPrivate::sendConfigureReportingRequest(BindingTask &bt, const s
                     // and prevent further bind requests before reports arrive
                     val.timestampLastReport = QDateTime::currentDateTime();
                 }
-                val.zclSeqNum = zclSeqNum;
                 val.minInterval = rq.minInterval;
                 val.maxInterval = rq.maxInterval;
-                out.push_back(rq);
+
+                if (verifySupported && !val.timestampLastVerified.isValid())
+                {
+                    verify.push_back(rq);
+                }
+                else
+                {
+                    out.push_back(rq);
+                }
             }
         }
         else if (lightNode)
@@ -714,55 +1064,64 @@ bool DeRestPluginPrivate::sendConfigureReportingRequest(BindingTask &bt, const s
             deCONZ::NumericUnion dummy;
             dummy.u64 = 0;
             bt.restNode->setZclValue(NodeValue::UpdateByZclReport, bt.binding.clusterId, rq.attributeId, dummy);
-            val.zclSeqNum = zclSeqNum;
-            val.minInterval = rq.minInterval;
-            val.maxInterval = rq.maxInterval;
+            NodeValue &val2 = bt.restNode->getZclValue(bt.binding.clusterId, rq.attributeId);
+            val2.minInterval = rq.minInterval;
+            val2.maxInterval = rq.maxInterval;
             out.push_back(rq);
         }
     }
 
-    if (out.empty())
+    bool ret = false;
+
+    if (!verify.empty())
     {
-        return false;
+        if (sendReadReportingConfigRequest(bt, verify))
+        {
+            ret = true;
+        }
+        else
+        {
+            out.insert(out.end(), verify.begin(), verify.end());
+        }
     }
 
-    deCONZ::ApsDataRequest apsReq;
+    if (!out.empty() && sendConfigureReportingFrames(bt, out))
+    {
+        ret = true;
+    }
 
-    // ZDP Header
-    apsReq.dstAddress() = bt.restNode->address();
-    apsReq.setDstAddressMode(deCONZ::ApsExtAddress);
-    apsReq.setDstEndpoint(bt.binding.srcEndpoint);
-    apsReq.setSrcEndpoint(endpoint());
-    apsReq.setProfileId(HA_PROFILE_ID);
-    apsReq.setRadius(0);
-    apsReq.setClusterId(bt.binding.clusterId);
-    apsReq.setTxOptions(deCONZ::ApsTxAcknowledgedTransmission);
+    return ret;
+}
 
-    deCONZ::ZclFrame zclFrame;
-    zclFrame.setSequenceNumber(zclSeqNum);
-    zclFrame.setCommandId(deCONZ::ZclConfigureReportingId);
+/*! Sends ZCL configure reporting requests, packed into as few frames as possible.
+    \param bt a former binding task
+    \param requests the attributes to configure
+ */
+bool DeRestPluginPrivate::sendConfigureReportingFrames(BindingTask &bt, const std::vector<ConfigureReportingRequest> &requests)
+{
+    bool ret = false;
 
-    if (requests.front().manufacturerCode)
+    for (const std::vector<ConfigureReportingRequest> &frame : packReportingRequests(requests, configureReportingRecordSize))
     {
-        zclFrame.setFrameControl(deCONZ::ZclFCProfileCommand |
-                                 deCONZ::ZclFCManufacturerSpecific |
-                                 deCONZ::ZclFCDirectionClientToServer |
-                                 deCONZ::ZclFCDisableDefaultResponse);
-        zclFrame.setManufacturerCode(requests.front().manufacturerCode);
-    }
-    else
-    {
-        zclFrame.setFrameControl(deCONZ::ZclFCProfileCommand |
-                                 deCONZ::ZclFCDirectionClientToServer |
-                                 deCONZ::ZclFCDisableDefaultResponse);
-    }
+        zclSeq++;
+        if (zclSeq == 0) // don't use zero, simplify matching
+        {
+            zclSeq = 1;
+        }
+        const quint8 zclSeqNum = zclSeq; // to match in configure reporting response handler
 
-    { // payload
-        QDataStream stream(&zclFrame.payload(), QIODevice::WriteOnly);
+        QByteArray payload;
+        QDataStream stream(&payload, QIODevice::WriteOnly);
         stream.setByteOrder(QDataStream::LittleEndian);
 
-        for (const ConfigureReportingRequest &rq : out)
+        for (const ConfigureReportingRequest &rq : frame)
         {
+            NodeValue &val = bt.restNode->getZclValue(bt.binding.clusterId, rq.attributeId);
+            if (val.clusterId == bt.binding.clusterId)
+            {
+                val.zclSeqNum = zclSeqNum;
+            }
+
             stream << rq.direction;
             stream << rq.attributeId;
             stream << rq.dataType;
@@ -794,22 +1153,120 @@ bool DeRestPluginPrivate::sendConfigureReportingRequest(BindingTask &bt, const s
             }
             DBG_Printf(DBG_INFO_L2, "configure reporting rq seq %u for 0x%016llX, attribute 0x%04X/0x%04X\n", zclSeqNum, bt.restNode->address().ext(), bt.binding.clusterId, rq.attributeId);
         }
+
+        if (sendReportingFrame(bt, deCONZ::ZclConfigureReportingId, frame.front().manufacturerCode, zclSeqNum, payload))
+        {
+            metrics.increment(QLatin1String("configure_reporting_frames_total"));
+            metrics.increment(QLatin1String("configure_reporting_attributes_total"), frame.size());
+            queryTime = queryTime.addSecs(1);
+            ret = true;
+        }
+    }
+
+    return ret;
+}
+
+/*! Sends ZCL read reporting configuration requests to verify the current configuration
+    before it is changed, see handleZclReadReportingConfigResponseIndication().
+    \param bt a former binding task
+    \param requests the planned configuration
+ */
+bool DeRestPluginPrivate::sendReadReportingConfigRequest(BindingTask &bt, const std::vector<ConfigureReportingRequest> &requests)
+{
+    bool ret = false;
+
+    for (const std::vector<ConfigureReportingRequest> &frame : packReportingRequests(requests, readReportingConfigRecordSize))
+    {
+        zclSeq++;
+        if (zclSeq == 0) // don't use zero, simplify matching
+        {
+            zclSeq = 1;
+        }
+
+        QByteArray payload;
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream.setByteOrder(QDataStream::LittleEndian);
+
+        for (const ConfigureReportingRequest &rq : frame)
+        {
+            stream << rq.direction;
+            stream << rq.attributeId;
+        }
+
+        if (sendReportingFrame(bt, deCONZ::ZclReadReportingConfigId, frame.front().manufacturerCode, zclSeq, payload))
+        {
+            ReportingConfigCheck check;
+            check.zclSeqNum = zclSeq;
+            check.deadline = starttimeRef.elapsed() + READ_REPORTING_CONFIG_TIMEOUT;
+            check.binding = bt.binding;
+            check.requests = frame;
+            reportingConfigChecks.push_back(check);
+            DBG_Printf(DBG_INFO_L2, "read reporting config rq seq %u for 0x%016llX, cluster 0x%04X\n", zclSeq, bt.restNode->address().ext(), bt.binding.clusterId);
+            ret = true;
+        }
+        else if (sendConfigureReportingFrames(bt, frame))
+        {
+            ret = true;
+        }
+    }
+
+    if (ret && !bindingTimer->isActive())
+    {
+        bindingTimer->start(1000); // timeout handling
+    }
+
+    return ret;
+}
+
+/*! Sends a profile wide ZCL command related to attribute reporting to the node of a binding task.
+    \param bt a former binding task
+    \param commandId ZclConfigureReportingId or ZclReadReportingConfigId
+    \param manufacturerCode manufacturer code or 0 for standard attributes
+    \param zclSeqNum the ZCL sequence number
+    \param payload the ZCL payload
+ */
+bool DeRestPluginPrivate::sendReportingFrame(const BindingTask &bt, quint8 commandId, quint16 manufacturerCode, quint8 zclSeqNum, const QByteArray &payload)
+{
+    deCONZ::ApsDataRequest apsReq;
+
+    // ZDP Header
+    apsReq.dstAddress() = bt.restNode->address();
+    apsReq.setDstAddressMode(deCONZ::ApsExtAddress);
+    apsReq.setDstEndpoint(bt.binding.srcEndpoint);
+    apsReq.setSrcEndpoint(endpoint());
+    apsReq.setProfileId(HA_PROFILE_ID);
+    apsReq.setRadius(0);
+    apsReq.setClusterId(bt.binding.clusterId);
+    apsReq.setTxOptions(deCONZ::ApsTxAcknowledgedTransmission);
+
+    deCONZ::ZclFrame zclFrame;
+    zclFrame.setSequenceNumber(zclSeqNum);
+    zclFrame.setCommandId(commandId);
+
+    if (manufacturerCode)
+    {
+        zclFrame.setFrameControl(deCONZ::ZclFCProfileCommand |
+                                 deCONZ::ZclFCManufacturerSpecific |
+                                 deCONZ::ZclFCDirectionClientToServer |
+                                 deCONZ::ZclFCDisableDefaultResponse);
+        zclFrame.setManufacturerCode(manufacturerCode);
+    }
+    else
+    {
+        zclFrame.setFrameControl(deCONZ::ZclFCProfileCommand |
+                                 deCONZ::ZclFCDirectionClientToServer |
+                                 deCONZ::ZclFCDisableDefaultResponse);
     }
 
+    zclFrame.payload() = payload;
+
     { // ZCL frame
         QDataStream stream(&apsReq.asdu(), QIODevice::WriteOnly);
         stream.setByteOrder(QDataStream::LittleEndian);
         zclFrame.writeToStream(stream);
     }
 
-
-    if (apsCtrl && apsCtrl->apsdeDataRequest(apsReq) == deCONZ::Success)
-    {
-        queryTime = queryTime.addSecs(1);
-        return true;
-    }
-
-    return false;
+    return apsCtrl && apsCtrl->apsdeDataRequest(apsReq) == deCONZ::Success;
 }
 
 /*! Sends a ZCL configure attribute reporting request.
@@ -835,6 +1292,12 @@ bool DeRestPluginPrivate::sendConfigureReportingRequest(BindingTask &bt)
         return false;
     }
 
+    const std::vector<ConfigureReportingRequest> planned = reportingConfigFromTable(bt.restNode, bt.binding.clusterId);
+    if (!planned.empty())
+    {
+        return sendConfigureReportingRequest(bt, planned);
+    }
+
     const QDateTime now = QDateTime::currentDateTime();
     ConfigureReportingRequest rq;
 
@@ -918,113 +1381,6 @@ bool DeRestPluginPrivate::sendConfigureReportingRequest(BindingTask &bt)
         rq.reportableChange16bit = 0xffff;
         return sendConfigureReportingRequest(bt, {rq});
     }
-    else if (bt.binding.clusterId == ILLUMINANCE_MEASUREMENT_CLUSTER_ID)
-    {
-        rq.dataType = deCONZ::Zcl16BitUint;
-        rq.attributeId = 0x0000;         // measured value
-        rq.minInterval = 5;              // value used by Hue bridge
-        rq.maxInterval = 300;            // value used by Hue bridge
-        rq.reportableChange16bit = 2000; // value used by Hue bridge
-        return sendConfigureReportingRequest(bt, {rq});
-    }
-    else if (bt.binding.clusterId == TEMPERATURE_MEASUREMENT_CLUSTER_ID)
-    {
-        rq.dataType = deCONZ::Zcl16BitInt;
-        rq.attributeId = 0x0000;       // measured value
-        rq.minInterval = 10;           // value used by Hue bridge
-        rq.maxInterval = 300;          // value used by Hue bridge
-        rq.reportableChange16bit = 20; // value used by Hue bridge
-        return sendConfigureReportingRequest(bt, {rq});
-    }
-    else if (bt.binding.clusterId == THERMOSTAT_CLUSTER_ID)
-    {
-        Sensor *sensor = dynamic_cast<Sensor *>(bt.restNode);
-
-        if (sensor && sensor->modelId().startsWith(QLatin1String("SPZB"))) // Eurotronic Spirit
-        {
-            rq.dataType = deCONZ::Zcl16BitInt;
-            rq.attributeId = 0x0000;        // Local Temperature
-            rq.minInterval = 1;             // report changes every second
-            rq.maxInterval = 600;           // recommended value
-            rq.reportableChange16bit = 20;  // value from TEMPERATURE_MEASUREMENT_CLUSTER_ID
-
-            ConfigureReportingRequest rq2;
-            rq2.dataType = deCONZ::Zcl8BitUint;
-            rq2.attributeId = 0x0008;        // Pi Heating Demand (valve position %)
-            rq2.minInterval = 1;             // report changes every second
-            rq2.maxInterval = 600;           // recommended value
-            rq2.reportableChange8bit = 1;    // recommended value
-
-            ConfigureReportingRequest rq3;
-            rq3.dataType = deCONZ::Zcl16BitInt;
-            rq3.attributeId = 0x0012;        // Occupied Heating Setpoint - unused
-            rq3.minInterval = 65535;         // disable
-            rq3.maxInterval = 65535;         // disable
-            rq3.reportableChange16bit = 0;   // disable
-
-            ConfigureReportingRequest rq4;
-            rq4.dataType = deCONZ::Zcl16BitInt;
-            rq4.attributeId = 0x0014;        // Unoccupied Heating Setpoint - unused
-            rq4.minInterval = 65535;         // disable
-            rq4.maxInterval = 65535;         // disable
-            rq4.reportableChange16bit = 0;   // disable
-
-            ConfigureReportingRequest rq5;
-            rq5.dataType = deCONZ::Zcl16BitInt;
-            rq5.attributeId = 0x4003;        // Current Temperature Set point
-            rq5.minInterval = 1;             // report changes every second
-            rq5.maxInterval = 600;           // recommended value
-            rq5.reportableChange16bit = 50;  // recommended value
-            rq5.manufacturerCode = VENDOR_JENNIC;
-
-            ConfigureReportingRequest rq6;
-            rq6.dataType = deCONZ::Zcl24BitUint;
-            rq6.attributeId = 0x4008;        // Host Flags
-            rq6.minInterval = 1;             // report changes every second
-            rq6.maxInterval = 600;           // recommended value
-            rq6.reportableChange24bit = 1;   // recommended value
-            rq6.manufacturerCode = VENDOR_JENNIC;
-
-            return sendConfigureReportingRequest(bt, {rq, rq2, rq3, rq4}) ||
-                   sendConfigureReportingRequest(bt, {rq5, rq6});
-        }
-        else
-        {
-            rq.dataType = deCONZ::Zcl16BitInt;
-            rq.attributeId = 0x0000;       // local temperature
-            rq.minInterval = 0;
-            rq.maxInterval = 300;
-            rq.reportableChange16bit = 10;
-            return sendConfigureReportingRequest(bt, {rq});
-        }
-
-    }
-    else if (bt.binding.clusterId == RELATIVE_HUMIDITY_CLUSTER_ID)
-    {
-        rq.dataType = deCONZ::Zcl16BitUint;
-        rq.attributeId = 0x0000;       // measured value
-        rq.minInterval = 10;
-        rq.maxInterval = 300;
-        rq.reportableChange16bit = 100; // resolution: 1%
-        return sendConfigureReportingRequest(bt, {rq});
-    }
-    else if (bt.binding.clusterId == PRESSURE_MEASUREMENT_CLUSTER_ID)
-    {
-        rq.dataType = deCONZ::Zcl16BitUint;
-        rq.attributeId = 0x0000; // measured value
-        rq.minInterval = 10;
-        rq.maxInterval = 300;
-        rq.reportableChange16bit = 20;
-        return sendConfigureReportingRequest(bt, {rq});
-    }
-    else if (bt.binding.clusterId == BINARY_INPUT_CLUSTER_ID)
-    {
-        rq.dataType = deCONZ::ZclBoolean;
-        rq.attributeId = 0x0055; // present value
-        rq.minInterval = 10;
-        rq.maxInterval = 300;
-        return sendConfigureReportingRequest(bt, {rq});
-    }
     else if (bt.binding.clusterId == POWER_CONFIGURATION_CLUSTER_ID)
     {
         Sensor *sensor = dynamic_cast<Sensor *>(bt.restNode);
@@ -1234,15 +1590,6 @@ bool DeRestPluginPrivate::sendConfigureReportingRequest(BindingTask &bt)
         }
         return sendConfigureReportingRequest(bt, {rq});
     }
-    else if (bt.binding.clusterId == FAN_CONTROL_CLUSTER_ID)
-    {
-        rq.dataType = deCONZ::Zcl8BitEnum;
-        rq.attributeId = 0x0000; // fan speed
-        rq.minInterval = 1;
-        rq.maxInterval = 300;
-
-        return sendConfigureReportingRequest(bt, {rq});
-    }
     else if (bt.binding.clusterId == COLOR_CLUSTER_ID)
     {
         rq.dataType = deCONZ::Zcl16BitUint;
@@ -2661,10 +3008,23 @@ void DeRestPluginPrivate::processUbisysC4Configuration(Sensor *sensor)
 
 }
 
-/*! Process binding related tasks queue every one second. */
+/*! Returns the timeout in milliseconds for the next state of a binding task. */
+static qint64 bindingTaskTimeout(const BindingTask &bt)
+{
+    if (bt.restNode && bt.restNode->node() && !bt.restNode->node()->nodeDescriptor().receiverOnWhenIdle())
+    {
+        return BindingTask::TimeoutEndDevice * 1000;
+    }
+    return BindingTask::Timeout * 1000;
+}
+
+/*! Process binding related tasks queue every one second.
+    Timeouts are tracked as deadlines, up to MAX_ACTIVE_BINDING_TASKS bind/unbind
+    requests are kept in flight at the same time.
+ */
 void DeRestPluginPrivate::bindingTimerFired()
 {
-    if (bindingQueue.empty())
+    if (bindingQueue.empty() && reportingConfigChecks.empty())
     {
         return;
     }
@@ -2673,124 +3033,153 @@ void DeRestPluginPrivate::bindingTimerFired()
     if (!q->pluginActive())
     {
         bindingQueue.clear();
+        bindingQueueIndex.clear();
+        reportingConfigChecks.clear();
         return;
     }
 
-    int active = 0;
-    std::list<BindingTask>::iterator i = bindingQueue.begin();
-    std::list<BindingTask>::iterator end = bindingQueue.end();
+    const qint64 now = starttimeRef.elapsed();
 
-    for (; i != end; ++i)
+    // unanswered read reporting configuration, configure without verification
+    for (size_t j = 0; j < reportingConfigChecks.size(); )
     {
-        if (i->state == BindingTask::StateIdle)
+        if (now < reportingConfigChecks[j].deadline)
+        {
+            j++;
+            continue;
+        }
+
+        ReportingConfigCheck chk = reportingConfigChecks[j];
+        reportingConfigChecks[j] = reportingConfigChecks.back();
+        reportingConfigChecks.pop_back();
+
+        BindingTask bt;
+        bt.binding = chk.binding;
+        bt.restNode = getRestNodeForBinding(chk.binding);
+
+        if (!bt.restNode)
+        {
+            continue; // deleted meanwhile
+        }
+
+        const QDateTime timestamp = QDateTime::currentDateTime();
+        for (const ConfigureReportingRequest &rq : chk.requests)
         {
-            if (active >= MAX_ACTIVE_BINDING_TASKS)
-            { /* do nothing */ }
-            else if (sendBindRequest(*i))
+            NodeValue &val = bt.restNode->getZclValue(bt.binding.clusterId, rq.attributeId);
+            if (val.clusterId == bt.binding.clusterId)
             {
-                i->state = BindingTask::StateInProgress;
-                break;
+                val.timestampLastVerified = timestamp; // don't try again
             }
-            else if (i->retries < 5)
+        }
+        sendConfigureReportingFrames(bt, chk.requests);
+    }
+    int active = 0;
+    std::list<BindingTask>::iterator i = bindingQueue.begin();
+
+    // timeouts and cleanup
+    while (i != bindingQueue.end())
+    {
+        std::list<BindingTask>::iterator next = std::next(i);
+
+        if (i->state == BindingTask::StateInProgress && now > i->deadline)
+        {
+            i->retries--;
+            if (i->retries > 0)
             {
-                i->retries++;
+                if (i->restNode && !i->restNode->isAvailable())
+                {
+                    DBG_Printf(DBG_INFO_L2, "giveup binding srcAddr: %llX (not available)\n", i->binding.srcAddress);
+                    i->state = BindingTask::StateFinished;
+                }
+                else
+                {
+                    DBG_Printf(DBG_INFO_L2, "binding/unbinding timeout srcAddr: %llX, retry\n", i->binding.srcAddress);
+                    i->state = BindingTask::StateIdle;
+                }
             }
             else
             {
-                // too harsh?
-                DBG_Printf(DBG_INFO_L2, "failed to send bind/unbind request to 0x%016llX cluster 0x%04X. drop\n", i->binding.srcAddress, i->binding.clusterId);
+                DBG_Printf(DBG_INFO_L2, "giveup binding srcAddr: %llX\n", i->binding.srcAddress);
                 i->state = BindingTask::StateFinished;
             }
         }
-        else if (i->state == BindingTask::StateInProgress)
+        else if (i->state == BindingTask::StateCheck && now > i->deadline)
         {
-            i->timeout--;
-            if (i->timeout < 0)
+            i->retries--;
+            if (i->retries > 0 && i->restNode)
             {
-                i->retries--;
-                if (i->retries > 0)
+                if (i->restNode->mgmtBindSupported())
                 {
-                    if (i->restNode && !i->restNode->isAvailable())
-                    {
-                        DBG_Printf(DBG_INFO_L2, "giveup binding srcAddr: %llX (not available)\n", i->binding.srcAddress);
-                        i->state = BindingTask::StateFinished;
-                    }
-                    else
+                    if (!i->restNode->mustRead(READ_BINDING_TABLE))
                     {
-                        DBG_Printf(DBG_INFO_L2, "binding/unbinding timeout srcAddr: %llX, retry\n", i->binding.srcAddress);
-                        i->state = BindingTask::StateIdle;
-                        i->timeout = BindingTask::Timeout;
-                        if (i->restNode && i->restNode->node() && !i->restNode->node()->nodeDescriptor().receiverOnWhenIdle())
-                        {
-                            i->timeout = BindingTask::TimeoutEndDevice;
-                        }
+                        i->restNode->enableRead(READ_BINDING_TABLE);
+                        i->restNode->setNextReadTime(READ_BINDING_TABLE, queryTime);
+                        queryTime = queryTime.addSecs(5);
                     }
+                    q->startZclAttributeTimer(1000);
+
+                    i->state = BindingTask::StateCheck;
                 }
                 else
                 {
-                    DBG_Printf(DBG_INFO_L2, "giveup binding srcAddr: %llX\n", i->binding.srcAddress);
-                    i->state = BindingTask::StateFinished;
+                    i->state = BindingTask::StateIdle;
                 }
+                i->deadline = now + bindingTaskTimeout(*i);
+
+                DBG_Printf(DBG_INFO_L2, "%s check timeout, retries = %d (srcAddr: 0x%016llX cluster: 0x%04X)\n",
+                           (i->action == BindingTask::ActionBind ? "bind" : "unbind"), i->retries, i->binding.srcAddress, i->binding.clusterId);
+
+                // move to the back, iterators in bindingQueueIndex stay valid
+                bindingQueue.splice(bindingQueue.end(), bindingQueue, i);
             }
             else
             {
-                active++;
+                DBG_Printf(DBG_INFO_L2, "giveup %s (srcAddr: 0x%016llX cluster: 0x%04X)\n",
+                           (i->action == BindingTask::ActionBind ? "bind" : "unbind"), i->binding.srcAddress, i->binding.clusterId);
+                i->state = BindingTask::StateFinished;
             }
         }
-        else if (i->state == BindingTask::StateFinished)
+
+        if (i->state == BindingTask::StateFinished)
         {
+            bindingQueueIndex.remove(i->key());
             bindingQueue.erase(i);
-            break;
         }
-        else if (i->state == BindingTask::StateCheck)
+        else if (i->state == BindingTask::StateInProgress)
         {
-            i->timeout--;
-            if (i->timeout < 0)
-            {
-                i->retries--;
-                if (i->retries > 0 && i->restNode)
-                {
-                    if (i->restNode->mgmtBindSupported())
-                    {
-                        if (!i->restNode->mustRead(READ_BINDING_TABLE))
-                        {
-                            i->restNode->enableRead(READ_BINDING_TABLE);
-                            i->restNode->setNextReadTime(READ_BINDING_TABLE, queryTime);
-                            queryTime = queryTime.addSecs(5);
-                        }
-                        q->startZclAttributeTimer(1000);
+            active++;
+        }
 
-                        i->state = BindingTask::StateCheck;
-                    }
-                    else
-                    {
-                        i->state = BindingTask::StateIdle;
-                    }
-                    i->timeout = BindingTask::Timeout;
-                    if (i->restNode && i->restNode->node() && !i->restNode->node()->nodeDescriptor().receiverOnWhenIdle())
-                    {
-                        i->timeout = BindingTask::TimeoutEndDevice;
-                    }
+        i = next;
+    }
 
-                    DBG_Printf(DBG_INFO_L2, "%s check timeout, retries = %d (srcAddr: 0x%016llX cluster: 0x%04X)\n",
-                               (i->action == BindingTask::ActionBind ? "bind" : "unbind"), i->retries, i->binding.srcAddress, i->binding.clusterId);
+    // start idle tasks
+    for (i = bindingQueue.begin(); i != bindingQueue.end() && active < MAX_ACTIVE_BINDING_TASKS; ++i)
+    {
+        if (i->state != BindingTask::StateIdle)
+        {
+            continue;
+        }
 
-                    bindingQueue.push_back(*i);
-                    bindingQueue.pop_front();
-                    break;
-                }
-                else
-                {
-                    DBG_Printf(DBG_INFO_L2, "giveup binding\n");
-                    DBG_Printf(DBG_INFO_L2, "giveup %s (srcAddr: 0x%016llX cluster: 0x%04X)\n",
-                               (i->action == BindingTask::ActionBind ? "bind" : "unbind"), i->binding.srcAddress, i->binding.clusterId);
-                    i->state = BindingTask::StateFinished;
-                }
-            }
+        if (sendBindRequest(*i))
+        {
+            i->state = BindingTask::StateInProgress;
+            i->deadline = now + bindingTaskTimeout(*i);
+            active++;
+        }
+        else if (i->retries < 5)
+        {
+            i->retries++;
+        }
+        else
+        {
+            // too harsh?
+            DBG_Printf(DBG_INFO_L2, "failed to send bind/unbind request to 0x%016llX cluster 0x%04X. drop\n", i->binding.srcAddress, i->binding.clusterId);
+            i->state = BindingTask::StateFinished;
         }
     }
 
-    if (!bindingQueue.empty())
+    if (!bindingQueue.empty() || !reportingConfigChecks.empty())
     {
         bindingTimer->start(1000);
     }
@@ -2824,75 +3213,45 @@ QString Binding::toString()
 */
 void DeRestPluginPrivate::bindingToRuleTimerFired()
 {
-    if (bindingToRuleQueue.empty())
+    if (bindingToRuleQueue.empty() || !apsCtrl)
     {
         return;
     }
 
-    Binding bnd = bindingToRuleQueue.front();
-    bindingToRuleQueue.pop_front();
+    // process bindings in batches, but keep the event loop responsive
+    QElapsedTimer t;
+    t.start();
 
-    if (!bindingToRuleQueue.empty())
+    while (!bindingToRuleQueue.empty() && t.elapsed() < BINDING_TO_RULE_TIME_BUDGET)
     {
-        bindingToRuleTimer->start();
+        Binding bnd = bindingToRuleQueue.front();
+        bindingToRuleQueue.pop_front();
+        bindingToRule(bnd);
     }
 
-    if (!apsCtrl)
+    if (!bindingToRuleQueue.empty())
     {
-        return;
+        bindingToRuleTimer->start();
     }
+}
 
-    int idx = 0;
-    bool found = false;
-    const deCONZ::Node *node = 0;
-    while (apsCtrl->getNode(idx, &node) == 0)
-    {
-        if (bnd.srcAddress == node->address().ext())
-        {
-            found = true;
-            break;
-        }
-        idx++;
-    }
+/*! Checks if a rule exists for a discovered binding, creates it if needed or
+    removes bindings to non existing clusters and nodes.
+ */
+void DeRestPluginPrivate::bindingToRule(const Binding &bnd)
+{
+    const NodeCacheEntry *src = getNodeCacheEntry(bnd.srcAddress);
 
     // check if cluster does exist
-    if (found && node)
+    if (src && src->node)
     {
-        found = false;
-        for (const deCONZ::SimpleDescriptor &sd : node->simpleDescriptors())
-        {
-            if (sd.endpoint() != bnd.srcEndpoint)
-            {
-                continue;
-            }
-
-            for (const deCONZ::ZclCluster &cl : sd.inClusters())
-            {
-                if (cl.id() == bnd.clusterId)
-                {
-                    found = true;
-                    break;
-                }
-            }
-
-            for (const deCONZ::ZclCluster &cl : sd.outClusters())
-            {
-                if (cl.id() == ILLUMINANCE_MEASUREMENT_CLUSTER_ID && checkMacVendor(node->address(), VENDOR_DDEL))
-                {
-                    continue; // ignore, binding only allowed for server cluster
-                }
+        const quint32 key = (quint32(bnd.srcEndpoint) << 16) | bnd.clusterId;
+        bool found = src->inClusters.contains(key);
 
-                if (cl.id() == bnd.clusterId)
-                {
-                    found = true;
-                    break;
-                }
-            }
-
-            if (found)
-            {
-                break;
-            }
+        if (!found && src->outClusters.contains(key))
+        {
+            // ignore, binding only allowed for server cluster
+            found = !(bnd.clusterId == ILLUMINANCE_MEASUREMENT_CLUSTER_ID && checkMacVendor(src->node->address(), VENDOR_DDEL));
         }
 
         if (!found)
@@ -2915,20 +3274,7 @@ void DeRestPluginPrivate::bindingToRuleTimerFired()
     // check if destination node exist and remove binding if not
     if (bnd.dstAddrMode == deCONZ::ApsExtAddress)
     {
-        idx = 0;
-        found = false;
-        node = nullptr;
-        while (apsCtrl->getNode(idx, &node) == 0)
-        {
-            if (bnd.dstAddress.ext == node->address().ext())
-            {
-                found = true;
-                break;
-            }
-            idx++;
-        }
-
-        if (!found)
+        if (!getNodeCacheEntry(bnd.dstAddress.ext))
         {
             DBG_Printf(DBG_INFO, "remove binding from 0x%016llX cluster 0x%04X to non existing node 0x%016llX\n", bnd.srcAddress, bnd.clusterId, bnd.dstAddress.ext);
             BindingTask bindingTask;
@@ -3256,48 +3602,55 @@ void DeRestPluginPrivate::bindingToRuleTimerFired()
     }
 }
 
-/*! Process ongoing binding table queries.
-*/
-void DeRestPluginPrivate::bindingTableReaderTimerFired()
+/*! Sends a Mgmt_Bind_req for the current index of a binding table reader.
+    \return true if the request was queued
+ */
+bool DeRestPluginPrivate::sendMgmtBindRequest(BindingTableReader &btReader)
 {
-    std::vector<BindingTableReader>::iterator i = bindingTableReaders.begin();
+    deCONZ::ApsDataRequest &apsReq = btReader.apsReq;
 
-    for (; i != bindingTableReaders.end(); )
-    {
-        if (i->state == BindingTableReader::StateIdle)
-        {
-            deCONZ::ApsDataRequest &apsReq = i->apsReq;
+    apsReq.setDstAddressMode(deCONZ::ApsExtAddress);
+    apsReq.setProfileId(ZDP_PROFILE_ID);
+    apsReq.setClusterId(ZDP_MGMT_BIND_REQ_CLID);
+    apsReq.setDstEndpoint(ZDO_ENDPOINT);
+    apsReq.setSrcEndpoint(ZDO_ENDPOINT);
+    apsReq.setTxOptions(0);
+    apsReq.setRadius(0);
+    apsReq.asdu().clear();
 
-            i->apsReq.setDstAddressMode(deCONZ::ApsExtAddress);
-            i->apsReq.setProfileId(ZDP_PROFILE_ID);
-            i->apsReq.setClusterId(ZDP_MGMT_BIND_REQ_CLID);
-            i->apsReq.setDstEndpoint(ZDO_ENDPOINT);
-            i->apsReq.setSrcEndpoint(ZDO_ENDPOINT);
-            i->apsReq.setTxOptions(0);
-            i->apsReq.setRadius(0);
+    QDataStream stream(&apsReq.asdu(), QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::LittleEndian);
 
-            QDataStream stream(&apsReq.asdu(), QIODevice::WriteOnly);
-            stream.setByteOrder(QDataStream::LittleEndian);
+    QTime now = QTime::currentTime();
+    stream << (uint8_t)now.second(); // seqno
+    stream << btReader.index;
+
+    // send
+    if (apsCtrl && apsCtrl->apsdeDataRequest(apsReq) == deCONZ::Success)
+    {
+        DBG_Printf(DBG_ZDP, "Mgmt_Bind_req id: %d to 0x%016llX index %u send\n", apsReq.id(), apsReq.dstAddress().ext(), btReader.index);
+        btReader.time.start();
+        btReader.state = BindingTableReader::StateWaitConfirm;
+        return true;
+    }
 
-            QTime now = QTime::currentTime();
-            stream << (uint8_t)now.second(); // seqno
-            stream << i->index;
+    DBG_Printf(DBG_ZDP, "failed to send Mgmt_Bind_req to 0x%016llX\n", apsReq.dstAddress().ext());
+    return false;
+}
 
-            // send
-            if (apsCtrl && apsCtrl->apsdeDataRequest(apsReq) == deCONZ::Success)
-            {
-                DBG_Printf(DBG_ZDP, "Mgmt_Bind_req id: %d to 0x%016llX send\n", i->apsReq.id(), i->apsReq.dstAddress().ext());
-                i->time.start();
-                i->state = BindingTableReader::StateWaitConfirm;
-                break;
-            }
-            else
-            {
-                DBG_Printf(DBG_ZDP, "failed to send Mgmt_Bind_req to 0x%016llX\n", i->apsReq.dstAddress().ext());
-                i->state = BindingTableReader::StateFinished;
-            }
-        }
-        else if (i->state == BindingTableReader::StateWaitConfirm)
+/*! Process ongoing binding table queries.
+    Up to BindingTableReader::MaxInFlight routers are queried in parallel.
+    End-devices don't count against this limit since their requests wait at
+    the parent, they are queried shortly after the device was heard from.
+*/
+void DeRestPluginPrivate::bindingTableReaderTimerFired()
+{
+    int inFlight = 0;
+
+    // timeouts
+    for (auto i = bindingTableReaders.begin(); i != bindingTableReaders.end(); )
+    {
+        if (i->state == BindingTableReader::StateWaitConfirm)
         {
             if (i->time.elapsed() > BindingTableReader::MaxConfirmTime)
             {
@@ -3318,15 +3671,63 @@ void DeRestPluginPrivate::bindingTableReaderTimerFired()
 
         if (i->state == BindingTableReader::StateFinished)
         {
-            *i = bindingTableReaders.back();
-            bindingTableReaders.pop_back();
+            metrics.increment(QLatin1String("binding_table_reads_total"));
+            i = bindingTableReaders.erase(i);
+            continue;
+        }
+
+        if (!i->isEndDevice && i->state != BindingTableReader::StateIdle)
+        {
+            inFlight++;
+        }
+        ++i;
+    }
+
+    // start queries
+    for (auto i = bindingTableReaders.begin(); i != bindingTableReaders.end(); ++i)
+    {
+        if (i->state != BindingTableReader::StateIdle)
+        {
+            continue;
+        }
+
+        if (i->isEndDevice)
+        {
+            RestNodeBase *node = getSensorNodeForAddress(i->apsReq.dstAddress());
+            if (!node)
+            {
+                node = getLightNodeForAddress(i->apsReq.dstAddress());
+            }
+
+            const bool awake = node && node->lastRx().isValid() &&
+                               node->lastRx().msecsTo(QDateTime::currentDateTime()) < BindingTableReader::EndDeviceAwakeTime;
+
+            if (!awake && i->time.elapsed() < BindingTableReader::MaxEndDeviceDeferTime)
+            {
+                continue; // wait until the device polls its parent
+            }
+        }
+        else if (inFlight >= BindingTableReader::MaxInFlight)
+        {
+            continue;
+        }
+
+        if (sendMgmtBindRequest(*i))
+        {
+            if (!i->isEndDevice)
+            {
+                inFlight++;
+            }
         }
         else
         {
-            ++i;
+            i->state = BindingTableReader::StateFinished; // removed on next run
         }
     }
 
+    metrics.setGauge(QLatin1String("binding_table_readers"), bindingTableReaders.size());
+    metrics.setGauge(QLatin1String("binding_table_readers_in_flight"), inFlight);
+
     if (!bindingTableReaders.empty())
     {
         bindingTableReaderTimer->start();
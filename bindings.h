@@ -61,7 +61,10 @@ public:
     {
         MaxConfirmTime = 10 * 60 * 1000, // 10 min
         MaxResponseTime = 10 * 1000, // 10 sec
-        MaxEndDeviceResponseTime = 60 * 60 * 1000 // 60 min
+        MaxEndDeviceResponseTime = 60 * 60 * 1000, // 60 min
+        MaxInFlight = 4, // concurrent queries to routers
+        EndDeviceAwakeTime = 5 * 1000, // 5 sec, query end-devices only shortly after they were heard
+        MaxEndDeviceDeferTime = 30 * 60 * 1000 // 30 min, query anyway after this time
     };
 
     BindingTableReader() :
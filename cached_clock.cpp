@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2020 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <QAbstractEventDispatcher>
+#include <QElapsedTimer>
+#include "cached_clock.h"
+
+#define CLOCK_MAX_AGE 50 // ms, upper bound if the event loop is busy for a long time
+
+static QElapsedTimer monotonicRef;
+static qint64 sampleTime = -1; // monotonicRef.elapsed() when sampled, -1 if invalid
+static qint64 wallTime = 0;
+static QDateTime localTime;
+static QDateTime utcTime;
+static bool localValid = false;
+static bool utcValid = false;
+
+/*! Samples the clocks if the cache was invalidated or is too old. */
+static void sample()
+{
+    if (!monotonicRef.isValid())
+    {
+        monotonicRef.start();
+    }
+
+    const qint64 now = monotonicRef.elapsed();
+
+    if (sampleTime < 0 || now - sampleTime > CLOCK_MAX_AGE)
+    {
+        sampleTime = now;
+        wallTime = QDateTime::currentMSecsSinceEpoch();
+        localValid = false;
+        utcValid = false;
+    }
+}
+
+/*! Invalidates the cache on each event loop iteration of the calling thread.
+ */
+void CachedClock::install()
+{
+    QAbstractEventDispatcher *dispatcher = QAbstractEventDispatcher::instance();
+
+    if (dispatcher)
+    {
+        QObject::connect(dispatcher, &QAbstractEventDispatcher::awake, &CachedClock::invalidate);
+        QObject::connect(dispatcher, &QAbstractEventDispatcher::aboutToBlock, &CachedClock::invalidate);
+    }
+}
+
+/*! Forces the next access to sample the clocks.
+ */
+void CachedClock::invalidate()
+{
+    sampleTime = -1;
+}
+
+/*! Returns monotonic milliseconds since the clock was first used.
+ */
+qint64 CachedClock::monotonicMs()
+{
+    sample();
+    return sampleTime;
+}
+
+/*! Returns wall clock milliseconds since epoch (UTC).
+ */
+qint64 CachedClock::wallMs()
+{
+    sample();
+    return wallTime;
+}
+
+/*! Returns the cached local time, converted only once per sample.
+ */
+QDateTime CachedClock::currentDateTime()
+{
+    sample();
+    if (!localValid)
+    {
+        localTime = QDateTime::fromMSecsSinceEpoch(wallTime);
+        localValid = true;
+    }
+    return localTime;
+}
+
+/*! Returns the cached UTC time.
+ */
+QDateTime CachedClock::currentDateTimeUtc()
+{
+    sample();
+    if (!utcValid)
+    {
+        utcTime = QDateTime::fromMSecsSinceEpoch(wallTime, Qt::UTC);
+        utcValid = true;
+    }
+    return utcTime;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2020 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef CACHED_CLOCK_H
+#define CACHED_CLOCK_H
+
+#include <QDateTime>
+
+/*! \class CachedClock
+
+    Process wide clock which is sampled at most once per event loop iteration.
+    All timestamps taken while handling one event are equal, and the local time
+    conversion with its time zone lookup is done only once per iteration.
+    To be used from the main thread only.
+ */
+class CachedClock
+{
+public:
+    static void install();
+    static void invalidate();
+    static qint64 monotonicMs();
+    static qint64 wallMs();
+    static QDateTime currentDateTime();
+    static QDateTime currentDateTimeUtc();
+};
+
+#endif // CACHED_CLOCK_H
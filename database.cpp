@@ -8,6 +8,7 @@
  *
  */
 
+#include <QFileInfo>
 #include <QString>
 #include <QStringBuilder>
 #include <QElapsedTimer>
@@ -1845,7 +1846,7 @@ static int sqliteLoadAllScenesCallback(void *user, int ncols, char **colval , ch
             }
             else if (strcmp(colname[i], "lights") == 0)
             {
-                scene.setLights(Scene::jsonToLights(val));
+                scene.setLightsData(val);
             }
         }
     }
@@ -2563,7 +2564,7 @@ static int sqliteLoadSceneCallback(void *user, int ncols, char **colval , char *
             }
             if (strcmp(colname[i], "lights") == 0)
             {
-                scene->setLights(Scene::jsonToLights(colval[i]));
+                scene->setLightsData(QString::fromUtf8(colval[i]));
             }
         }
     }
@@ -4436,7 +4437,6 @@ void DeRestPluginPrivate::saveDb()
                     QString sid;
                     sid.sprintf("0x%02X", si->id);
 
-                    QString lights = Scene::lightsToString(si->lights());
                     QString sql;
 
                     if (si->state == Scene::StateDeleted)
@@ -4446,6 +4446,7 @@ void DeRestPluginPrivate::saveDb()
                     }
                     else
                     {
+                        const QString lights = si->lightsData();
                         sql = QString(QLatin1String("REPLACE INTO scenes (gsid, gid, sid, name, transitiontime, lights) VALUES ('%1', '%2', '%3', '%4', '%5', '%6')"))
                             .arg(gsid)
                             .arg(gid)
@@ -4772,6 +4773,8 @@ void DeRestPluginPrivate::saveDb()
     if (rc == SQLITE_OK)
     {
         DBG_Printf(DBG_INFO_L2, "DB saved in %ld ms\n", measTimer.elapsed());
+        metrics.record(QLatin1String("db_save_duration_us"), measTimer.nsecsElapsed() / 1000);
+        metrics.setGauge(QLatin1String("db_file_bytes"), QFileInfo(sqliteDatabaseName).size());
 
         if (saveDatabaseItems & DB_SYNC)
         {
@@ -4780,6 +4783,7 @@ void DeRestPluginPrivate::saveDb()
             measTimer.restart();
             sync();
             DBG_Printf(DBG_INFO_L2, "sync() in %d ms\n", int(measTimer.elapsed()));
+            metrics.record(QLatin1String("db_sync_duration_us"), measTimer.nsecsElapsed() / 1000);
 #endif
             saveDatabaseItems &= ~DB_SYNC;
         }
@@ -35,6 +35,12 @@ greaterThan(QT_MAJOR_VERSION, 4) {
 
 QMAKE_SPEC_T = $$[QMAKE_SPEC]
 
+# Simulated traffic and APS trace replay inject frames into the plugin,
+# they are only built into debug builds configured with: qmake CONFIG+=simulation
+CONFIG(debug, debug|release):simulation {
+    DEFINES += DECONZ_SIMULATION
+}
+
 contains(QMAKE_SPEC_T,.*linux.*) {
     CONFIG += link_pkgconfig
     packagesExist(sqlite3) {
@@ -85,10 +91,12 @@ DEFINES += GW_DEFAULT_NAME=\\\"Phoscon-GW\\\"
 
 QMAKE_CXXFLAGS += -Wno-attributes
 
-HEADERS  = bindings.h \
+HEADERS  = aps_trace.h \
+           bindings.h \
            connectivity.h \
            colorspace.h \
            daylight.h \
+           cached_clock.h \
            de_web_plugin.h \
            de_web_plugin_private.h \
            de_web_widget.h \
@@ -99,18 +107,25 @@ HEADERS  = bindings.h \
            group_info.h \
            json.h \
            light_node.h \
+           metrics.h \
            poll_manager.h \
            resource.h \
            resourcelinks.h \
            rest_devices.h \
            rest_node_base.h \
+           rest_router.h \
            rule.h \
            scene.h \
            sensor.h \
-           websocket_server.h
+           webhook_dispatcher.h \
+           websocket_server.h \
+           zcl_builder.h
 
 SOURCES  = authorisation.cpp \
+           aps_simulation.cpp \
+           aps_trace.cpp \
            bindings.cpp \
+           cached_clock.cpp \
            change_channel.cpp \
            connectivity.cpp \
            colorspace.cpp \
@@ -132,6 +147,7 @@ SOURCES  = authorisation.cpp \
            ias_zone.cpp \
            json.cpp \
            light_node.cpp \
+           metrics.cpp \
            poll_manager.cpp \
            resource.cpp \
            resourcelinks.cpp \
@@ -142,12 +158,14 @@ SOURCES  = authorisation.cpp \
            rest_lights.cpp \
            rest_node_base.cpp \
            rest_resourcelinks.cpp \
+           rest_router.cpp \
            rest_rules.cpp \
            rest_sensors.cpp \
            rest_schedules.cpp \
            rest_touchlink.cpp \
            rest_scenes.cpp \
            rest_info.cpp \
+           rest_metrics.cpp \
            rest_capabilities.cpp \
            rule.cpp \
            upnp.cpp \
@@ -160,6 +178,7 @@ SOURCES  = authorisation.cpp \
            rest_userparameter.cpp \
            zcl_tasks.cpp \
            window_covering.cpp \
+           webhook_dispatcher.cpp \
            websocket_server.cpp
 
 win32 {
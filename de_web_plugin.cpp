@@ -57,6 +57,7 @@ const char *HttpContentJS          = "text/javascript";
 const char *HttpContentPNG         = "image/png";
 const char *HttpContentJPG         = "image/jpg";
 const char *HttpContentSVG         = "image/svg+xml";
+const char *HttpContentPrometheus  = "text/plain; version=0.0.4; charset=utf-8";
 
 static int checkZclAttributesDelay = 750;
 //static int ReadAttributesLongDelay = 5000;
@@ -232,6 +233,7 @@ DeRestPluginPrivate::DeRestPluginPrivate(QObject *parent) :
 {
     pollManager = new PollManager(this);
     restDevices = new RestDevices(this);
+    initRestRouter();
 
     databaseTimer = new QTimer(this);
     databaseTimer->setSingleShot(true);
@@ -245,6 +247,8 @@ DeRestPluginPrivate::DeRestPluginPrivate(QObject *parent) :
     webSocketServer = 0;
 
     gwScanner = new GatewayScanner(this);
+    gwScanner->setMaxInFlight(deCONZ::appArgumentNumeric("--gw-scan-window", 32));
+    gwScanner->setProbeTimeout(deCONZ::appArgumentNumeric("--gw-scan-timeout", 200));
     connect(gwScanner, SIGNAL(foundGateway(QHostAddress,quint16,QString,QString)),
             this, SLOT(foundGateway(QHostAddress,quint16,QString,QString)));
     gwScanner->startScan();
@@ -265,6 +269,11 @@ DeRestPluginPrivate::DeRestPluginPrivate(QObject *parent) :
     udpSock = 0;
     haEndpoint = 0;
     gwGroupSendDelay = deCONZ::appArgumentNumeric("--group-delay", GROUP_SEND_DELAY);
+    gwGroupFusionWindow = deCONZ::appArgumentNumeric("--group-fusion-window", GROUP_FUSION_WINDOW);
+    if (gwGroupFusionWindow < 0 || gwGroupFusionWindow > MAX_GROUP_SEND_DELAY)
+    {
+        gwGroupFusionWindow = GROUP_FUSION_WINDOW;
+    }
     supportColorModeXyForGroups = true;
     groupDeviceMembershipChecked = false;
     gwLinkButton = false;
@@ -286,6 +295,10 @@ DeRestPluginPrivate::DeRestPluginPrivate(QObject *parent) :
 
     // starttime reference counts from here
     starttimeRef.start();
+    CachedClock::install();
+    apsIndicationStartUs = 0;
+    buttonEventStartUs = 0;
+    ruleTriggerStartUs = 0;
 
     initConfig();
 
@@ -299,9 +312,21 @@ DeRestPluginPrivate::DeRestPluginPrivate(QObject *parent) :
     gwAnnounceUrl = "http://dresden-light.appspot.com/discover";
     inetDiscoveryManager = 0;
 
-    webhookManager = new QNetworkAccessManager(this);
-    connect(webhookManager, SIGNAL(finished(QNetworkReply*)),
-            this, SLOT(webhookFinishedRequest(QNetworkReply*)));
+    metricApsIndications = metrics.counter(QLatin1String("aps_indications_total"));
+    metricApsIndicationDuration = metrics.histogram(QLatin1String("aps_indication_duration_us"));
+    metricTaskQueueDepth = metrics.gauge(QLatin1String("task_queue_depth"));
+    metricTaskRunning = metrics.gauge(QLatin1String("task_running"));
+    metricTaskQueueTime = metrics.histogram(QLatin1String("task_queue_time_ms"));
+    metricButtonToApsRequest = metrics.histogram(QLatin1String("button_to_aps_request_us"));
+    metricEvents = metrics.counter(QLatin1String("events_total"));
+    metricEventQueueDepth = metrics.gauge(QLatin1String("event_queue_depth"));
+    metricTaskPoolReused = metrics.counter(QLatin1String("task_pool_reused_total"));
+    metricPollSkippedReporting = metrics.counter(QLatin1String("poll_skipped_reporting_total"));
+    metricPolls = metrics.counter(QLatin1String("polls_total"));
+
+    webhookDispatcher = new WebhookDispatcher(this);
+    webhookDispatcher->setMetrics(&metrics);
+    webhookDispatcher->setBatchWindow(deCONZ::appArgumentNumeric("--webhook-batch-window", 0));
 
     // lights
     searchLightsState = SearchLightsIdle;
@@ -444,6 +469,8 @@ DeRestPluginPrivate::DeRestPluginPrivate(QObject *parent) :
     connect(lockGatewayTimer, SIGNAL(timeout()),
             this, SLOT(lockGatewayTimerFired()));
 
+    openClientTicks = 0;
+    openClientSerial = 0;
     openClientTimer = new QTimer(this);
     openClientTimer->setSingleShot(false);
     connect(openClientTimer, SIGNAL(timeout()),
@@ -452,6 +479,7 @@ DeRestPluginPrivate::DeRestPluginPrivate(QObject *parent) :
 
     quint16 wsPort = deCONZ::appArgumentNumeric(QLatin1String("--ws-port"), gwConfig["websocketport"].toUInt());
     webSocketServer = new WebSocketServer(this, wsPort);
+    webSocketServer->setMetrics(&metrics);
     gwConfig["websocketport"] = webSocketServer->port();
 
     initNetworkInfo();
@@ -466,6 +494,10 @@ DeRestPluginPrivate::DeRestPluginPrivate(QObject *parent) :
     initChangeChannelApi();
     initResetDeviceApi();
     initFirmwareUpdate();
+#ifdef DECONZ_SIMULATION
+    initSimulation();
+#endif
+    initApsTrace();
     //restoreWifiState();
     indexRulesTriggers();
 
@@ -498,6 +530,15 @@ void DeRestPluginPrivate::apsdeDataIndication(const deCONZ::ApsDataIndication &i
         return;
     }
 
+    metrics.increment(metricApsIndications);
+    MetricsTimer timer(&metrics, metricApsIndicationDuration);
+    apsIndicationStartUs = starttimeRef.nsecsElapsed() / 1000;
+
+    if (apsTraceWriter.isOpen())
+    {
+        apsTraceWriter.write(ind);
+    }
+
     if ((ind.profileId() == HA_PROFILE_ID) || (ind.profileId() == ZLL_PROFILE_ID))
     {
         deCONZ::ZclFrame zclFrame;
@@ -640,6 +681,10 @@ void DeRestPluginPrivate::apsdeDataIndication(const deCONZ::ApsDataIndication &i
         {
             handleZclConfigureReportingResponseIndication(ind, zclFrame);
         }
+        else if (zclFrame.isProfileWideCommand() && zclFrame.commandId() == deCONZ::ZclReadReportingConfigResponseId)
+        {
+            handleZclReadReportingConfigResponseIndication(ind, zclFrame);
+        }
     }
     else if (ind.profileId() == ZDP_PROFILE_ID)
     {
@@ -712,6 +757,11 @@ void DeRestPluginPrivate::apsdeDataIndication(const deCONZ::ApsDataIndication &i
  */
 void DeRestPluginPrivate::apsdeDataConfirm(const deCONZ::ApsDataConfirm &conf)
 {
+    if (apsTraceWriter.isOpen())
+    {
+        apsTraceWriter.write(conf);
+    }
+
     pollManager->apsdeDataConfirm(conf);
 
     std::list<TaskItem>::iterator i = runningTasks.begin();
@@ -810,7 +860,7 @@ void DeRestPluginPrivate::apsdeDataConfirm(const deCONZ::ApsDataConfirm &conf)
             DBG_Printf(DBG_INFO_L2, "Erase task req-id: %u, type: %d zcl seqno: %u send time %d, profileId: 0x%04X, clusterId: 0x%04X\n",
                        task.req.id(), task.taskType, task.zclFrame.sequenceNumber(), idleTotalCounter - task.sendTime, task.req.profileId(), task.req.clusterId());
         }
-        runningTasks.erase(i);
+        recycleTask(runningTasks, i);
         processTasks();
         break;
     }
@@ -1843,6 +1893,8 @@ void DeRestPluginPrivate::setLightNodeStaticCapabilities(LightNode *lightNode)
         item = lightNode->item(RStateY);
         if (item) { item->setIsPublic(false); }
     }
+
+    lightNode->invalidateCapabilities();
 }
 
 /*! Force polling if the node has updated simple descriptors in setup phase.
@@ -2319,6 +2371,7 @@ LightNode *DeRestPluginPrivate::updateLightNode(const deCONZ::NodeEvent &event)
                         {
                             lightNode->setNeedSaveDatabase(true);
                             item->setValue(cap);
+                            lightNode->invalidateCapabilities();
                             Event e(RLights, RConfigColorCapabilities, lightNode->id(), item);
                             enqueueEvent(e);
                             updated = true;
@@ -2333,6 +2386,7 @@ LightNode *DeRestPluginPrivate::updateLightNode(const deCONZ::NodeEvent &event)
                         {
                             item->setValue(cap);
                             lightNode->setNeedSaveDatabase(true);
+                            lightNode->invalidateCapabilities();
                             Event e(RLights, RConfigCtMin, lightNode->id(), item);
                             enqueueEvent(e);
                             updated = true;
@@ -2347,6 +2401,7 @@ LightNode *DeRestPluginPrivate::updateLightNode(const deCONZ::NodeEvent &event)
                         {
                             item->setValue(cap);
                             lightNode->setNeedSaveDatabase(true);
+                            lightNode->invalidateCapabilities();
                             Event e(RLights, RConfigCtMax, lightNode->id(), item);
                             enqueueEvent(e);
                             updated = true;
@@ -2876,8 +2931,7 @@ void DeRestPluginPrivate::checkSensorButtonEvent(Sensor *sensor, const deCONZ::A
 
     bool checkReporting = false;
     bool checkClientCluster = false;
-    const Sensor::ButtonMap *buttonMap = sensor->buttonMap();
-    if (!buttonMap)
+    if (!sensor->buttonMap())
     {
         quint8 pl0 = zclFrame.payload().isEmpty() ? 0 : zclFrame.payload().at(0);
         DBG_Printf(DBG_INFO, "no button map for: %s ep: 0x%02X cl: 0x%04X cmd: 0x%02X pl[0]: 0%02X\n",
@@ -2886,9 +2940,11 @@ void DeRestPluginPrivate::checkSensorButtonEvent(Sensor *sensor, const deCONZ::A
     }
 
     checkInstaModelId(sensor);
+    const Sensor::ButtonHandling buttonHandling = sensor->buttonHandling();
+    const int buttonFlags = sensor->buttonFlags();
 
     // DE Lighting Switch: probe for mode changes
-    if (sensor->modelId() == QLatin1String("Lighting Switch") && ind.dstAddressMode() == deCONZ::ApsGroupAddress)
+    if (buttonHandling == Sensor::ButtonHandlingDeLightingSwitch && ind.dstAddressMode() == deCONZ::ApsGroupAddress)
     {
         Sensor::SensorMode mode = sensor->mode();
 
@@ -2929,11 +2985,11 @@ void DeRestPluginPrivate::checkSensorButtonEvent(Sensor *sensor, const deCONZ::A
         }
     }
     // Busch-Jaeger
-    else if (sensor->modelId() == QLatin1String("RM01") || sensor->modelId() == QLatin1String("RB01"))
+    else if (buttonHandling == Sensor::ButtonHandlingBuschJaeger)
     {
         // setup during add sensor
     }
-    else if (sensor->modelId() == QLatin1String("TRADFRI remote control"))
+    else if (buttonHandling == Sensor::ButtonHandlingIkeaRemote)
     {
         checkReporting = true;
         if (sensor->mode() != Sensor::ModeColorTemperature) // only supported mode yet
@@ -2942,14 +2998,14 @@ void DeRestPluginPrivate::checkSensorButtonEvent(Sensor *sensor, const deCONZ::A
             updateSensorEtag(sensor);
         }
     }
-    else if (sensor->modelId() == QLatin1String("TRADFRI wireless dimmer"))
+    else if (buttonHandling == Sensor::ButtonHandlingIkeaDimmer)
     {
         if (sensor->mode() != Sensor::ModeDimmer)
         {
             sensor->setMode(Sensor::ModeDimmer);
         }
     }
-    else if (sensor->modelId() == QLatin1String("TRADFRI on/off switch"))
+    else if (buttonHandling == Sensor::ButtonHandlingIkeaOnOff)
     {
         checkReporting = true;
 
@@ -2964,11 +3020,11 @@ void DeRestPluginPrivate::checkSensorButtonEvent(Sensor *sensor, const deCONZ::A
             }
         }
     }
-    else if (sensor->modelId() == QLatin1String("TRADFRI motion sensor"))
+    else if (buttonHandling == Sensor::ButtonHandlingIkeaMotion)
     {
         checkReporting = true;
     }
-    else if (sensor->modelId().startsWith(QLatin1String("RWL02"))) // Hue dimmer switch
+    else if (buttonHandling == Sensor::ButtonHandlingHueDimmer) // Hue dimmer switch
     {
         checkReporting = true;
     }
@@ -2988,7 +3044,7 @@ void DeRestPluginPrivate::checkSensorButtonEvent(Sensor *sensor, const deCONZ::A
 
         quint16 groupId = ind.dstAddress().group();
 
-        if (sensor->modelId() == QLatin1String("Lighting Switch"))
+        if (buttonHandling == Sensor::ButtonHandlingDeLightingSwitch)
         {
             // adjust groupId for endpoints
             // ep 1: <gid>
@@ -3010,7 +3066,7 @@ void DeRestPluginPrivate::checkSensorButtonEvent(Sensor *sensor, const deCONZ::A
             gids = item->toString().split(',');
         }
 
-        if (sensor->manufacturer() == QLatin1String("ubisys"))
+        if (buttonFlags & Sensor::ButtonFlagUbisys)
         {
             // TODO
         }
@@ -3056,238 +3112,234 @@ void DeRestPluginPrivate::checkSensorButtonEvent(Sensor *sensor, const deCONZ::A
     }
 
     bool ok = false;
-    while (buttonMap->mode != Sensor::ModeNone && !ok)
+    const std::vector<const Sensor::ButtonMap*> *buttonMaps = sensor->buttonMapEntries(ind.srcEndpoint(), ind.clusterId(), zclFrame.commandId());
+    for (size_t bi = 0; buttonMaps && bi < buttonMaps->size() && !ok; bi++)
     {
-        if (buttonMap->mode == sensor->mode() &&
-            buttonMap->endpoint == ind.srcEndpoint() &&
-            buttonMap->clusterId == ind.clusterId() &&
-            buttonMap->zclCommandId == zclFrame.commandId())
+        const Sensor::ButtonMap *buttonMap = (*buttonMaps)[bi];
+        ok = true;
+
+        if (zclFrame.isProfileWideCommand() &&
+            zclFrame.commandId() == deCONZ::ZclReportAttributesId &&
+            zclFrame.payload().size() >= 4)
         {
-            ok = true;
+            QDataStream stream(zclFrame.payload());
+            stream.setByteOrder(QDataStream::LittleEndian);
+            quint16 attrId;
+            quint8 dataType;
+            stream >> attrId;
+            stream >> dataType;
 
-            if (zclFrame.isProfileWideCommand() &&
-                zclFrame.commandId() == deCONZ::ZclReportAttributesId &&
-                zclFrame.payload().size() >= 4)
+            // Xiaomi
+            if (ind.clusterId() == ONOFF_CLUSTER_ID && (buttonFlags & Sensor::ButtonFlagLumi))
             {
-                QDataStream stream(zclFrame.payload());
-                stream.setByteOrder(QDataStream::LittleEndian);
-                quint16 attrId;
-                quint8 dataType;
-                stream >> attrId;
-                stream >> dataType;
+                ok = false;
+                const quint16 pl3 = static_cast<quint16>(zclFrame.payload().at(3)) & 0xff;
+                // payload: u16 attrId, u8 datatype, u8 data
+                if (attrId == 0x0000 && dataType == 0x10 && // onoff attribute
+                    buttonMap->zclParam0 == pl3)
+                {
+                    ok = true;
+                }
+                else if (attrId == 0x8000 && dataType == 0x20 && // custom attribute for multi press
+                    buttonMap->zclParam0 == pl3)
+                {
+                    ok = true;
+                }
 
-                // Xiaomi
-                if (ind.clusterId() == ONOFF_CLUSTER_ID && sensor->manufacturer() == QLatin1String("LUMI"))
+                // the round button (lumi.sensor_switch) sends a release command regardless if it is a short press or a long release
+                // figure it out here to decide if it is a short release (1002) or a long release (1003)
+                if (ok && (buttonFlags & Sensor::ButtonFlagLumiSwitch))
                 {
-                    ok = false;
-                    const quint16 pl3 = static_cast<quint16>(zclFrame.payload().at(3)) & 0xff;
-                    // payload: u16 attrId, u8 datatype, u8 data
-                    if (attrId == 0x0000 && dataType == 0x10 && // onoff attribute
-                        buttonMap->zclParam0 == pl3)
-                    {
-                        ok = true;
-                    }
-                    else if (attrId == 0x8000 && dataType == 0x20 && // custom attribute for multi press
-                        buttonMap->zclParam0 == pl3)
+                    const QDateTime now = QDateTime::currentDateTime();
+
+                    if (buttonMap->button == (S_BUTTON_1 + S_BUTTON_ACTION_INITIAL_PRESS))
                     {
-                        ok = true;
+                        sensor->durationDue = now.addMSecs(500); // enable generation of 1001 (hold)
+                        checkSensorsTimer->start(CHECK_SENSOR_FAST_INTERVAL);
                     }
-
-                    // the round button (lumi.sensor_switch) sends a release command regardless if it is a short press or a long release
-                    // figure it out here to decide if it is a short release (1002) or a long release (1003)
-                    if (ok && sensor->modelId() == QLatin1String("lumi.sensor_switch"))
+                    else if (buttonMap->button == (S_BUTTON_1 + S_BUTTON_ACTION_SHORT_RELEASED))
                     {
-                        const QDateTime now = QDateTime::currentDateTime();
+                        sensor->durationDue = QDateTime(); // disable generation of 1001 (hold)
 
-                        if (buttonMap->button == (S_BUTTON_1 + S_BUTTON_ACTION_INITIAL_PRESS))
-                        {
-                            sensor->durationDue = now.addMSecs(500); // enable generation of 1001 (hold)
-                            checkSensorsTimer->start(CHECK_SENSOR_FAST_INTERVAL);
-                        }
-                        else if (buttonMap->button == (S_BUTTON_1 + S_BUTTON_ACTION_SHORT_RELEASED))
+                        ResourceItem *item = sensor->item(RStateButtonEvent);
+                        if (item && (item->toNumber() == (S_BUTTON_1 + S_BUTTON_ACTION_INITIAL_PRESS) ||
+                                     item->toNumber() == (S_BUTTON_1 + S_BUTTON_ACTION_HOLD)))
                         {
-                            sensor->durationDue = QDateTime(); // disable generation of 1001 (hold)
-
-                            ResourceItem *item = sensor->item(RStateButtonEvent);
-                            if (item && (item->toNumber() == (S_BUTTON_1 + S_BUTTON_ACTION_INITIAL_PRESS) ||
-                                         item->toNumber() == (S_BUTTON_1 + S_BUTTON_ACTION_HOLD)))
+                            if (item->toNumber() == (S_BUTTON_1 + S_BUTTON_ACTION_HOLD) || // hold already triggered -> long release
+                                item->lastSet().msecsTo(now) > 400) // over 400 ms since initial press? -> long release
                             {
-                                if (item->toNumber() == (S_BUTTON_1 + S_BUTTON_ACTION_HOLD) || // hold already triggered -> long release
-                                    item->lastSet().msecsTo(now) > 400) // over 400 ms since initial press? -> long release
-                                {
-                                    ok = false; // force long release button event
-                                }
+                                ok = false; // force long release button event
                             }
                         }
                     }
                 }
-                else if (ind.clusterId() == DOOR_LOCK_CLUSTER_ID && sensor->manufacturer() == QLatin1String("LUMI"))
-                {
-                    ok = false;
-                    if (attrId == 0x0055 && dataType == 0x21 && // Xiaomi non-standard attribute
-                        buttonMap->zclParam0 == zclFrame.payload().at(3))
-                    {
-                        ok = true;
-                    }
-                }
-            }
-            else if (zclFrame.isProfileWideCommand())
-            {
             }
-            else if (ind.clusterId() == SCENE_CLUSTER_ID && zclFrame.commandId() == 0x05) // recall scene
+            else if (ind.clusterId() == DOOR_LOCK_CLUSTER_ID && (buttonFlags & Sensor::ButtonFlagLumi))
             {
-                ok = false; // payload: groupId, sceneId
-                if (zclFrame.payload().size() >= 3 && buttonMap->zclParam0 == zclFrame.payload().at(2))
+                ok = false;
+                if (attrId == 0x0055 && dataType == 0x21 && // Xiaomi non-standard attribute
+                    buttonMap->zclParam0 == zclFrame.payload().at(3))
                 {
                     ok = true;
                 }
             }
-            else if (ind.clusterId() == SCENE_CLUSTER_ID &&
-                     sensor->modelId().startsWith(QLatin1String("TRADFRI"))) // IKEA non-standard scene
+        }
+        else if (zclFrame.isProfileWideCommand())
+        {
+        }
+        else if (ind.clusterId() == SCENE_CLUSTER_ID && zclFrame.commandId() == 0x05) // recall scene
+        {
+            ok = false; // payload: groupId, sceneId
+            if (zclFrame.payload().size() >= 3 && buttonMap->zclParam0 == zclFrame.payload().at(2))
             {
-                ok = false;
-                if (zclFrame.commandId() == 0x07 || // short release
-                    zclFrame.commandId() == 0x08)   // hold
-                {
-                    if (zclFrame.payload().size() >= 1 && buttonMap->zclParam0 == zclFrame.payload().at(0)) // next, prev scene
-                    {
-                        sensor->previousDirection = buttonMap->zclParam0;
-                        ok = true;
-                    }
-                }
-                else if (zclFrame.commandId() == 0x09) // long release
-                {
-                    if (buttonMap->zclParam0 == sensor->previousDirection)
-                    {
-                        sensor->previousDirection = 0xFF;
-                        ok = true;
-                    }
-                }
+                ok = true;
             }
-            else if (ind.clusterId() == VENDOR_CLUSTER_ID && zclFrame.manufacturerCode() == VENDOR_PHILIPS && zclFrame.commandId() == 0x00) // Philips dimmer switch non-standard
+        }
+        else if (ind.clusterId() == SCENE_CLUSTER_ID &&
+                 (buttonFlags & Sensor::ButtonFlagTradfri)) // IKEA non-standard scene
+        {
+            ok = false;
+            if (zclFrame.commandId() == 0x07 || // short release
+                zclFrame.commandId() == 0x08)   // hold
             {
-                ok = false;
-                if (zclFrame.payload().size() >= 8)
+                if (zclFrame.payload().size() >= 1 && buttonMap->zclParam0 == zclFrame.payload().at(0)) // next, prev scene
                 {
-                    deCONZ::NumericUnion val = {0};
-                    val.u8 = zclFrame.payload().at(0) << 4 /*button*/ | zclFrame.payload().at(4); // action
-                    if (buttonMap->zclParam0 == val.u8)
-                    {
-                        ok = true;
-                        sensor->setZclValue(NodeValue::UpdateByZclReport, VENDOR_CLUSTER_ID, 0x0000, val);
-                    }
+                    sensor->previousDirection = buttonMap->zclParam0;
+                    ok = true;
                 }
             }
-            else if (ind.clusterId() == LEVEL_CLUSTER_ID &&
-                     (zclFrame.commandId() == 0x01 ||  // move
-                      zclFrame.commandId() == 0x02 ||  // step
-                      zclFrame.commandId() == 0x04 ||  // move to level (with on/off)
-                      zclFrame.commandId() == 0x05 ||  // move (with on/off)
-                      zclFrame.commandId() == 0x06))   // step (with on/off)
+            else if (zclFrame.commandId() == 0x09) // long release
             {
-                ok = false;
-                if (zclFrame.payload().size() >= 1 && buttonMap->zclParam0 == zclFrame.payload().at(0)) // direction
+                if (buttonMap->zclParam0 == sensor->previousDirection)
                 {
-                    sensor->previousDirection = zclFrame.payload().at(0);
+                    sensor->previousDirection = 0xFF;
                     ok = true;
                 }
             }
-            else if (ind.clusterId() == LEVEL_CLUSTER_ID &&
-                       (zclFrame.commandId() == 0x03 ||  // stop
-                        zclFrame.commandId() == 0x07) )  // stop (with on/off)
+        }
+        else if (ind.clusterId() == VENDOR_CLUSTER_ID && zclFrame.manufacturerCode() == VENDOR_PHILIPS && zclFrame.commandId() == 0x00) // Philips dimmer switch non-standard
+        {
+            ok = false;
+            if (zclFrame.payload().size() >= 8)
             {
-                ok = false;
-                if (buttonMap->zclParam0 == sensor->previousDirection) // direction of previous move/step
+                deCONZ::NumericUnion val = {0};
+                val.u8 = zclFrame.payload().at(0) << 4 /*button*/ | zclFrame.payload().at(4); // action
+                if (buttonMap->zclParam0 == val.u8)
                 {
-                    sensor->previousDirection = 0xFF;
                     ok = true;
+                    sensor->setZclValue(NodeValue::UpdateByZclReport, VENDOR_CLUSTER_ID, 0x0000, val);
                 }
             }
-            else if (ind.clusterId() == COLOR_CLUSTER_ID &&
-                     (zclFrame.commandId() == 0x4b && zclFrame.payload().size() >= 7) )  // move to color temperature
+        }
+        else if (ind.clusterId() == LEVEL_CLUSTER_ID &&
+                 (zclFrame.commandId() == 0x01 ||  // move
+                  zclFrame.commandId() == 0x02 ||  // step
+                  zclFrame.commandId() == 0x04 ||  // move to level (with on/off)
+                  zclFrame.commandId() == 0x05 ||  // move (with on/off)
+                  zclFrame.commandId() == 0x06))   // step (with on/off)
+        {
+            ok = false;
+            if (zclFrame.payload().size() >= 1 && buttonMap->zclParam0 == zclFrame.payload().at(0)) // direction
+            {
+                sensor->previousDirection = zclFrame.payload().at(0);
+                ok = true;
+            }
+        }
+        else if (ind.clusterId() == LEVEL_CLUSTER_ID &&
+                   (zclFrame.commandId() == 0x03 ||  // stop
+                    zclFrame.commandId() == 0x07) )  // stop (with on/off)
+        {
+            ok = false;
+            if (buttonMap->zclParam0 == sensor->previousDirection) // direction of previous move/step
             {
-                ok = false;
-                // u8 move mode
-                // u16 rate
-                // u16 ctmin = 0
-                // u16 ctmax = 0
-                quint8 moveMode = zclFrame.payload().at(0);
-                quint16 param = moveMode;
+                sensor->previousDirection = 0xFF;
+                ok = true;
+            }
+        }
+        else if (ind.clusterId() == COLOR_CLUSTER_ID &&
+                 (zclFrame.commandId() == 0x4b && zclFrame.payload().size() >= 7) )  // move to color temperature
+        {
+            ok = false;
+            // u8 move mode
+            // u16 rate
+            // u16 ctmin = 0
+            // u16 ctmax = 0
+            quint8 moveMode = zclFrame.payload().at(0);
+            quint16 param = moveMode;
 
-                if (moveMode == 0x01 || moveMode == 0x03)
-                {
-                    sensor->previousDirection = moveMode;
-                }
-                else if (moveMode == 0x00)
-                {
-                    param = sensor->previousDirection;
-                    param <<= 4;
-                }
+            if (moveMode == 0x01 || moveMode == 0x03)
+            {
+                sensor->previousDirection = moveMode;
+            }
+            else if (moveMode == 0x00)
+            {
+                param = sensor->previousDirection;
+                param <<= 4;
+            }
 
-                // byte-2 most likely 0, but include anyway
-                param |= (quint16)zclFrame.payload().at(2) & 0xff;
-                param <<= 8;
-                param |= (quint16)zclFrame.payload().at(1) & 0xff;
+            // byte-2 most likely 0, but include anyway
+            param |= (quint16)zclFrame.payload().at(2) & 0xff;
+            param <<= 8;
+            param |= (quint16)zclFrame.payload().at(1) & 0xff;
 
-                if (buttonMap->zclParam0 == param)
+            if (buttonMap->zclParam0 == param)
+            {
+                if (moveMode == 0x00)
                 {
-                    if (moveMode == 0x00)
-                    {
-                        sensor->previousDirection = 0xFF;
-                    }
-                    ok = true;
+                    sensor->previousDirection = 0xFF;
                 }
+                ok = true;
             }
+        }
 
-            if (ok)
+        if (ok)
+        {
+            DBG_Printf(DBG_INFO, "button %u %s\n", buttonMap->button, buttonMap->name);
+            ResourceItem *item = sensor->item(RStateButtonEvent);
+            if (item)
             {
-                DBG_Printf(DBG_INFO, "button %u %s\n", buttonMap->button, buttonMap->name);
-                ResourceItem *item = sensor->item(RStateButtonEvent);
-                if (item)
+                if (item->toNumber() == buttonMap->button)
                 {
-                    if (item->toNumber() == buttonMap->button)
-                    {
-                        QDateTime now = QDateTime::currentDateTime();
-                        const auto dt = item->lastSet().msecsTo(now);
+                    QDateTime now = QDateTime::currentDateTime();
+                    const auto dt = item->lastSet().msecsTo(now);
 
-                        if (dt > 0 && dt < 500)
-                        {
-                            DBG_Printf(DBG_INFO, "button %u %s, discard too fast event (dt = %d)\n", buttonMap->button, buttonMap->name, dt);
-                            break;
-                        }
+                    if (dt > 0 && dt < 500)
+                    {
+                        DBG_Printf(DBG_INFO, "button %u %s, discard too fast event (dt = %d)\n", buttonMap->button, buttonMap->name, dt);
+                        break;
                     }
+                }
 
-                    item->setValue(buttonMap->button);
+                item->setValue(buttonMap->button);
+                buttonEventStartUs = apsIndicationStartUs;
 
-                    Event e(RSensors, RStateButtonEvent, sensor->id(), item);
-                    enqueueEvent(e);
-                    updateSensorEtag(sensor);
-                    sensor->updateStateTimestamp();
-                    sensor->setNeedSaveDatabase(true);
-                    enqueueEvent(Event(RSensors, RStateLastUpdated, sensor->id()));
-                }
+                Event e(RSensors, RStateButtonEvent, sensor->id(), item);
+                enqueueEvent(e);
+                updateSensorEtag(sensor);
+                sensor->updateStateTimestamp();
+                sensor->setNeedSaveDatabase(true);
+                enqueueEvent(Event(RSensors, RStateLastUpdated, sensor->id()));
+            }
 
-                item = sensor->item(RStatePresence);
-                if (item)
-                {
-                    item->setValue(true);
-                    Event e(RSensors, RStatePresence, sensor->id(), item);
-                    enqueueEvent(e);
-                    updateSensorEtag(sensor);
-                    sensor->updateStateTimestamp();
-                    sensor->setNeedSaveDatabase(true);
-                    enqueueEvent(Event(RSensors, RStateLastUpdated, sensor->id()));
+            item = sensor->item(RStatePresence);
+            if (item)
+            {
+                item->setValue(true);
+                Event e(RSensors, RStatePresence, sensor->id(), item);
+                enqueueEvent(e);
+                updateSensorEtag(sensor);
+                sensor->updateStateTimestamp();
+                sensor->setNeedSaveDatabase(true);
+                enqueueEvent(Event(RSensors, RStateLastUpdated, sensor->id()));
 
-                    ResourceItem *item2 = sensor->item(RConfigDuration);
-                    if (item2 && item2->toNumber() > 0)
-                    {
-                        sensor->durationDue = QDateTime::currentDateTime().addSecs(item2->toNumber());
-                    }
+                ResourceItem *item2 = sensor->item(RConfigDuration);
+                if (item2 && item2->toNumber() > 0)
+                {
+                    sensor->durationDue = QDateTime::currentDateTime().addSecs(item2->toNumber());
                 }
-                break;
             }
+            break;
         }
-        buttonMap++;
     }
 
     if (checkReporting && sensor->node() &&
@@ -7058,8 +7110,27 @@ GroupInfo *DeRestPluginPrivate::createGroupInfo(LightNode *lightNode, uint16_t i
  */
 deCONZ::Node *DeRestPluginPrivate::getNodeForAddress(uint64_t extAddr)
 {
-    int i = 0;
-    const deCONZ::Node *node;
+    const NodeCacheEntry *entry = getNodeCacheEntry(extAddr);
+
+    if (entry)
+    {
+        return const_cast<deCONZ::Node*>(entry->node); // FIXME: use const
+    }
+
+    return 0;
+}
+
+/*! Returns the cached node and clusters for a given MAC address or 0 if not found.
+    The cache is kept up to date by nodeEvent(), on a miss the core is queried.
+ */
+const NodeCacheEntry *DeRestPluginPrivate::getNodeCacheEntry(quint64 extAddr)
+{
+    auto i = nodeCache.constFind(extAddr);
+
+    if (i != nodeCache.constEnd())
+    {
+        return &i.value();
+    }
 
     DBG_Assert(apsCtrl != 0);
 
@@ -7068,18 +7139,52 @@ deCONZ::Node *DeRestPluginPrivate::getNodeForAddress(uint64_t extAddr)
         return 0;
     }
 
-    while (apsCtrl->getNode(i, &node) == 0)
+    int n = 0;
+    const deCONZ::Node *node;
+
+    while (apsCtrl->getNode(n, &node) == 0)
     {
         if (node->address().ext() == extAddr)
         {
-            return const_cast<deCONZ::Node*>(node); // FIXME: use const
+            updateNodeCache(node);
+            return &nodeCache[extAddr];
         }
-        i++;
+        n++;
     }
 
     return 0;
 }
 
+/*! Updates the cached clusters of a node.
+ */
+void DeRestPluginPrivate::updateNodeCache(const deCONZ::Node *node)
+{
+    if (!node || !node->address().hasExt())
+    {
+        return;
+    }
+
+    NodeCacheEntry &entry = nodeCache[node->address().ext()];
+    entry.node = node;
+    entry.inClusters.clear();
+    entry.outClusters.clear();
+
+    for (const deCONZ::SimpleDescriptor &sd : node->simpleDescriptors())
+    {
+        const quint32 ep = quint32(sd.endpoint()) << 16;
+
+        for (const deCONZ::ZclCluster &cl : sd.inClusters())
+        {
+            entry.inClusters.insert(ep | cl.id());
+        }
+
+        for (const deCONZ::ZclCluster &cl : sd.outClusters())
+        {
+            entry.outClusters.insert(ep | cl.id());
+        }
+    }
+}
+
 /*! Returns the cluster descriptor for given cluster id.
     \return the cluster or 0 if not found
  */
@@ -9579,6 +9684,40 @@ void DeRestPluginPrivate::queuePollNode(RestNodeBase *node)
     pollNodes.push_back(node);
 }
 
+/*! Returns true if a node should be polled periodically.
+    Nodes which report all their values are only polled every POLL_REPORTING_NODE_INTERVAL
+    seconds, unless their state changed recently. Other nodes are always due.
+ */
+bool DeRestPluginPrivate::isPollDue(RestNodeBase *restNode, const QDateTime &now)
+{
+    if (!restNode->lastPoll().isValid() || restNode->lastPoll().secsTo(now) >= POLL_REPORTING_NODE_INTERVAL)
+    {
+        return true;
+    }
+
+    Resource *r = dynamic_cast<Resource*>(restNode);
+    if (r)
+    {
+        const char *suffixes[] = { RStateOn, RStateBri, RStatePresence, nullptr };
+        for (int i = 0; suffixes[i]; i++)
+        {
+            const ResourceItem *item = r->item(suffixes[i]);
+            if (item && item->lastChanged().isValid() && item->lastChanged().secsTo(now) < POLL_RECENT_CHANGE_TIME)
+            {
+                return true;
+            }
+        }
+    }
+
+    if (restNode->isReporting(now))
+    {
+        metrics.increment(metricPollSkippedReporting);
+        return false;
+    }
+
+    return true;
+}
+
 void DeRestPluginPrivate::sendZclDefaultResponse(const deCONZ::ApsDataIndication &ind, deCONZ::ZclFrame &zclFrame, quint8 status)
 {
    deCONZ::ApsDataRequest apsReq;
@@ -9774,40 +9913,123 @@ bool DeRestPluginPrivate::flsNbMaintenance(LightNode *lightNode)
  */
 void DeRestPluginPrivate::pushClientForClose(QTcpSocket *sock, int closeTimeout, const QHttpRequestHeader &hdr)
 {
-    std::vector<TcpClient>::iterator i = openClients.begin();
-    std::vector<TcpClient>::iterator end = openClients.end();
+    auto i = openClients.find(sock);
 
-    for ( ;i != end; ++i)
+    if (i != openClients.end() && i->bodyPending)
     {
-        if (i->sock == sock)
+        // request continued by clientSocketReadyRead()
+        i->bodyPending = false;
+        setClientCloseTimeout(sock, closeTimeout);
+        return;
+    }
+
+    if (i != openClients.end())
+    {
+        // persistent connection, extend the idle timeout
+        i->hdr = hdr;
+        i->requests++;
+        metrics.increment(QLatin1String("http_connection_reuse_total"));
+
+        if (i->closeTime < openClientTicks + closeTimeout)
         {
-            // update
-            if (i->closeTimeout > 0)
-            {
-                i->hdr = hdr;
-                if (i->closeTimeout < closeTimeout)
-                {
-                    i->closeTimeout = closeTimeout;
-                    //DBG_Printf(DBG_INFO, "refresh socket %s : %u %s\n", qPrintable(sock->peerAddress().toString()), sock->peerPort(), qPrintable(hdr.path()));
-                }
-            }
-            return;
+            setClientCloseTimeout(sock, closeTimeout);
         }
+        return;
     }
 
     TcpClient client;
     client.hdr = hdr;
     client.created = QDateTime::currentDateTime();
     client.sock = sock;
-    client.closeTimeout = closeTimeout;
+    client.closeTime = 0;
+    client.serial = openClientSerial++;
+    client.requests = 1;
+    client.bodyPending = false;
 
     connect(sock, SIGNAL(destroyed()),
             this, SLOT(clientSocketDestroyed()));
 
-    openClients.push_back(client);
+    openClients.insert(sock, client);
+    setClientCloseTimeout(sock, closeTimeout);
+
+    metrics.increment(QLatin1String("http_connections_total"));
+    metrics.setGauge(QLatin1String("http_open_connections"), openClients.size());
+}
+
+/*! Sets the idle timeout after which a client socket will be closed.
+    \param sock - the client socket
+    \param closeTimeout - seconds from now
+ */
+void DeRestPluginPrivate::setClientCloseTimeout(QTcpSocket *sock, int closeTimeout)
+{
+    auto i = openClients.find(sock);
+
+    if (i == openClients.end())
+    {
+        return;
+    }
+
+    i->closeTime = openClientTicks + closeTimeout;
+
+    TcpClientDeadline deadline;
+    deadline.closeTime = i->closeTime;
+    deadline.serial = i->serial;
+    deadline.sock = sock;
+    openClientDeadlines.push(deadline);
+}
+
+/*! Checks if a queued group task is made obsolete by a newer one to the same group.
+    Only absolute commands supersede, so that the final state of the group is the
+    same whether or not the older frame is sent.
+    \param newer - the task about to be queued
+    \param older - a task which is still waiting in the queue
+    \return true - if older can be dropped
+ */
+static bool groupTaskSupersedes(const TaskItem &newer, const TaskItem &older)
+{
+    if (older.ordered || newer.ordered ||
+        older.req.dstAddressMode() != deCONZ::ApsGroupAddress ||
+        older.req.dstAddress().group() != newer.req.dstAddress().group() ||
+        older.req.dstEndpoint() != newer.req.dstEndpoint() ||
+        older.req.profileId() != newer.req.profileId())
+    {
+        return false;
+    }
+
+    switch (newer.taskType)
+    {
+    case TaskSetXyColor:
+    case TaskSetColorTemperature:
+    case TaskSetHueAndSaturation:
+        return older.taskType == TaskSetXyColor ||
+               older.taskType == TaskSetColorTemperature ||
+               older.taskType == TaskSetHueAndSaturation ||
+               older.taskType == TaskSetEnhancedHue ||
+               older.taskType == TaskSetHue ||
+               older.taskType == TaskSetSat ||
+               older.taskType == TaskIncColorTemperature;
+
+    case TaskSetLevel:
+        if (newer.zclFrame.commandId() != LEVEL_COMMAND_MOVE_TO_LEVEL_WITH_ON_OFF)
+        {
+            return false;
+        }
+        if (older.taskType == TaskIncBrightness)
+        {
+            return true;
+        }
+        return older.taskType == TaskSendOnOffToggle &&
+               (older.zclFrame.commandId() == ONOFF_COMMAND_ON || older.zclFrame.commandId() == ONOFF_COMMAND_OFF);
+
+    default:
+        break;
+    }
+
+    return false;
 }
 
 /*! Adds a task to the queue.
+    Group casts which are superseded by the new task are dropped from the queue.
     \return true - on success
  */
 bool DeRestPluginPrivate::addTask(const TaskItem &task)
@@ -9835,6 +10057,13 @@ bool DeRestPluginPrivate::addTask(const TaskItem &task)
     }
 
     const uint MaxTasks = 20;
+    const qint64 queueTime = starttimeRef.elapsed();
+    Group *group = nullptr;
+
+    if (task.req.dstAddressMode() == deCONZ::ApsGroupAddress)
+    {
+        group = getGroupForId(task.req.dstAddress().group());
+    }
 
     std::list<TaskItem>::iterator i = tasks.begin();
     std::list<TaskItem>::iterator end = tasks.end();
@@ -9864,15 +10093,54 @@ bool DeRestPluginPrivate::addTask(const TaskItem &task)
 
                 {
                     DBG_Printf(DBG_INFO, "Replace task %d type %d in queue cluster 0x%04X with newer task of same type. %u runnig tasks\n", task.taskId, task.taskType, task.req.clusterId(), runningTasks.size());
+                    const qint64 t = i->queueTime; // keep the fusion window bound to the first request
                     *i = task;
+                    i->queueTime = t;
+                    i->probeStartUs = ruleTriggerStartUs;
+                    if (group)
+                    {
+                        group->fusedCount++;
+                    }
                     return true;
                 }
             }
         }
     }
 
+    if (group)
+    {
+        i = tasks.begin();
+        end = tasks.end();
+
+        while (i != end)
+        {
+            if (groupTaskSupersedes(task, *i))
+            {
+                DBG_Printf(DBG_INFO, "Drop task %d type %d to group 0x%04X superseded by task %d type %d\n", i->taskId, i->taskType, group->address(), task.taskId, task.taskType);
+                group->fusedCount++;
+                i = tasks.erase(i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+
     if (tasks.size() < MaxTasks) {
-        tasks.push_back(task);
+        if (!taskPool.empty())
+        {
+            // reuse the list node and the member buffers of a finished task
+            tasks.splice(tasks.end(), taskPool, taskPool.begin());
+            tasks.back() = task;
+            metrics.increment(metricTaskPoolReused);
+        }
+        else
+        {
+            tasks.push_back(task);
+        }
+        tasks.back().queueTime = queueTime;
+        tasks.back().probeStartUs = ruleTriggerStartUs;
         return true;
     }
 
@@ -9881,6 +10149,23 @@ bool DeRestPluginPrivate::addTask(const TaskItem &task)
     return false;
 }
 
+/*! Removes a finished task from \p list and keeps its node in taskPool for the next addTask().
+    The ASDU buffer goes back to zclBufferPool.
+ */
+void DeRestPluginPrivate::recycleTask(std::list<TaskItem> &list, std::list<TaskItem>::iterator i)
+{
+    zclBufferPool.release(i->req.asdu());
+
+    if (taskPool.size() < MAX_TASK_POOL)
+    {
+        taskPool.splice(taskPool.end(), list, i);
+    }
+    else
+    {
+        list.erase(i);
+    }
+}
+
 /*! Fires the next APS-DATA.request.
  */
 void DeRestPluginPrivate::processTasks()
@@ -9890,6 +10175,9 @@ void DeRestPluginPrivate::processTasks()
         return;
     }
 
+    metrics.setGauge(metricTaskQueueDepth, qint64(tasks.size()));
+    metrics.setGauge(metricTaskRunning, qint64(runningTasks.size()));
+
     if (tasks.empty())
     {
         return;
@@ -10024,18 +10312,37 @@ void DeRestPluginPrivate::processTasks()
                 if (group)
                 {
                     int diff = group->sendTime.msecsTo(now);
+                    const qint64 age = starttimeRef.elapsed() - i->queueTime;
 
-                    if (!group->sendTime.isValid() || (diff <= 0) || (diff > gwGroupSendDelay))
+                    if (age < gwGroupFusionWindow)
+                    {
+                        DBG_Printf(DBG_INFO_L2, "hold group task %d for fusion, age %d ms\n", i->taskId, int(age));
+                    }
+                    else if (!group->sendTime.isValid() || (diff <= 0) || (diff > gwGroupSendDelay))
                     {
                         i->sendTime = idleTotalCounter;
                         if (apsCtrl->apsdeDataRequest(i->req) == deCONZ::Success)
                         {
                             group->sendTime = now;
+                            metrics.record(metricTaskQueueTime, age);
+                            if (i->probeStartUs > 0)
+                            {
+                                metrics.record(metricButtonToApsRequest, starttimeRef.nsecsElapsed() / 1000 - i->probeStartUs);
+                            }
+                            group->sendCount++;
+                            group->sendLatencySum += age;
+                            if (age > group->sendLatencyMax)
+                            {
+                                group->sendLatencyMax = age;
+                            }
                             if (pushRunning)
                             {
-                                runningTasks.push_back(*i);
+                                runningTasks.splice(runningTasks.end(), tasks, i); // no copy
+                            }
+                            else
+                            {
+                                recycleTask(tasks, i);
                             }
-                            tasks.erase(i);
                             return;
                         }
                     }
@@ -10068,11 +10375,22 @@ void DeRestPluginPrivate::processTasks()
 
                     if (ret == deCONZ::Success)
                     {
+                        if (i->queueTime > 0)
+                        {
+                            metrics.record(metricTaskQueueTime, starttimeRef.elapsed() - i->queueTime);
+                        }
+                        if (i->probeStartUs > 0)
+                        {
+                            metrics.record(metricButtonToApsRequest, starttimeRef.nsecsElapsed() / 1000 - i->probeStartUs);
+                        }
                         if (pushRunning)
                         {
-                            runningTasks.push_back(*i);
+                            runningTasks.splice(runningTasks.end(), tasks, i); // no copy
+                        }
+                        else
+                        {
+                            recycleTask(tasks, i);
                         }
-                        tasks.erase(i);
                         return;
                     }
                     else if (ret == deCONZ::ErrorNodeIsZombie)
@@ -10098,6 +10416,11 @@ void DeRestPluginPrivate::processTasks()
  */
 void DeRestPluginPrivate::nodeEvent(const deCONZ::NodeEvent &event)
 {
+    if (apsTraceWriter.isOpen())
+    {
+        apsTraceWriter.write(event);
+    }
+
     if (event.event() != deCONZ::NodeEvent::NodeDeselected)
     {
         if (!event.node())
@@ -10132,6 +10455,8 @@ void DeRestPluginPrivate::nodeEvent(const deCONZ::NodeEvent &event)
                 nodeZombieStateChanged(event.node());
             }
         }
+
+        nodeCache.remove(event.node()->address().ext());
     }
         break;
 
@@ -10146,6 +10471,7 @@ void DeRestPluginPrivate::nodeEvent(const deCONZ::NodeEvent &event)
         {
             refreshDeviceDb(event.node()->address());
         }
+        updateNodeCache(event.node());
         addLightNode(event.node());
         addSensorNode(event.node());
     }
@@ -10171,12 +10497,14 @@ void DeRestPluginPrivate::nodeEvent(const deCONZ::NodeEvent &event)
         if (event.node())
         {
             refreshDeviceDb(event.node()->address());
+            updateNodeCache(event.node());
         }
         break;
     }
 
     case deCONZ::NodeEvent::UpdatedSimpleDescriptor:
     {
+        updateNodeCache(event.node());
         addLightNode(event.node());
         updatedLightNodeEndpoint(event);
         addSensorNode(event.node());
@@ -12125,19 +12453,12 @@ void DeRestPluginPrivate::handleDeviceAnnceIndication(const deCONZ::ApsDataIndic
     {
         if (!found && apsCtrl)
         {
-            int i = 0;
-            const deCONZ::Node *node;
-
             // try to add sensor nodes even if they existed in deCONZ bevor and therefore
             // no node added event will be triggert in this phase
-            while (apsCtrl->getNode(i, &node) == 0)
+            const deCONZ::Node *node = getNodeForAddress(ext);
+            if (node)
             {
-                if (ext == node->address().ext())
-                {
-                    addSensorNode(node);
-                    break;
-                }
-                i++;
+                addSensorNode(node);
             }
         }
 
@@ -12772,18 +13093,7 @@ void DeRestPluginPrivate::delayedFastEnddeviceProbe(const deCONZ::NodeEvent *eve
 
         if (!node)
         {
-            int i = 0;
-            const deCONZ::Node *n;
-
-            while (apsCtrl->getNode(i, &n) == 0)
-            {
-                if (fastProbeAddr.ext() == n->address().ext())
-                {
-                    node = n;
-                    break;
-                }
-                i++;
-            }
+            node = getNodeForAddress(fastProbeAddr.ext());
         }
 
         if (!node)
@@ -13781,8 +14091,12 @@ void DeRestPlugin::idleTimerFired()
     ResourceItem *localTime = d->config.item(RConfigLocalTime);
     if (localTime)
     {
-        localTime->setValue(QDateTime::currentDateTime());
-        d->enqueueEvent(Event(RConfig, RConfigLocalTime, 0));
+        localTime->setValue(CachedClock::currentDateTime());
+        // only wake rules when a time condition is due
+        if (d->ruleTimeTriggersDue(CachedClock::wallMs()))
+        {
+            d->enqueueEvent(Event(RConfig, RConfigLocalTime, 0));
+        }
     }
 
     if (d->idleLastActivity < IDLE_USER_LIMIT)
@@ -13953,7 +14267,7 @@ void DeRestPlugin::idleTimerFired()
                     }
                 }
 
-                if (d->gwPermitJoinDuration == 0)
+                if (d->gwPermitJoinDuration == 0 && d->isPollDue(lightNode, now))
                 {
                     d->queuePollNode(lightNode);
                 }
@@ -13970,7 +14284,8 @@ void DeRestPlugin::idleTimerFired()
                 }
 
                 const uint32_t items[]   = { READ_GROUPS, READ_SCENES, 0 };
-                const int tRead[]        = {        1800,        3600, 0 };
+                const int tReadFactor    = lightNode->isReporting(now) ? READ_REPORTING_NODE_FACTOR : 1;
+                const int tRead[]        = { 1800 * tReadFactor, 3600 * tReadFactor, 0 };
 
                 for (size_t i = 0; items[i] != 0; i++)
                 {
@@ -14115,7 +14430,7 @@ void DeRestPlugin::idleTimerFired()
                     }
                 }
 
-                if (d->gwPermitJoinDuration == 0)
+                if (d->gwPermitJoinDuration == 0 && d->isPollDue(sensorNode, now))
                 {
                     d->queuePollNode(sensorNode);
                 }
@@ -14505,6 +14820,238 @@ bool DeRestPlugin::isHttpTarget(const QHttpRequestHeader &hdr)
     return false;
 }
 
+/*! Compiles the REST API route table into the router trie.
+    Routes are relative to /api/<apikey>, see RestRouter.
+ */
+void DeRestPluginPrivate::initRestRouter()
+{
+    typedef int (DeRestPluginPrivate::*Member)(const ApiRequest &, ApiResponse &);
+    auto bind = [this](Member m) {
+        return RestRouter::Handler([this, m](const ApiRequest &req, ApiResponse &rsp) { return (this->*m)(req, rsp); });
+    };
+
+    const int Get = RestRouter::MethodGet;
+    const int Put = RestRouter::MethodPut | RestRouter::MethodPatch;
+    const int Post = RestRouter::MethodPost;
+    const int Delete = RestRouter::MethodDelete;
+    const int Any = Get | Put | Post | Delete;
+
+    restRouter.setMetrics(&metrics);
+
+    // lights
+    restRouter.addRoute(Get,    QLatin1String("lights"), bind(&DeRestPluginPrivate::getAllLights));
+    restRouter.addRoute(Post,   QLatin1String("lights"), bind(&DeRestPluginPrivate::searchNewLights));
+    restRouter.addRoute(Get,    QLatin1String("lights/new"), bind(&DeRestPluginPrivate::getNewLights));
+    restRouter.addRoute(Get,    QLatin1String("lights/:id"), bind(&DeRestPluginPrivate::getLightState));
+    restRouter.addRoute(Put,    QLatin1String("lights/:id"), bind(&DeRestPluginPrivate::setLightAttributes));
+    restRouter.addRoute(Delete, QLatin1String("lights/:id"), bind(&DeRestPluginPrivate::deleteLight));
+    restRouter.addRoute(Get,    QLatin1String("lights/:id/data"), bind(&DeRestPluginPrivate::getLightData));
+    restRouter.addRoute(Put,    QLatin1String("lights/:id/state"), bind(&DeRestPluginPrivate::setLightState));
+    restRouter.addRoute(Get,    QLatin1String("lights/:id/connectivity"),
+                        [this](const ApiRequest &req, ApiResponse &rsp) { return getConnectivity(req, rsp, false); });
+    restRouter.addRoute(Get,    QLatin1String("lights/:id/connectivity2"),
+                        [this](const ApiRequest &req, ApiResponse &rsp) { return getConnectivity(req, rsp, true); });
+    restRouter.addRoute(Delete, QLatin1String("lights/:id/scenes"), bind(&DeRestPluginPrivate::removeAllScenes));
+    restRouter.addRoute(Delete, QLatin1String("lights/:id/groups"), bind(&DeRestPluginPrivate::removeAllGroups));
+
+    // groups
+    restRouter.addRoute(Get,    QLatin1String("groups"), bind(&DeRestPluginPrivate::getAllGroups));
+    restRouter.addRoute(Post,   QLatin1String("groups"), bind(&DeRestPluginPrivate::createGroup));
+    restRouter.addRoute(Get,    QLatin1String("groups/:id"), bind(&DeRestPluginPrivate::getGroupAttributes));
+    restRouter.addRoute(Put,    QLatin1String("groups/:id"), bind(&DeRestPluginPrivate::setGroupAttributes));
+    restRouter.addRoute(Delete, QLatin1String("groups/:id"), bind(&DeRestPluginPrivate::deleteGroup));
+    restRouter.addRoute(Put,    QLatin1String("groups/:id/action"), bind(&DeRestPluginPrivate::setGroupState));
+    restRouter.addRoute(Get,    QLatin1String("groups/:id/scenes"), bind(&DeRestPluginPrivate::getAllScenes));
+    restRouter.addRoute(Post,   QLatin1String("groups/:id/scenes"), bind(&DeRestPluginPrivate::createScene));
+    restRouter.addRoute(Get,    QLatin1String("groups/:id/scenes/:sid"), bind(&DeRestPluginPrivate::getSceneAttributes));
+    restRouter.addRoute(Put,    QLatin1String("groups/:id/scenes/:sid"), bind(&DeRestPluginPrivate::setSceneAttributes));
+    restRouter.addRoute(Delete, QLatin1String("groups/:id/scenes/:sid"), bind(&DeRestPluginPrivate::deleteScene));
+    restRouter.addRoute(RestRouter::MethodPut, QLatin1String("groups/:id/scenes/:sid/store"), bind(&DeRestPluginPrivate::storeScene));
+    restRouter.addRoute(RestRouter::MethodPut, QLatin1String("groups/:id/scenes/:sid/recall"), bind(&DeRestPluginPrivate::recallScene));
+    restRouter.addRoute(Put,    QLatin1String("groups/:id/scenes/:sid/lights/:lid/:state"), bind(&DeRestPluginPrivate::modifyScene));
+
+    // sensors
+    restRouter.addRoute(Get,    QLatin1String("sensors"), bind(&DeRestPluginPrivate::getAllSensors));
+    restRouter.addRoute(Post,   QLatin1String("sensors"), [this](const ApiRequest &req, ApiResponse &rsp) {
+        bool ok;
+        const QVariantMap map = Json::parse(req.content, ok).toMap();
+        return map.isEmpty() ? searchNewSensors(req, rsp) : createSensor(req, rsp);
+    });
+    restRouter.addRoute(Get,    QLatin1String("sensors/new"), bind(&DeRestPluginPrivate::getNewSensors));
+    restRouter.addRoute(Get,    QLatin1String("sensors/:id"), bind(&DeRestPluginPrivate::getSensor));
+    restRouter.addRoute(Put,    QLatin1String("sensors/:id"), bind(&DeRestPluginPrivate::updateSensor));
+    restRouter.addRoute(Delete, QLatin1String("sensors/:id"), bind(&DeRestPluginPrivate::deleteSensor));
+    restRouter.addRoute(Get,    QLatin1String("sensors/:id/data"), bind(&DeRestPluginPrivate::getSensorData));
+    restRouter.addRoute(Put,    QLatin1String("sensors/:id/config"), bind(&DeRestPluginPrivate::changeSensorConfig));
+    restRouter.addRoute(Put,    QLatin1String("sensors/:id/state"), bind(&DeRestPluginPrivate::changeSensorState));
+
+    // rules
+    restRouter.addRoute(Get,    QLatin1String("rules"), bind(&DeRestPluginPrivate::getAllRules));
+    restRouter.addRoute(Post,   QLatin1String("rules"), bind(&DeRestPluginPrivate::createRule));
+    restRouter.addRoute(Get,    QLatin1String("rules/:id"), bind(&DeRestPluginPrivate::getRule));
+    restRouter.addRoute(Put,    QLatin1String("rules/:id"), bind(&DeRestPluginPrivate::updateRule));
+    restRouter.addRoute(Delete, QLatin1String("rules/:id"), bind(&DeRestPluginPrivate::deleteRule));
+
+    // resources which still dispatch internally
+    restRouter.addRoute(Any, QLatin1String("devices/*"),
+                        [this](const ApiRequest &req, ApiResponse &rsp) { return restDevices->handleApi(req, rsp); });
+    restRouter.addRoute(Any, QLatin1String("schedules/*"), bind(&DeRestPluginPrivate::handleSchedulesApi));
+    restRouter.addRoute(Any, QLatin1String("scenes/*"), bind(&DeRestPluginPrivate::handleScenesApi));
+    restRouter.addRoute(Any, QLatin1String("config/*"), bind(&DeRestPluginPrivate::handleConfigFullApi));
+    restRouter.addRoute(Any, QLatin1String("info/*"), bind(&DeRestPluginPrivate::handleInfoApi));
+    restRouter.addRoute(Any, QLatin1String("resourcelinks/*"), bind(&DeRestPluginPrivate::handleResourcelinksApi));
+    restRouter.addRoute(Any, QLatin1String("capabilities/*"), bind(&DeRestPluginPrivate::handleCapabilitiesApi));
+    restRouter.addRoute(Any, QLatin1String("touchlink/*"), bind(&DeRestPluginPrivate::handleTouchlinkApi));
+    restRouter.addRoute(Any, QLatin1String("userparameter/*"), bind(&DeRestPluginPrivate::handleUserparameterApi));
+    restRouter.addRoute(Any, QLatin1String("gateways/*"), bind(&DeRestPluginPrivate::handleGatewaysApi));
+    restRouter.addRoute(Any, QLatin1String("metrics/*"), bind(&DeRestPluginPrivate::handleMetricsApi));
+}
+
+/*! Responses smaller than this are sent uncompressed. */
+static const int HttpCompressMinSize = 1024;
+
+/*! HTTP content codings supported for responses. */
+enum HttpEncoding
+{
+    HttpEncodingIdentity,
+    HttpEncodingGzip,
+    HttpEncodingDeflate
+};
+
+/*! Returns the preferred content coding from the Accept-Encoding header.
+    gzip is preferred over deflate, codings with q=0 are ignored.
+ */
+static HttpEncoding httpAcceptedEncoding(const QHttpRequestHeader &hdr)
+{
+    if (!hdr.hasKey(QLatin1String("Accept-Encoding")))
+    {
+        return HttpEncodingIdentity;
+    }
+
+    bool deflate = false;
+    const QStringList codings = hdr.value(QLatin1String("Accept-Encoding")).split(QLatin1Char(','), QString::SkipEmptyParts);
+
+    for (const QString &coding : codings)
+    {
+        const QStringList params = coding.split(QLatin1Char(';'));
+        const QString name = params.first().trimmed().toLower();
+
+        if (params.size() > 1)
+        {
+            const QString q = params[1].trimmed();
+            if (q.startsWith(QLatin1String("q=")) && q.mid(2).toDouble() <= 0)
+            {
+                continue;
+            }
+        }
+
+        if (name == QLatin1String("gzip"))
+        {
+            return HttpEncodingGzip;
+        }
+        else if (name == QLatin1String("deflate"))
+        {
+            deflate = true;
+        }
+    }
+
+    return deflate ? HttpEncodingDeflate : HttpEncodingIdentity;
+}
+
+/*! CRC-32 (IEEE 802.3) as used in the gzip trailer.
+ */
+static quint32 httpCrc32(const QByteArray &data)
+{
+    static quint32 table[256];
+    static bool tableInit = false;
+
+    if (!tableInit)
+    {
+        for (quint32 i = 0; i < 256; i++)
+        {
+            quint32 c = i;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            }
+            table[i] = c;
+        }
+        tableInit = true;
+    }
+
+    quint32 crc = 0xFFFFFFFF;
+    const uchar *p = reinterpret_cast<const uchar*>(data.constData());
+
+    for (int i = 0; i < data.size(); i++)
+    {
+        crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc ^ 0xFFFFFFFF;
+}
+
+/*! Compresses a response body.
+    qCompress() produces a 4 byte length prefix followed by a zlib stream,
+    which is what HTTP calls deflate. For gzip the raw deflate data is
+    wrapped in a gzip header and trailer.
+    \return the compressed body or an empty array on error
+ */
+static QByteArray httpCompress(const QByteArray &body, HttpEncoding encoding)
+{
+    const QByteArray z = qCompress(body, 6);
+
+    if (z.size() < 4 + 2 + 4) // length prefix, zlib header, adler32
+    {
+        return QByteArray();
+    }
+
+    if (encoding == HttpEncodingDeflate)
+    {
+        return z.mid(4);
+    }
+
+    const quint32 crc = httpCrc32(body);
+    const quint32 size = quint32(body.size());
+    const char header[10] = { '\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff' };
+
+    QByteArray gz;
+    gz.reserve(z.size() + 16);
+    gz.append(header, sizeof(header));
+    gz.append(z.constData() + 6, z.size() - 6 - 4);
+    for (int i = 0; i < 4; i++) { gz.append(char((crc >> (8 * i)) & 0xFF)); }
+    for (int i = 0; i < 4; i++) { gz.append(char((size >> (8 * i)) & 0xFF)); }
+    return gz;
+}
+
+/*! Returns the resource name used to label HTTP request metrics.
+    Unknown paths are folded into "other" to keep the number of series bounded.
+ */
+static QString httpMetricsResource(const QStringList &path)
+{
+    static const char *resources[] = {
+        "devices", "lights", "groups", "schedules", "scenes", "sensors", "rules", "config", "info",
+        "resourcelinks", "capabilities", "touchlink", "userparameter", "gateways", "metrics", nullptr
+    };
+
+    if (path.size() == 2 && path[0] == QLatin1String("api"))
+    {
+        return QLatin1String("fullstate");
+    }
+
+    if (path.size() > 2 && path[0] == QLatin1String("api"))
+    {
+        for (int i = 0; resources[i]; i++)
+        {
+            if (path[2] == QLatin1String(resources[i]))
+            {
+                return path[2];
+            }
+        }
+    }
+
+    return QLatin1String("other");
+}
+
 /*! Broker for any incoming REST API request.
     \param hdr - http request header
     \param sock - the client socket
@@ -14513,6 +15060,7 @@ bool DeRestPlugin::isHttpTarget(const QHttpRequestHeader &hdr)
  */
 int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *sock)
 {
+    MetricsTimer httpTimer(&d->metrics, QLatin1String("http_request_duration_us{resource=\"other\"}"));
     QString content;
     QTextStream stream(sock);
     QHttpRequestHeader hdrmod(hdr);
@@ -14553,6 +15101,38 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
             DBG_Printf(DBG_HTTP, "Binary Data: \t%s\n", qPrintable(content));
         }
     }
+    else if (hdr.hasKey(QLatin1String("Content-Length")))
+    {
+        // read only this request's body, a pipelined request may follow on the socket
+        const qint64 length = hdr.value(QLatin1String("Content-Length")).toLongLong();
+        if (length > 0)
+        {
+            if (length <= HTTP_MAX_BODY_SIZE && sock->bytesAvailable() < length)
+            {
+                // the body arrives in several TCP segments, continue when it's complete
+                d->waitForHttpBody(sock, hdr);
+                return 0;
+            }
+
+            if (length > HTTP_MAX_BODY_SIZE)
+            {
+                DBG_Printf(DBG_HTTP, "HTTP body of %d bytes too large - %s\n", int(length), qPrintable(sock->peerAddress().toString()));
+                stream << "HTTP/1.1 400 Bad Request\r\n";
+                stream << "Content-Length: 0\r\n";
+                stream << "Connection: close\r\n";
+                stream << "\r\n";
+                stream.flush();
+                d->setClientCloseTimeout(sock, 1); // the body isn't read, the rest of the stream can't be parsed
+                return 0;
+            }
+
+            content = QString::fromUtf8(sock->read(length));
+        }
+        if (DBG_IsEnabled(DBG_HTTP))
+        {
+            DBG_Printf(DBG_HTTP, "Text Data: \t%s\n", qPrintable(content));
+        }
+    }
     else if (!stream.atEnd())
     {
         content = stream.readAll();
@@ -14575,6 +15155,8 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
     ApiRequest req(hdrmod, path, sock, content);
     ApiResponse rsp;
 
+    httpTimer.setName(QLatin1String("http_request_duration_us{resource=\"") + httpMetricsResource(path) + QLatin1String("\"}"));
+
     rsp.httpStatus = HttpStatusNotFound;
     rsp.contentType = HttpContentHtml;
 
@@ -14652,21 +15234,12 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
 
     else if (hdr.path().startsWith(QLatin1String("/description.xml")) && (hdr.method() == QLatin1String("GET")))
     {
-        rsp.httpStatus = HttpStatusOk;
-        rsp.contentType = HttpContentHtml;
-        rsp.str = d->descriptionXml;
-
-        if (d->descriptionXml.isEmpty())
+        if (d->descriptionXmlResponse.isEmpty())
         {
             return -1;
         }
-        stream << "HTTP/1.1 " << HttpStatusOk << "\r\n";
-        stream << "Content-Type: application/xml\r\n";
-        stream << "Content-Length:" << QString::number(d->descriptionXml.size()) << "\r\n";
-        stream << "Connection: close\r\n";
-        stream << "\r\n";
-        stream << d->descriptionXml.constData();
-        stream.flush();
+        // prepared in initDescriptionXml()
+        sock->write(d->descriptionXmlResponse);
         return 0;
     }
 
@@ -14681,61 +15254,9 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
             {
                 ret = d->getFullState(req, rsp);
             }
-            else if (path[2] == QLatin1String("devices"))
-            {
-                ret = d->restDevices->handleApi(req, rsp);
-            }
-            else if (path[2] == QLatin1String("lights"))
-            {
-                ret = d->handleLightsApi(req, rsp);
-            }
-            else if (path[2] == QLatin1String("groups"))
-            {
-                ret = d->handleGroupsApi(req, rsp);
-            }
-            else if (path[2] == QLatin1String("schedules"))
-            {
-                ret = d->handleSchedulesApi(req, rsp);
-            }
-            else if (path[2] == QLatin1String("scenes"))
-            {
-                ret = d->handleScenesApi(req, rsp);
-            }
-            else if (path[2] == QLatin1String("sensors"))
+            else if (path.size() > 2 && d->restRouter.hasResource(path[2]))
             {
-                ret = d->handleSensorsApi(req, rsp);
-            }
-            else if (path[2] == QLatin1String("rules"))
-            {
-                ret = d->handleRulesApi(req, rsp);
-            }
-            else if (path[2] == QLatin1String("config"))
-            {
-                ret = d->handleConfigFullApi(req, rsp);
-            }
-            else if (path[2] == QLatin1String("info"))
-            {
-                ret = d->handleInfoApi(req, rsp);
-            }
-            else if (path[2] == QLatin1String("resourcelinks"))
-            {
-                ret = d->handleResourcelinksApi(req, rsp);
-            }
-            else if (path[2] == QLatin1String("capabilities"))
-            {
-                ret = d->handleCapabilitiesApi(req, rsp);
-            }
-            else if (path[2] == QLatin1String("touchlink"))
-            {
-                ret = d->handleTouchlinkApi(req, rsp);
-            }
-            else if (path[2] == QLatin1String("userparameter"))
-            {
-                ret = d->handleUserparameterApi(req, rsp);
-            }
-            else if (path[2] == QLatin1String("gateways"))
-            {
-                ret = d->handleGatewaysApi(req, rsp);
+                ret = d->restRouter.dispatch(req, rsp);
             }
             else
             {
@@ -14801,7 +15322,10 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
     }
     else if (!rsp.str.isEmpty())
     {
-        rsp.contentType = HttpContentJson;
+        if (rsp.contentType != HttpContentPrometheus)
+        {
+            rsp.contentType = HttpContentJson;
+        }
         str = rsp.str;
     }
 
@@ -14811,10 +15335,62 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
         rsp.httpStatus = HttpStatusOk;
     }
 
-    stream << "HTTP/1.1 " << rsp.httpStatus << "\r\n";
-    stream << "Access-Control-Allow-Origin: *\r\n";
-    stream << "Content-Type: " << rsp.contentType << "\r\n";
-    stream << "Content-Length:" << QString::number(str.toUtf8().size()) << "\r\n";
+    // encode the body only once, compress it if the client allows
+    QByteArray body = str.toUtf8();
+    const char *contentEncoding = nullptr;
+
+    if (body.size() >= HttpCompressMinSize)
+    {
+        const HttpEncoding encoding = httpAcceptedEncoding(hdr);
+
+        if (encoding != HttpEncodingIdentity)
+        {
+            const QByteArray compressed = httpCompress(body, encoding);
+
+            if (!compressed.isEmpty() && compressed.size() < body.size())
+            {
+                d->metrics.increment(QLatin1String("http_compressed_bytes_saved_total"), quint64(body.size() - compressed.size()));
+                body = compressed;
+                contentEncoding = (encoding == HttpEncodingGzip) ? "gzip" : "deflate";
+            }
+        }
+    }
+
+    QByteArray out;
+    out.reserve(256 + body.size());
+    out.append("HTTP/1.1 ").append(rsp.httpStatus).append("\r\n");
+    out.append("Access-Control-Allow-Origin: *\r\n");
+    out.append("Content-Type: ").append(rsp.contentType).append("\r\n");
+    out.append("Content-Length:").append(QByteArray::number(body.size())).append("\r\n");
+
+    if (contentEncoding)
+    {
+        out.append("Content-Encoding: ").append(contentEncoding).append("\r\n");
+        out.append("Vary: Accept-Encoding\r\n");
+    }
+
+    // HTTP/1.1 connections are persistent unless the client asks otherwise,
+    // HTTP/1.0 connections only if the client asks for it
+    const QString connection = hdr.value(QLatin1String("Connection"));
+    const bool http11 = hdr.majorVersion() > 1 || (hdr.majorVersion() == 1 && hdr.minorVersion() >= 1);
+    bool keepAlive;
+    if (http11)
+    {
+        keepAlive = !connection.contains(QLatin1String("close"), Qt::CaseInsensitive);
+    }
+    else
+    {
+        keepAlive = connection.contains(QLatin1String("keep-alive"), Qt::CaseInsensitive);
+    }
+
+    if (!keepAlive)
+    {
+        out.append("Connection: close\r\n");
+    }
+    else if (!http11)
+    {
+        out.append("Connection: keep-alive\r\n");
+    }
 
     if (!rsp.hdrFields.empty())
     {
@@ -14823,22 +15399,26 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
 
         for (; i != end; ++i)
         {
-            stream << i->first << ": " <<  i->second << "\r\n";
+            out.append(i->first.toUtf8()).append(": ").append(i->second.toUtf8()).append("\r\n");
         }
     }
 
     if (!rsp.etag.isEmpty())
     {
-        stream << "ETag:" << rsp.etag  << "\r\n";
+        out.append("ETag:").append(rsp.etag.toUtf8()).append("\r\n");
     }
-    stream << "\r\n";
+    out.append("\r\n");
+    out.append(body);
 
-    if (!str.isEmpty())
+    // headers and body in a single write
+    sock->write(out);
+    d->metrics.increment(QLatin1String("http_response_bytes_total"), quint64(out.size()));
+
+    if (!keepAlive)
     {
-        stream << str;
+        d->setClientCloseTimeout(sock, 1); // close after the response is flushed
     }
 
-    stream.flush();
     if (!str.isEmpty())
     {
         DBG_Printf(DBG_HTTP, "%s\n", qPrintable(str));
@@ -14873,45 +15453,44 @@ bool DeRestPlugin::dbSaveAllowed() const
  */
 void DeRestPluginPrivate::openClientTimerFired()
 {
-    std::vector<TcpClient>::iterator i = openClients.begin();
-    std::vector<TcpClient>::iterator end = openClients.end();
+    openClientTicks++;
 
-    for ( ; i != end; ++i)
+    while (!openClientDeadlines.empty() && openClientDeadlines.top().closeTime <= openClientTicks)
     {
-        i->closeTimeout--;
+        const TcpClientDeadline deadline = openClientDeadlines.top();
+        openClientDeadlines.pop();
 
-        if (i->closeTimeout == 0)
-        {
-            i->closeTimeout = -1;
+        auto i = openClients.find(deadline.sock);
 
-            DBG_Assert(i->sock != nullptr);
+        // skip deadlines of refreshed or already destroyed clients
+        if (i == openClients.end() || i->serial != deadline.serial || i->closeTime != deadline.closeTime)
+        {
+            continue;
+        }
 
-            if (i->sock)
-            {
-                QTcpSocket *sock = i->sock;
+        QTcpSocket *sock = i->sock;
+        DBG_Assert(sock != nullptr);
+        openClients.erase(i);
 
-                if (sock->state() == QTcpSocket::ConnectedState)
-                {
-                    DBG_Printf(DBG_INFO_L2, "Close socket port: %u\n", sock->peerPort());
-                    sock->close();
-                }
-                else
-                {
-                    DBG_Printf(DBG_INFO_L2, "Close socket state = %d\n", sock->state());
-                }
+        if (sock)
+        {
+            disconnect(sock, SIGNAL(destroyed()), this, SLOT(clientSocketDestroyed()));
 
-                sock->deleteLater();
-                return;
+            if (sock->state() == QTcpSocket::ConnectedState)
+            {
+                DBG_Printf(DBG_INFO_L2, "Close socket port: %u\n", sock->peerPort());
+                sock->close();
             }
-        }
-        else if (i->closeTimeout < -120)
-        {
-            // cleanup here if not already deleted by socket destroyed slot
-            *i = openClients.back();
-            openClients.pop_back();
-            return;
+            else
+            {
+                DBG_Printf(DBG_INFO_L2, "Close socket state = %d\n", sock->state());
+            }
+
+            sock->deleteLater();
         }
     }
+
+    metrics.setGauge(QLatin1String("http_open_connections"), openClients.size());
 }
 
 /*! Is called before the client socket will be deleted.
@@ -14920,20 +15499,57 @@ void DeRestPluginPrivate::clientSocketDestroyed()
 {
     QObject *obj = sender();
 
-    std::vector<TcpClient>::iterator i = openClients.begin();
-    std::vector<TcpClient>::iterator end = openClients.end();
+    // the object is being destroyed, only its address is used as key
+    auto i = openClients.find(static_cast<QTcpSocket*>(obj));
 
-    for ( ; i != end; ++i)
+    if (i != openClients.end())
     {
-        if (i->sock == obj)
-        {
-            //int dt = i->created.secsTo(QDateTime::currentDateTime());
-            //DBG_Printf(DBG_INFO, "remove socket %s : %u after %d s, %s\n", qPrintable(sock->peerAddress().toString()), sock->peerPort(), dt, qPrintable(i->hdr.path()));
-            *i = openClients.back();
-            openClients.pop_back();
-            return;
-        }
+        //int dt = i->created.secsTo(QDateTime::currentDateTime());
+        //DBG_Printf(DBG_INFO, "remove socket %s : %u after %d s, %s\n", qPrintable(sock->peerAddress().toString()), sock->peerPort(), dt, qPrintable(i->hdr.path()));
+        openClients.erase(i);
+    }
+}
+
+/*! Defers a request until its body is received completely, the socket is closed
+    if the body doesn't arrive within HTTP_BODY_TIMEOUT seconds.
+    \param sock - the client socket
+    \param hdr - the request header with Content-Length
+ */
+void DeRestPluginPrivate::waitForHttpBody(QTcpSocket *sock, const QHttpRequestHeader &hdr)
+{
+    auto i = openClients.find(sock);
+
+    if (i == openClients.end())
+    {
+        return;
     }
+
+    i->hdr = hdr;
+    i->bodyPending = true;
+    setClientCloseTimeout(sock, HTTP_BODY_TIMEOUT);
+    connect(sock, SIGNAL(readyRead()), this, SLOT(clientSocketReadyRead()), Qt::UniqueConnection);
+}
+
+/*! Continues a request deferred by waitForHttpBody() when its body is complete.
+ */
+void DeRestPluginPrivate::clientSocketReadyRead()
+{
+    QTcpSocket *sock = qobject_cast<QTcpSocket*>(sender());
+    auto i = openClients.find(sock);
+
+    if (!sock || i == openClients.end() || !i->bodyPending)
+    {
+        return;
+    }
+
+    const QHttpRequestHeader hdr = i->hdr;
+    if (sock->bytesAvailable() < hdr.value(QLatin1String("Content-Length")).toLongLong())
+    {
+        return;
+    }
+
+    Q_Q(DeRestPlugin);
+    q->handleHttpRequest(hdr, sock);
 }
 
 /*! Returns the endpoint number of the HA endpoint.
@@ -15742,11 +16358,13 @@ void DeRestPluginPrivate::pollNextDevice()
         }
     }
 
-    if (pollNodes.empty()) // TODO time based
+    if (pollNodes.empty())
     {
+        const QDateTime now = QDateTime::currentDateTime();
+
         for (LightNode &l : nodes)
         {
-            if (l.isAvailable() && l.state() == LightNode::StateNormal)
+            if (l.isAvailable() && l.state() == LightNode::StateNormal && isPollDue(&l, now))
             {
                 pollNodes.push_back(&l);
             }
@@ -15754,7 +16372,7 @@ void DeRestPluginPrivate::pollNextDevice()
 
         for (Sensor &s : sensors)
         {
-            if (s.isAvailable() && s.node() && s.node()->nodeDescriptor().receiverOnWhenIdle() && s.deletedState() == Sensor::StateNormal)
+            if (s.isAvailable() && s.node() && s.node()->nodeDescriptor().receiverOnWhenIdle() && s.deletedState() == Sensor::StateNormal && isPollDue(&s, now))
             {
                 pollNodes.push_back(&s);
             }
@@ -15764,6 +16382,8 @@ void DeRestPluginPrivate::pollNextDevice()
     if (restNode && restNode->isAvailable())
     {
         DBG_Printf(DBG_INFO_L2, "poll node %s\n", qPrintable(restNode->uniqueId()));
+        restNode->setLastPoll(QDateTime::currentDateTime());
+        metrics.increment(metricPolls);
         pollManager->poll(restNode);
     }
 }
@@ -15,7 +15,10 @@
 #include <QTime>
 #include <QTimer>
 #include <QElapsedTimer>
+#include <QSet>
 #include <stdint.h>
+#include <functional>
+#include <map>
 #include <queue>
 #if QT_VERSION < 0x050000
 #include <QHttpRequestHeader>
@@ -34,8 +37,14 @@
 #include "resourcelinks.h"
 #include "rule.h"
 #include "bindings.h"
+#include "aps_trace.h"
+#include "cached_clock.h"
+#include "metrics.h"
+#include "rest_router.h"
+#include "webhook_dispatcher.h"
 #include <math.h>
 #include "websocket_server.h"
+#include "zcl_builder.h"
 
 /*! JSON generic error message codes */
 #define ERR_UNAUTHORIZED_USER          1
@@ -77,6 +86,8 @@
 #define MAX_RECOVER_ENTRY_AGE 600
 #define PERMIT_JOIN_SEND_INTERVAL (1000 * 1800)
 #define EXT_PROCESS_TIMEOUT 10000
+#define HTTP_BODY_TIMEOUT 5 // seconds to wait for the rest of a request body
+#define HTTP_MAX_BODY_SIZE (1024 * 1024)
 #define SET_ENDPOINTCONFIG_DURATION (1000 * 16) // time deCONZ needs to update Endpoints
 #define OTA_LOW_PRIORITY_TIME (60 * 2)
 #define CHECK_SENSOR_FAST_ROUNDS 3
@@ -236,6 +247,10 @@
 
 #define READ_MODEL_ID_INTERVAL   (60 * 60) // s
 #define READ_SWBUILD_ID_INTERVAL (60 * 60) // s
+#define POLL_REPORT_WAIT_TIME    360 // s, reported values are considered fresh at least this long
+#define POLL_REPORTING_NODE_INTERVAL (60 * 30) // s, nodes which report their state are polled only this often
+#define POLL_RECENT_CHANGE_TIME  60 // s, recently changed nodes are polled regardless of reports
+#define READ_REPORTING_NODE_FACTOR 4 // groups and scenes of reporting lights are read less often
 
 // write flags
 #define WRITE_OCCUPANCY_CONFIG  (1 << 11)
@@ -300,8 +315,10 @@
 
 #define MAX_GROUP_SEND_DELAY 5000 // ms between to requests to the same group
 #define GROUP_SEND_DELAY 50 // default ms between to requests to the same group
+#define GROUP_FUSION_WINDOW 0 // default ms a group task is held back to absorb newer commands
 #define MAX_TASKS_PER_NODE 2
 #define MAX_BACKGROUND_TASKS 5
+#define MAX_TASK_POOL 25 // finished task nodes kept for reuse
 
 #define MAX_RULE_ILLUMINANCE_VALUE_AGE_MS (1000 * 60 * 20) // 20 minutes
 
@@ -478,6 +495,7 @@ extern const char *HttpContentJS;
 extern const char *HttpContentPNG;
 extern const char *HttpContentJPG;
 extern const char *HttpContentSVG;
+extern const char *HttpContentPrometheus;
 
 // Forward declarations
 class Gateway;
@@ -491,6 +509,7 @@ class QNetworkAccessManager;
 class QProcess;
 class PollManager;
 class RestDevices;
+struct LightStateChange;
 
 struct Schedule
 {
@@ -634,6 +653,8 @@ struct TaskItem
         transitionTime = DEFAULT_TRANSITION_TIME;
         onTime = 0;
         sendTime = 0;
+        queueTime = 0;
+        probeStartUs = 0;
         ordered = false;
     }
 
@@ -644,6 +665,8 @@ struct TaskItem
     uint8_t zclSeq;
     bool ordered; // won't be send until al prior taskIds are send
     int sendTime; // copy of idleTotalCounter
+    qint64 queueTime; // starttimeRef.elapsed() when first queued
+    qint64 probeStartUs; // button indication which caused the task, 0 if none
     bool confirmed;
     bool onOff;
     bool colorLoop;
@@ -773,10 +796,49 @@ class TcpClient
 public:
     QHttpRequestHeader hdr;
     QDateTime created;
-    int closeTimeout; // close socket in n seconds
+    int closeTime; // openClientTicks value when the socket will be closed
+    quint32 serial; // tells stale deadlines apart when a socket address is reused
+    int requests; // requests served on this connection
+    bool bodyPending; // hdr waits for the rest of its body, see clientSocketReadyRead()
     QTcpSocket *sock;
 };
 
+/*! Entry of the open client deadline heap, may be stale if the client was refreshed. */
+struct TcpClientDeadline
+{
+    int closeTime;
+    quint32 serial;
+    QTcpSocket *sock;
+
+    bool operator>(const TcpClientDeadline &other) const { return closeTime > other.closeTime; }
+};
+
+/*! Cached deCONZ::Node with its clusters, see DeRestPluginPrivate::getNodeCacheEntry(). */
+struct NodeCacheEntry
+{
+    const deCONZ::Node *node;
+    QSet<quint32> inClusters; // (endpoint << 16) | cluster id
+    QSet<quint32> outClusters; // (endpoint << 16) | cluster id
+};
+
+/*! Pending Read Reporting Configuration request which precedes a Configure Reporting request. */
+struct ReportingConfigCheck
+{
+    quint8 zclSeqNum;
+    qint64 deadline; // starttimeRef.elapsed() when the check is given up
+    Binding binding; // the node is looked up again, see DeRestPluginPrivate::getRestNodeForBinding()
+    std::vector<ConfigureReportingRequest> requests;
+};
+
+/*! Delayed answer to an SSDP M-SEARCH request. */
+struct UpnpPendingResponse
+{
+    QHostAddress host;
+    quint16 port;
+    quint8 targets; // bitmap of the search targets to answer, see initUpnpPackets()
+    qint64 due; // starttimeRef.elapsed() when the response is sent
+};
+
 /*! \class DeWebPluginPrivate
 
     Pimpl of DeWebPlugin.
@@ -861,6 +923,7 @@ public:
     int getLightData(const ApiRequest &req, ApiResponse &rsp);
     int getLightState(const ApiRequest &req, ApiResponse &rsp);
     int setLightState(const ApiRequest &req, ApiResponse &rsp);
+    bool decodeLightState(const QVariantMap &map, const QString &id, const LightCapabilities &caps, LightStateChange &change, ApiResponse &rsp);
     int setLightAttributes(const ApiRequest &req, ApiResponse &rsp);
     int deleteLight(const ApiRequest &req, ApiResponse &rsp);
     int removeAllScenes(const ApiRequest &req, ApiResponse &rsp);
@@ -877,6 +940,8 @@ public:
     int getGroupAttributes(const ApiRequest &req, ApiResponse &rsp);
     int setGroupAttributes(const ApiRequest &req, ApiResponse &rsp);
     int setGroupState(const ApiRequest &req, ApiResponse &rsp);
+    void stopGroupColorLoop(Group *group, TaskItem &taskRef);
+    bool triggerGroupActionCommand(const RuleAction &action);
     int deleteGroup(const ApiRequest &req, ApiResponse &rsp);
     void handleGroupEvent(const Event &e);
     Group *addGroup();
@@ -946,6 +1011,8 @@ public:
     void queueCheckRuleBindings(const Rule &rule);
     bool evaluateRule(Rule &rule, const Event &e, Resource *eResource, ResourceItem *eItem);
     void indexRuleTriggers(Rule &rule);
+    void scheduleRuleTimeTrigger(const Rule &rule, qint64 fromMs);
+    bool ruleTimeTriggersDue(qint64 nowMs);
     void triggerRule(Rule &rule);
     bool ruleToMap(const Rule *rule, QVariantMap &map);
     int handleWebHook(const RuleAction &action);
@@ -964,12 +1031,20 @@ public:
     int handleCapabilitiesApi(const ApiRequest &req, ApiResponse &rsp);
     int getCapabilities(const ApiRequest &req, ApiResponse &rsp);
 
+    // REST API metrics
+    int handleMetricsApi(const ApiRequest &req, ApiResponse &rsp);
+    int getMetrics(const ApiRequest &req, ApiResponse &rsp);
+    int getMetricsPrometheus(const ApiRequest &req, ApiResponse &rsp);
+
     // REST API common
+    void initRestRouter();
     QVariantMap errorToMap(int id, const QString &ressource, const QString &description);
 
     // UPNP discovery
     void initUpnpDiscovery();
     void initDescriptionXml();
+    void initUpnpPackets();
+    void queueUpnpResponse(const QHostAddress &host, quint16 port, quint8 targets, int mx);
     // Internet discovery
     void initInternetDicovery();
     bool setInternetDiscoveryInterval(int minutes);
@@ -1007,6 +1082,7 @@ public Q_SLOTS:
     Resource *getResource(const char *resource, const QString &id = QString());
     void announceUpnp();
     void upnpReadyRead();
+    void upnpResponseTimerFired();
     void apsdeDataIndication(const deCONZ::ApsDataIndication &ind);
     void apsdeDataConfirm(const deCONZ::ApsDataConfirm &conf);
     void gpDataIndication(const deCONZ::GpDataIndication &ind);
@@ -1032,6 +1108,7 @@ public Q_SLOTS:
     void lockGatewayTimerFired();
     void openClientTimerFired();
     void clientSocketDestroyed();
+    void clientSocketReadyRead();
     void saveDatabaseTimerFired();
     void userActivity();
     bool sendBindRequest(BindingTask &bt);
@@ -1052,7 +1129,6 @@ public Q_SLOTS:
     void verifyRuleBindingsTimerFired();
     void indexRulesTriggers();
     void fastRuleCheckTimerFired();
-    void webhookFinishedRequest(QNetworkReply *reply);
     void daylightTimerFired();
     void handleRuleEvent(const Event &e);
     bool queueBindingTask(const BindingTask &bindingTask);
@@ -1120,6 +1196,12 @@ public Q_SLOTS:
     void eventQueueTimerFired();
     void enqueueEvent(const Event &event);
 
+#ifdef DECONZ_SIMULATION
+    // simulated traffic
+    void simulationTimerFired();
+    void apsReplayTimerFired();
+#endif
+
     // firmware update
     void initFirmwareUpdate();
     void firmwareUpdateTimerFired();
@@ -1189,6 +1271,8 @@ public:
     GroupInfo *getGroupInfo(LightNode *lightNode, uint16_t id);
     GroupInfo *createGroupInfo(LightNode *lightNode, uint16_t id);
     deCONZ::Node *getNodeForAddress(uint64_t extAddr);
+    const NodeCacheEntry *getNodeCacheEntry(quint64 extAddr);
+    void updateNodeCache(const deCONZ::Node *node);
     deCONZ::ZclCluster *getInCluster(deCONZ::Node *node, uint8_t endpoint, uint16_t clusterId);
     uint8_t getSrcEndpoint(RestNodeBase *restNode, const deCONZ::ApsDataRequest &req);
     bool processZclAttributes(LightNode *lightNode);
@@ -1218,12 +1302,16 @@ public:
     bool pushState(QString json, QTcpSocket *sock);
 
     void pushClientForClose(QTcpSocket *sock, int closeTimeout, const QHttpRequestHeader &hdr);
+    void setClientCloseTimeout(QTcpSocket *sock, int closeTimeout);
+    void waitForHttpBody(QTcpSocket *sock, const QHttpRequestHeader &hdr);
 
     uint8_t endpoint();
     QString generateUniqueId(quint64 extAddress, quint8 endpoint, quint16 clusterId);
 
     // Task interface
     bool addTask(const TaskItem &task);
+    void writeZclFrame(TaskItem &task);
+    void recycleTask(std::list<TaskItem> &list, std::list<TaskItem>::iterator i);
     bool addTaskMoveLevel(TaskItem &task, bool withOnOff, bool upDirection, quint8 rate);
     bool addTaskSetOnOff(TaskItem &task, quint8 cmd, quint16 ontime, quint8 flags = 0);
     bool addTaskSetBrightness(TaskItem &task, uint8_t bri, bool withOnOff);
@@ -1264,6 +1352,8 @@ public:
     void handleCommissioningClusterIndication(TaskItem &task, const deCONZ::ApsDataIndication &ind, deCONZ::ZclFrame &zclFrame);
     void handleZdpIndication(const deCONZ::ApsDataIndication &ind);
     bool handleMgmtBindRspConfirm(const deCONZ::ApsDataConfirm &conf);
+    bool sendMgmtBindRequest(BindingTableReader &btReader);
+    void bindingToRule(const Binding &bnd);
     void handleDeviceAnnceIndication(const deCONZ::ApsDataIndication &ind);
     void handleIeeeAddressReqIndication(const deCONZ::ApsDataIndication &ind);
     void handleNwkAddressReqIndication(const deCONZ::ApsDataIndication &ind);
@@ -1279,10 +1369,27 @@ public:
     void sendTimeClusterResponse(const deCONZ::ApsDataIndication &ind, deCONZ::ZclFrame &zclFrame);
     void handleZclAttributeReportIndication(const deCONZ::ApsDataIndication &ind, deCONZ::ZclFrame &zclFrame);
     void handleZclConfigureReportingResponseIndication(const deCONZ::ApsDataIndication &ind, deCONZ::ZclFrame &zclFrame);
+    void handleZclReadReportingConfigResponseIndication(const deCONZ::ApsDataIndication &ind, deCONZ::ZclFrame &zclFrame);
+    bool sendConfigureReportingFrames(BindingTask &bt, const std::vector<ConfigureReportingRequest> &requests);
+    bool sendReadReportingConfigRequest(BindingTask &bt, const std::vector<ConfigureReportingRequest> &requests);
+    bool sendReportingFrame(const BindingTask &bt, quint8 commandId, quint16 manufacturerCode, quint8 zclSeqNum, const QByteArray &payload);
+    RestNodeBase *getRestNodeForBinding(const Binding &bnd);
     void sendZclDefaultResponse(const deCONZ::ApsDataIndication &ind, deCONZ::ZclFrame &zclFrame, quint8 status);
     void taskToLocalData(const TaskItem &task);
     void handleZclAttributeReportIndicationXiaomiSpecial(const deCONZ::ApsDataIndication &ind, deCONZ::ZclFrame &zclFrame);
     void queuePollNode(RestNodeBase *node);
+    bool isPollDue(RestNodeBase *restNode, const QDateTime &now);
+
+    // APS traffic record and replay
+    void initApsTrace();
+
+#ifdef DECONZ_SIMULATION
+    // simulated traffic
+    void initSimulation();
+    bool simulateLightReport(const LightNode &lightNode, deCONZ::ApsDataIndication &ind);
+    bool simulateSensorReport(const Sensor &sensor, deCONZ::ApsDataIndication &ind);
+    void replayApsTraceRecord(const ApsTraceRecord &rec);
+#endif
 
     // Modify node attributes
     void setAttributeOnOff(LightNode *lightNode);
@@ -1442,6 +1549,7 @@ public:
     bool gwFirmwareNeedUpdate;
     QString gwUpdateChannel;
     int gwGroupSendDelay;
+    int gwGroupFusionWindow;
     uint gwZigbeeChannel;
     uint16_t gwGroup0;
     QVariantMap gwConfig;
@@ -1500,6 +1608,14 @@ public:
 
     // upnp
     QByteArray descriptionXml;
+    QByteArray descriptionXmlResponse; // HTTP header and body
+    QByteArray upnpNotify[3]; // per target: rootdevice, uuid, basic
+    QByteArray upnpSearchResponse[3];
+    QString upnpSearchTargetUuid;
+    std::vector<UpnpPendingResponse> upnpPendingResponses;
+    QTimer *upnpResponseTimer;
+    qint64 upnpResponseWindow; // start of the rate limit window
+    int upnpResponseCount;
 
     // gateway lock (link button)
     QTimer *lockGatewayTimer;
@@ -1516,7 +1632,7 @@ public:
     std::vector<Schedule> schedules;
 
     // webhooks
-    QNetworkAccessManager *webhookManager = nullptr;
+    WebhookDispatcher *webhookDispatcher = nullptr;
 
     // internet discovery
     QNetworkAccessManager *inetDiscoveryManager;
@@ -1717,6 +1833,7 @@ public:
     // rules
     std::vector<int> fastRuleCheck;
     QTimer *fastRuleCheckTimer;
+    std::multimap<qint64, int> ruleTimeTriggers; // ms since epoch -> rule handle
 
     // general
     ApiConfig config;
@@ -1741,6 +1858,8 @@ public:
     std::vector<Sensor> sensors;
     std::list<TaskItem> tasks;
     std::list<TaskItem> runningTasks;
+    ZclBufferPool zclBufferPool;
+    std::list<TaskItem> taskPool; // nodes of finished tasks, see recycleTask()
     QTimer *verifyRulesTimer;
     QTimer *taskTimer;
     QTimer *groupTaskTimer;
@@ -1757,6 +1876,22 @@ public:
     QTimer *eventTimer;
     std::deque<Event> eventQueue;
 
+    // APS traffic record
+    ApsTraceWriter apsTraceWriter;
+
+#ifdef DECONZ_SIMULATION
+    // simulated traffic and APS traffic replay
+    QTimer *simulationTimer;
+    int simulationRate; // attribute reports per second
+    int simulationBudget; // carried reports * 1000
+    quint32 simulationIter;
+    ApsTraceReader apsTraceReader;
+    ApsTraceRecord apsReplayRecord;
+    QElapsedTimer apsReplayTime;
+    QTimer *apsReplayTimer;
+    int apsReplaySpeed;
+#endif
+
     // bindings
     size_t verifyRuleIter;
     bool gwReportingEnabled;
@@ -1764,18 +1899,47 @@ public:
     QTimer *bindingTimer;
     QTimer *bindingTableReaderTimer;
     std::list<Binding> bindingToRuleQueue; // check if rule exists for discovered bindings
+    QHash<quint64, NodeCacheEntry> nodeCache; // key: ext address
     std::list<BindingTask> bindingQueue; // bind/unbind queue
-    std::vector<BindingTableReader> bindingTableReaders;
+    QHash<BindingTaskKey, std::list<BindingTask>::iterator> bindingQueueIndex; // fast lookup into bindingQueue
+    std::vector<ReportingConfigCheck> reportingConfigChecks;
+    QHash<quint64, BindingTableReader> bindingTableReaders; // key: ext address of the node
 
     // TCP connection watcher
     QTimer *openClientTimer;
-    std::vector<TcpClient> openClients;
+    QHash<QTcpSocket*, TcpClient> openClients;
+    std::priority_queue<TcpClientDeadline, std::vector<TcpClientDeadline>, std::greater<TcpClientDeadline> > openClientDeadlines;
+    int openClientTicks; // seconds, incremented by openClientTimerFired()
+    quint32 openClientSerial;
 
     WebSocketServer *webSocketServer;
 
     // will be set at startup to calculate the uptime
     QElapsedTimer starttimeRef;
 
+    // runtime telemetry, served at /api/<apikey>/metrics
+    Metrics metrics;
+    // handles of metrics updated on hot paths
+    int metricApsIndications;
+    int metricApsIndicationDuration;
+    int metricTaskQueueDepth;
+    int metricTaskRunning;
+    int metricTaskQueueTime;
+    int metricButtonToApsRequest;
+    int metricEvents;
+    int metricEventQueueDepth;
+    int metricTaskPoolReused;
+    int metricPollSkippedReporting;
+    int metricPolls;
+
+    // button to light latency probe, starttimeRef based timestamps in us
+    qint64 apsIndicationStartUs; // current apsdeDataIndication()
+    qint64 buttonEventStartUs; // indication of the last button event
+    qint64 ruleTriggerStartUs; // set while rules of a button event are triggered
+
+    // REST API routes below /api/<apikey>
+    RestRouter restRouter;
+
     Q_DECLARE_PUBLIC(DeRestPlugin)
     DeRestPlugin *q_ptr; // public interface
 
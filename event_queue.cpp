@@ -37,6 +37,9 @@ void DeRestPluginPrivate::eventQueueTimerFired()
 
     eventQueue.pop_front();
 
+    metrics.increment(metricEvents);
+    metrics.setGauge(metricEventQueueDepth, qint64(eventQueue.size()));
+
     if (!eventQueue.empty())
     {
         eventTimer->start();
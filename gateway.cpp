@@ -1,4 +1,5 @@
 #include <QBuffer>
+#include <QElapsedTimer>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QTimer>
@@ -7,9 +8,11 @@
 #include "gateway.h"
 #include "group.h"
 #include "json.h"
+#include <deque>
 
 
 #define PHILIPS_MAC_PREFIX QLatin1String("001788")
+#define GW_MAX_COMMANDS 32 // queued commands per gateway
 
 enum GW_Event
 {
@@ -32,6 +35,7 @@ public:
     } param;
     quint8 mode;
     quint16 transitionTime;
+    qint64 queueTime; // GatewayPrivate::time based
 };
 
 class GatewayPrivate
@@ -46,6 +50,8 @@ public:
     void checkGroupsResponse(const QByteArray &data);
     void checkAuthResponse(const QByteArray &data);
     bool hasAuthorizedError(const QVariant &var);
+    void addCommand(const Command &cmd);
+    bool coalesceCommand(const Command &cmd);
 
     DeRestPluginPrivate *parent;
     Gateway::State state;
@@ -64,7 +70,9 @@ public:
     int pings;
     std::vector<Gateway::Group> groups;
     std::vector<Gateway::CascadeGroup> cascadeGroups;
-    std::vector<Command> commands;
+    std::deque<Command> commands;
+    QElapsedTimer time;
+    qint64 commandQueueTime; // of the command in flight, -1 for other requests
 };
 
 Gateway::Gateway(DeRestPluginPrivate *parent) :
@@ -79,6 +87,8 @@ Gateway::Gateway(DeRestPluginPrivate *parent) :
     d->pairingEnabled = false;
     d->needSaveDatabase = false;
     d->reply = nullptr;
+    d->commandQueueTime = -1;
+    d->time.start();
     d->manager = new QNetworkAccessManager(this);
     connect(d->manager, SIGNAL(finished(QNetworkReply*)), this, SLOT(finished(QNetworkReply*)));
     d->timer = new QTimer(this);
@@ -385,7 +395,8 @@ void Gateway::handleGroupCommand(const deCONZ::ApsDataIndication &ind, deCONZ::Z
             cmd.clusterId = ind.clusterId();
             cmd.groupId = cg.remote;
             cmd.commandId = zclFrame.commandId();
-            d->commands.push_back(cmd);
+            cmd.queueTime = d->time.elapsed();
+            d->addCommand(cmd);
             d->handleEvent(EventCommandAdded);
 
             DBG_Printf(DBG_INFO, "GW %s forward command 0x%02X on cluster 0x%04X on group 0x%04X to remote group 0x%04X\n", qPrintable(d->name), zclFrame.commandId(), ind.clusterId(), cg.local, cg.remote);
@@ -430,6 +441,98 @@ void Gateway::error(QNetworkReply::NetworkError)
 }
 
 
+/*! Queues a command for the remote gateway.
+    Superseded commands which are still waiting are coalesced, the queue is limited
+    to GW_MAX_COMMANDS where the oldest commands are dropped.
+ */
+void GatewayPrivate::addCommand(const Command &cmd)
+{
+    if (coalesceCommand(cmd))
+    {
+        parent->metrics.increment(QLatin1String("gateway_commands_total{result=\"coalesced\"}"));
+        return;
+    }
+
+    if (commands.size() >= GW_MAX_COMMANDS)
+    {
+        commands.pop_front();
+        parent->metrics.increment(QLatin1String("gateway_commands_total{result=\"dropped\"}"));
+    }
+
+    commands.push_back(cmd);
+    parent->metrics.setGauge(QLatin1String("gateway_command_queue_depth"), qint64(commands.size()));
+}
+
+/*! Merges \p cmd into the last queued command if it supersedes it.
+    Only the tail is considered so that the order of the commands is kept.
+    A level or color temperature step in the same direction adds up its step size,
+    a move to level replaces a waiting step, move or move to level since it sets an
+    absolute level, and a repeated stop is dropped. A stop never replaces a move,
+    otherwise the movement it should end would not be sent at all.
+    \return true if \p cmd was merged
+ */
+bool GatewayPrivate::coalesceCommand(const Command &cmd)
+{
+    if (commands.empty())
+    {
+        return false;
+    }
+
+    Command &last = commands.back();
+
+    if (last.groupId != cmd.groupId || last.clusterId != cmd.clusterId)
+    {
+        return false;
+    }
+
+    bool stepCommand = false;
+    bool replaces = false;
+
+    if (cmd.clusterId == LEVEL_CLUSTER_ID)
+    {
+        // the ..with on/off commands aren't listed to keep their on part
+        stepCommand = cmd.commandId == LEVEL_COMMAND_STEP && last.commandId == LEVEL_COMMAND_STEP;
+
+        if (cmd.commandId == LEVEL_COMMAND_MOVE_TO_LEVEL)
+        {
+            replaces = last.commandId == LEVEL_COMMAND_MOVE_TO_LEVEL ||
+                       last.commandId == LEVEL_COMMAND_MOVE ||
+                       last.commandId == LEVEL_COMMAND_STEP;
+        }
+        else if (cmd.commandId == LEVEL_COMMAND_STOP)
+        {
+            replaces = last.commandId == LEVEL_COMMAND_STOP;
+        }
+    }
+    else if (cmd.clusterId == SCENE_CLUSTER_ID)
+    {
+        // there is no absolute color temperature command in the scene cluster
+        stepCommand = cmd.commandId == SCENE_COMMAND_IKEA_STEP_CT && last.commandId == SCENE_COMMAND_IKEA_STEP_CT;
+        replaces = cmd.commandId == SCENE_COMMAND_IKEA_STOP_CT && last.commandId == SCENE_COMMAND_IKEA_STOP_CT;
+    }
+
+    if (stepCommand)
+    {
+        if (cmd.mode != last.mode)
+        {
+            return false;
+        }
+        last.param.level = quint8(qMin(254, last.param.level + cmd.param.level));
+        last.transitionTime = cmd.transitionTime;
+        return true;
+    }
+
+    if (replaces)
+    {
+        const qint64 queueTime = last.queueTime; // latency counts from the first command
+        last = cmd;
+        last.queueTime = queueTime;
+        return true;
+    }
+
+    return false;
+}
+
 void GatewayPrivate::startTimer(int msec, GW_Event event)
 {
     timerAction = event;
@@ -617,7 +720,10 @@ void GatewayPrivate::handleEventStateConnected(GW_Event event)
                         qPrintable(address.toString()), port, qPrintable(apikey));
 
             pings++;
-            reply = manager->get(QNetworkRequest(url));
+            commandQueueTime = -1;
+            QNetworkRequest req(url);
+            req.setRawHeader("Connection", "keep-alive");
+            reply = manager->get(req);
             QObject::connect(reply, SIGNAL(error(QNetworkReply::NetworkError)),
                     manager->parent(), SLOT(error(QNetworkReply::NetworkError)));
         }
@@ -627,7 +733,9 @@ void GatewayPrivate::handleEventStateConnected(GW_Event event)
             double level;
             QString url;
             QVariantMap map;
-            const Command &cmd = commands.back();
+            const Command cmd = commands.front();
+            commands.pop_front();
+            parent->metrics.setGauge(QLatin1String("gateway_command_queue_depth"), qint64(commands.size()));
 
             if (cmd.clusterId == SCENE_CLUSTER_ID)
             {
@@ -741,11 +849,9 @@ void GatewayPrivate::handleEventStateConnected(GW_Event event)
                 }
             }
 
-            commands.pop_back();
-
             if (!ok)
             {
-                startTimer(50, EventTimeout);
+                startTimer(commands.empty() ? 15000 : 0, ActionProcess);
                 return;
             }
 
@@ -774,7 +880,9 @@ void GatewayPrivate::handleEventStateConnected(GW_Event event)
             reqBuffer->open(QBuffer::ReadOnly);
 
             QNetworkRequest req(url);
+            req.setRawHeader("Connection", "keep-alive");
             reply = manager->put(req, reqBuffer);
+            commandQueueTime = cmd.queueTime;
 
             QObject::connect(reply, SIGNAL(error(QNetworkReply::NetworkError)),
                     manager->parent(), SLOT(error(QNetworkReply::NetworkError)));
@@ -791,6 +899,15 @@ void GatewayPrivate::handleEventStateConnected(GW_Event event)
             reply = 0;
             int code = r->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
 
+            if (commandQueueTime >= 0)
+            {
+                // from the local group command until the remote gateway has answered
+                parent->metrics.record(QLatin1String("gateway_forward_latency_ms"), time.elapsed() - commandQueueTime);
+                parent->metrics.increment(code == 200 ? QLatin1String("gateway_commands_total{result=\"ok\"}")
+                                                      : QLatin1String("gateway_commands_total{result=\"error\"}"));
+                commandQueueTime = -1;
+            }
+
             if (code == 200)
             {
                 // ok check again later
@@ -799,7 +916,8 @@ void GatewayPrivate::handleEventStateConnected(GW_Event event)
                     pings = 0;
                     checkGroupsResponse(r->readAll());
                 }
-                startTimer(15000, ActionProcess);
+                // queued commands are sent right away over the kept alive connection
+                startTimer(commands.empty() ? 15000 : 0, ActionProcess);
             }
             else if (code == 403)
             {
@@ -827,6 +945,11 @@ void GatewayPrivate::handleEventStateConnected(GW_Event event)
                 r->abort();
             }
             r->deleteLater();
+            if (commandQueueTime >= 0)
+            {
+                parent->metrics.increment(QLatin1String("gateway_commands_total{result=\"timeout\"}"));
+                commandQueueTime = -1;
+            }
         }
         if (pings > 5)
         {
@@ -9,51 +9,77 @@
  */
 
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QTimer>
 #include <QNetworkAccessManager>
 #include <QNetworkInterface>
 #include <QNetworkReply>
+#include <algorithm>
+#include <deque>
 #include <vector>
 #include "gateway_scanner.h"
 #include "deconz.h"
 #include "json.h"
 
+#define SCAN_MAX_IN_FLIGHT   32
+#define SCAN_PROBE_TIMEOUT   200 // ms
+#define SCAN_CACHE_TTL_FOUND (5 * 60 * 1000) // ms
+#define SCAN_CACHE_TTL_EMPTY (10 * 60 * 1000) // ms
+
 enum ScanState
 {
     StateInit,
-    StateIdle,
-    StateRunning,
+    StateRunning
 };
 
-enum ScanEvent
+/*! A running request to one host. */
+class ScanProbe
 {
-    ActionProcess,
-    EventTimeout,
-    EventGotReply
+public:
+    QNetworkReply *reply;
+    quint32 ip;
+    qint64 deadline; // GatewayScannerPrivate::time based
+};
+
+/*! The last result for one host, found or not. */
+class ScanResult
+{
+public:
+    qint64 time;
+    bool found;
+    quint16 port;
+    QString uuid;
+    QString name;
 };
 
 class GatewayScannerPrivate
 {
 public:
     void initScanner();
-    void handleEvent(ScanEvent event);
-    void startScanTimer(int msec, ScanEvent action);
-    void stopTimer();
-    void queryNextIp();
-    void processReply();
+    bool nextScanIp(quint32 *ip);
+    void fillWindow();
+    bool isProbing(quint32 ip) const;
+    void startProbe(const QString &url, quint32 ip);
+    void processReply(QNetworkReply *reply, quint32 ip);
+    void checkTimeouts();
+    void armTimer();
+    bool cachedResult(quint32 ip);
+    void setCachedResult(quint32 ip, bool found, quint16 port = 0, const QString &uuid = QString(), const QString &name = QString());
 
     GatewayScanner *q;
     ScanState state;
     QNetworkAccessManager *manager;
-    QNetworkReply *reply;
     QTimer *timer;
-    ScanEvent timerAction;
+    QElapsedTimer time;
     std::vector<quint32> interfaces;
-    quint32 scanIp;
-    quint16 scanPort;
+    std::deque<ScanProbe> probes; // ordered by deadline since all probes have the same timeout
+    QHash<quint32, ScanResult> cache;
+    int maxInFlight;
+    int probeTimeout;
     int scanIteration;
     quint32 host;
-    size_t interfaceIter;
+    qint64 scanStart;
 };
 
 GatewayScanner::GatewayScanner(QObject *parent) :
@@ -64,6 +90,11 @@ GatewayScanner::GatewayScanner(QObject *parent) :
     d->q = this;
     d->scanIteration = 0;
     d->state = StateInit;
+    d->maxInFlight = SCAN_MAX_IN_FLIGHT;
+    d->probeTimeout = SCAN_PROBE_TIMEOUT;
+    d->host = 0;
+    d->scanStart = 0;
+    d->time.start();
     d->manager = new QNetworkAccessManager(this);
     connect(d->manager, SIGNAL(finished(QNetworkReply*)), this, SLOT(requestFinished(QNetworkReply*)));
     d->timer = new QTimer(this);
@@ -88,16 +119,41 @@ bool GatewayScanner::isRunning() const
     return (d->state != StateInit);
 }
 
+/*! Sets the maximum number of concurrent probes of a scan.
+ */
+void GatewayScanner::setMaxInFlight(int maxInFlight)
+{
+    Q_D(GatewayScanner);
+    d->maxInFlight = qMax(1, maxInFlight);
+}
+
+/*! Sets the time after which a probe without reply is aborted.
+ */
+void GatewayScanner::setProbeTimeout(int msec)
+{
+    Q_D(GatewayScanner);
+    d->probeTimeout = qMax(10, msec);
+}
+
+/*! Queries a single gateway, e.g. announced via SSDP.
+    The result is cached, so that the host isn't probed again by the next scan.
+    Hosts with a cached "no gateway" result, e.g. other UPnP devices announcing
+    themselves periodically, aren't probed again until the entry expires.
+ */
 void GatewayScanner::queryGateway(const QString &url)
 {
     Q_D(GatewayScanner);
 
-    if (!isRunning() && d->reply == 0)
+    const QHostAddress addr(QUrl(url).host());
+    const quint32 ip = addr.toIPv4Address();
+
+    if (ip == 0 || d->isProbing(ip) || d->cachedResult(ip))
     {
-        d->reply = d->manager->get(QNetworkRequest(url));
-        QObject::connect(d->reply, SIGNAL(error(QNetworkReply::NetworkError)),
-                d->manager->parent(), SLOT(onError(QNetworkReply::NetworkError)));
+        return;
     }
+
+    d->startProbe(url, ip);
+    d->armTimer();
 }
 
 void GatewayScanner::startScan()
@@ -106,46 +162,48 @@ void GatewayScanner::startScan()
 
     if (d->state == StateInit)
     {
-        d->startScanTimer(1, ActionProcess);
+        d->initScanner();
+        d->state = StateRunning;
+        d->fillWindow();
     }
 }
 
 void GatewayScanner::scanTimerFired()
 {
     Q_D(GatewayScanner);
-    d->handleEvent(d->timerAction);
+    d->checkTimeouts();
+    d->fillWindow();
 }
 
 void GatewayScanner::requestFinished(QNetworkReply *reply)
 {
     Q_D(GatewayScanner);
 
-    if (reply == d->reply)
-    {
-        d->processReply();
-    }
+    auto i = std::find_if(d->probes.begin(), d->probes.end(),
+                          [reply](const ScanProbe &probe) { return probe.reply == reply; });
 
-    if (isRunning())
+    if (i == d->probes.end())
     {
-        d->handleEvent(EventGotReply);
+        return; // timed out and aborted
     }
+
+    const quint32 ip = i->ip;
+    d->probes.erase(i);
+    reply->deleteLater();
+
+    d->processReply(reply, ip);
+    d->fillWindow();
 }
 
-void GatewayScannerPrivate::processReply()
+void GatewayScannerPrivate::processReply(QNetworkReply *reply, quint32 ip)
 {
-    if (!reply)
-    {
-        return;
-    }
-
     QNetworkReply *r = reply;
-    reply = 0;
-    r->deleteLater();
 
     int code = r->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
 
     if (code != 200) // not authorized or ok
     {
+        setCachedResult(ip, false);
         return;
     }
 
@@ -153,12 +211,14 @@ void GatewayScannerPrivate::processReply()
     QVariant var = Json::parse(r->readAll(), ok);
     if (!ok)
     {
+        setCachedResult(ip, false);
         return;
     }
 
     QVariantMap map = var.toMap();
     if (map.isEmpty())
     {
+        setCachedResult(ip, false);
         return;
     }
 
@@ -166,6 +226,7 @@ void GatewayScannerPrivate::processReply()
         !map.contains(QLatin1String("modelid")) ||
         !map.contains(QLatin1String("name")))
     {
+        setCachedResult(ip, false);
         return;
     }
 
@@ -178,32 +239,16 @@ void GatewayScannerPrivate::processReply()
     QHostAddress host(url.host());
     if (host.isNull() || name.isEmpty() || bridgeid.isEmpty())
     {
+        setCachedResult(ip, false);
         return;
     }
 
+    setCachedResult(ip, true, url.port(80), bridgeid, name);
+
     //DBG_Printf(DBG_INFO, "GW: %s %s, %s, %s\n", qPrintable(url.host()), qPrintable(name), qPrintable(modelid), qPrintable(bridgeid));
     q->foundGateway(host, url.port(80), bridgeid, name);
 }
 
-void GatewayScanner::onError(QNetworkReply::NetworkError code)
-{
-    Q_D(GatewayScanner);
-    Q_UNUSED(code);
-
-    if (!d->timer->isActive())
-    {
-        // must be in timeout window
-        return;
-    }
-
-    if (d->reply && sender() == d->reply)
-    {
-        //DBG_Printf(DBG_INFO, "reply err: %d\n", code);
-        d->timer->stop();
-        d->handleEvent(EventGotReply);
-    }
-}
-
 void GatewayScannerPrivate::initScanner()
 {
     QList<QNetworkInterface> ifaces = QNetworkInterface::allInterfaces();
@@ -211,6 +256,8 @@ void GatewayScannerPrivate::initScanner()
     QList<QNetworkInterface>::Iterator ifi = ifaces.begin();
     QList<QNetworkInterface>::Iterator ifend = ifaces.end();
 
+    interfaces.clear();
+
     for (; ifi != ifend; ++ifi)
     {
         QString name = ifi->humanReadableName();
@@ -250,112 +297,165 @@ void GatewayScannerPrivate::initScanner()
     }
 
     scanIteration++;
-    interfaceIter = 0;
+    scanStart = time.elapsed();
     host = 0;
 }
 
-void GatewayScannerPrivate::handleEvent(ScanEvent event)
+/*! Returns the next address of the /24 subnets of the interfaces.
+    \return false if all subnets are scanned
+ */
+bool GatewayScannerPrivate::nextScanIp(quint32 *ip)
 {
-    if (state == StateInit)
+    while (!interfaces.empty())
     {
-        if (event == ActionProcess)
+        if (host > 255)
         {
-            initScanner();
-            state = StateIdle;
-            startScanTimer(10, ActionProcess);
+            interfaces.pop_back();
+            host = 0;
+            continue;
         }
-        else
+
+        const quint32 scanIp = interfaces.back();
+
+        if (host == (scanIp & 0x000000fful))
         {
-            Q_ASSERT(0);
+            DBG_Printf(DBG_INFO, "scan skip host .%u\n", host);
+            host++; // don't scan own ip
+            continue;
         }
+
+        *ip = (scanIp & 0xffffff00ul) | (host & 0xff);
+        host++;
+        return true;
     }
-    else if (state == StateIdle)
+
+    return false;
+}
+
+/*! Starts probes until maxInFlight requests are running.
+    Hosts with a valid cached result aren't probed again.
+ */
+void GatewayScannerPrivate::fillWindow()
+{
+    if (state == StateRunning)
     {
-        if (event == ActionProcess)
-        {
-            queryNextIp();
-        }
-        else if (event == EventTimeout)
+        quint32 ip;
+        bool more = true;
+
+        while (probes.size() < size_t(maxInFlight))
         {
-            QNetworkReply *r = reply;
-            if (reply)
+            more = nextScanIp(&ip);
+            if (!more)
             {
-                reply = 0;
-                if (r->isRunning())
-                {
-                    r->abort();
-                }
-                r->deleteLater();
+                break;
             }
-            host++;
-            startScanTimer(1, ActionProcess);
-        }
-        else if (event == EventGotReply)
-        {
-            host++;
-            startScanTimer(1, ActionProcess);
+
+            if (isProbing(ip) || cachedResult(ip))
+            {
+                continue;
+            }
+
+            QString url;
+            url.sprintf("http://%u.%u.%u.%u:%u/api/config",
+                        ((ip >> 24) & 0xff),
+                        ((ip >> 16) & 0xff),
+                        ((ip >> 8) & 0xff),
+                        ip & 0xff, 80);
+
+            //DBG_Printf(DBG_INFO, "scan %s\n", qPrintable(url));
+            startProbe(url, ip);
         }
-        else
+
+        if (!more && probes.empty())
         {
-            Q_ASSERT(0);
+            state = StateInit;
+            DBG_Printf(DBG_INFO, "scan finished after %d ms\n", int(time.elapsed() - scanStart));
         }
     }
-    else
-    {
-        Q_ASSERT(0);
-    }
+
+    armTimer();
 }
 
-void GatewayScannerPrivate::startScanTimer(int msec, ScanEvent action)
+bool GatewayScannerPrivate::isProbing(quint32 ip) const
 {
-    timerAction = action;
-    timer->stop();
-    timer->start(msec);
+    return std::find_if(probes.begin(), probes.end(),
+                        [ip](const ScanProbe &probe) { return probe.ip == ip; }) != probes.end();
 }
 
-void GatewayScannerPrivate::stopTimer()
+void GatewayScannerPrivate::startProbe(const QString &url, quint32 ip)
 {
-    timer->stop();
+    ScanProbe probe;
+    probe.reply = manager->get(QNetworkRequest(url));
+    probe.ip = ip;
+    probe.deadline = time.elapsed() + probeTimeout;
+    probes.push_back(probe);
 }
 
-void GatewayScannerPrivate::queryNextIp()
+/*! Aborts the probes which reached their deadline.
+ */
+void GatewayScannerPrivate::checkTimeouts()
 {
-    if (!interfaces.empty() && host > 255)
+    const qint64 now = time.elapsed();
+
+    while (!probes.empty() && probes.front().deadline <= now)
     {
-        interfaces.pop_back();
-        host = 0;
+        const ScanProbe probe = probes.front();
+        probes.pop_front(); // before abort() which emits finished()
+
+        setCachedResult(probe.ip, false);
+
+        if (probe.reply->isRunning())
+        {
+            probe.reply->abort();
+        }
+        probe.reply->deleteLater();
     }
+}
 
-    if (interfaces.empty())
+/*! Starts the single timer for the earliest probe deadline.
+ */
+void GatewayScannerPrivate::armTimer()
+{
+    if (probes.empty())
     {
-        state = StateInit;
-        DBG_Printf(DBG_INFO, "scan finished\n");
+        timer->stop();
         return;
     }
 
-    scanIp = interfaces.back();
-    scanPort = 80;
+    timer->start(int(qMax(qint64(0), probes.front().deadline - time.elapsed())));
+}
 
-    if (host == (scanIp & 0x000000fful))
+/*! Returns true if a valid cached result exists for \p ip, found gateways are reported again.
+ */
+bool GatewayScannerPrivate::cachedResult(quint32 ip)
+{
+    auto i = cache.find(ip);
+    if (i == cache.end())
     {
-        DBG_Printf(DBG_INFO, "scan skip host .%u\n", host);
-        host++; // don't scan own ip
+        return false;
     }
 
-    QString url;
-    url.sprintf("http://%u.%u.%u.%u:%u/api/config",
-                ((scanIp >> 24) & 0xff),
-                ((scanIp >> 16) & 0xff),
-                ((scanIp >> 8) & 0xff),
-                host & 0xff, scanPort);
+    const ScanResult &res = i.value();
+    if (time.elapsed() - res.time > (res.found ? SCAN_CACHE_TTL_FOUND : SCAN_CACHE_TTL_EMPTY))
+    {
+        cache.erase(i);
+        return false;
+    }
 
-    scanIp &= 0xffffff00ull;
-    scanIp |= host & 0xff;
+    if (res.found)
+    {
+        q->foundGateway(QHostAddress(ip), res.port, res.uuid, res.name);
+    }
 
-    //DBG_Printf(DBG_INFO, "scan %s\n", qPrintable(url));
-    reply = manager->get(QNetworkRequest(url));
-    QObject::connect(reply, SIGNAL(error(QNetworkReply::NetworkError)),
-            manager->parent(), SLOT(onError(QNetworkReply::NetworkError)));
+    return true;
+}
 
-    startScanTimer(100, EventTimeout);
+void GatewayScannerPrivate::setCachedResult(quint32 ip, bool found, quint16 port, const QString &uuid, const QString &name)
+{
+    ScanResult &res = cache[ip];
+    res.time = time.elapsed();
+    res.found = found;
+    res.port = port;
+    res.uuid = uuid;
+    res.name = name;
 }
@@ -15,6 +15,8 @@ public:
     ~GatewayScanner();
     bool isRunning() const;
     void queryGateway(const QString &url);
+    void setMaxInFlight(int maxInFlight);
+    void setProbeTimeout(int msec);
 
 Q_SIGNALS:
     void foundGateway(const QHostAddress &host, quint16 port, const QString &uuid, const QString &name);
@@ -25,7 +27,6 @@ public Q_SLOTS:
 private Q_SLOTS:
     void scanTimerFired();
     void requestFinished(QNetworkReply *reply);
-    void onError(QNetworkReply::NetworkError code);
 
 private:
     Q_DECLARE_PRIVATE(GatewayScanner)
@@ -22,6 +22,10 @@ Group::Group() :
     m_colorLoopActive(false)
 {
    sendTime = QTime::currentTime();
+   sendCount = 0;
+   fusedCount = 0;
+   sendLatencySum = 0;
+   sendLatencyMax = 0;
    hidden = false;
    hueReal = 0;
    hue = 0;
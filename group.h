@@ -67,6 +67,10 @@ public:
     QString colormode;
     std::vector<Scene> scenes;
     QTime sendTime;
+    quint32 sendCount; // group casts sent
+    quint32 fusedCount; // group casts dropped since a newer task superseded them
+    qint64 sendLatencySum; // ms from queueing to sending, summed over sendCount
+    qint64 sendLatencyMax;
     bool hidden;
     std::vector<QString> m_multiDeviceIds;
     std::vector<QString> m_lightsequence;
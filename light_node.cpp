@@ -23,7 +23,8 @@ LightNode::LightNode() :
    m_colorLoopActive(false),
    m_colorLoopSpeed(0),
    m_groupCount(0),
-   m_sceneCapacity(16)
+   m_sceneCapacity(16),
+   m_capsItemCount(-1)
 
 {
     // add common items
@@ -76,6 +77,7 @@ void LightNode::setManufacturerCode(uint16_t code)
     if (m_manufacturerCode != code)
     {
         m_manufacturerCode = code;
+        invalidateCapabilities();
 
         if (!manufacturer().isEmpty() && (manufacturer() != QLatin1String("Unknown")))
         {
@@ -137,6 +139,7 @@ const QString &LightNode::modelId() const
 void LightNode::setModelId(const QString &modelId)
 {
     item(RAttrModelId)->setValue(modelId.trimmed());
+    invalidateCapabilities();
 }
 
 /*! Returns the software build identifier.
@@ -314,6 +317,7 @@ void LightNode::setHaEndpoint(const deCONZ::SimpleDescriptor &endpoint)
 {
     bool isInitialized = m_haEndpoint.isValid();
     m_haEndpoint = endpoint;
+    invalidateCapabilities();
 
     // check if std otau cluster present in endpoint
     if (otauClusterId() == 0)
@@ -537,6 +541,7 @@ void LightNode::setHaEndpoint(const deCONZ::SimpleDescriptor &endpoint)
         }
 
         item(RAttrType)->setValue(ltype);
+        invalidateCapabilities();
     }
 }
 
@@ -615,6 +620,109 @@ void LightNode::setSceneCapacity(uint8_t sceneCapacity)
     m_sceneCapacity = sceneCapacity;
 }
 
+/*! Returns \p ct kept in the supported color temperature bounds of the light.
+    \param ct - mired color temperature
+ */
+quint16 LightCapabilities::boundedCt(quint16 ct) const
+{
+    if (has(CapCtRange))
+    {
+        if      (ct < ctMin) { return ctMin; }
+        else if (ct > ctMax) { return ctMax; }
+    }
+    return ct;
+}
+
+/*! Returns the compiled capabilities of the light.
+    The profile is rebuilt lazily after invalidateCapabilities() was called or
+    resource items were added or removed.
+ */
+const LightCapabilities &LightNode::capabilities() const
+{
+    if (m_capsItemCount == itemCount())
+    {
+        return m_caps;
+    }
+
+    LightCapabilities caps;
+    const ResourceItem *i = nullptr;
+
+    if (item(RStateOn))  { caps.flags |= LightCapabilities::CapOnOff; }
+    if (item(RStateBri)) { caps.flags |= LightCapabilities::CapLevel; }
+    if (item(RStateHue) && item(RStateSat)) { caps.flags |= LightCapabilities::CapHueSat; }
+    if (item(RStateX) && item(RStateY))     { caps.flags |= LightCapabilities::CapXy; }
+    if (item(RStateCt))  { caps.flags |= LightCapabilities::CapCt; }
+
+    i = item(RConfigColorCapabilities);
+    if (i)
+    {
+        caps.colorCapabilities = static_cast<quint16>(i->toNumber());
+    }
+
+    i = item(RConfigCtMin);
+    if (i && i->toNumber() > 0)
+    {
+        caps.ctMin = static_cast<quint16>(i->toNumber());
+    }
+
+    i = item(RConfigCtMax);
+    if (i && i->toNumber() > 0)
+    {
+        caps.ctMax = static_cast<quint16>(i->toNumber());
+    }
+
+    if (caps.ctMin > 0 && caps.ctMax > 0)
+    {
+        caps.flags |= LightCapabilities::CapCtRange;
+    }
+
+    // If light does not support "ct" but does suport "xy", we can emulate the former.
+    // IKEA lights need to use "xy" because move to color temperature is broken and
+    // won't update x,y values resulting in broken scenes.
+    const bool supportsXy = caps.colorCapabilities & 0x0008;
+    const bool supportsCt = caps.colorCapabilities & 0x0010;
+    if ((supportsXy && !supportsCt) || manufacturerCode() == VENDOR_IKEA)
+    {
+        caps.flags |= LightCapabilities::CapCtViaXy;
+    }
+
+    if (manufacturerCode() == VENDOR_ATMEL && modelId() == QLatin1String("FLS-H"))
+    {
+        caps.flags |= LightCapabilities::CapCtViaSat;
+    }
+
+    if (modelId() == QLatin1String("FLS-PP")) // old FLS-PP
+    {
+        caps.flags |= LightCapabilities::CapXyViaHueSat;
+    }
+
+    if (type() == QLatin1String("Window covering device"))
+    {
+        caps.flags |= LightCapabilities::CapWindowCovering;
+        if (modelId().startsWith(QLatin1String("lumi.curtain")))
+        {
+            caps.flags |= LightCapabilities::CapInvertedLift;
+        }
+    }
+    else if (type() == QLatin1String("Warning device"))
+    {
+        caps.flags |= LightCapabilities::CapWarningDevice;
+    }
+
+    m_caps = caps;
+    m_capsItemCount = itemCount();
+    return m_caps;
+}
+
+/*! Forces the capabilities to be rebuilt on next access.
+    Must be called when config/colorcapabilities, config/ctmin, config/ctmax,
+    the model identifier or the manufacturer code are changed.
+ */
+void LightNode::invalidateCapabilities()
+{
+    m_capsItemCount = -1;
+}
+
 /*! Parse the light resource items from a JSON string. */
 void LightNode::jsonToResourceItems(const QString &json)
 {
@@ -640,6 +748,8 @@ void LightNode::jsonToResourceItems(const QString &json)
             item->setTimeStamps(dt);
         }
     }
+
+    invalidateCapabilities();
 }
 
 /*! Transfers resource items into JSON string. */
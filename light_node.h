@@ -17,6 +17,39 @@
 #include "rest_node_base.h"
 #include "group_info.h"
 
+/*! \class LightCapabilities
+
+    Compiled color and command capabilities of a light.
+    Derived from resource items and model quirks, only refreshed when these change.
+ */
+class LightCapabilities
+{
+public:
+    enum Flags
+    {
+        CapOnOff          = 0x0001, // state/on
+        CapLevel          = 0x0002, // state/bri
+        CapHueSat         = 0x0004, // state/hue and state/sat
+        CapXy             = 0x0008, // state/x and state/y
+        CapCt             = 0x0010, // state/ct
+        CapCtRange        = 0x0020, // valid config/ctmin and config/ctmax
+        CapCtViaXy        = 0x0040, // emulate move to color temperature with move to color
+        CapCtViaSat       = 0x0080, // interim FLS-H, emulate ct with saturation
+        CapXyViaHueSat    = 0x0100, // old FLS-PP, emulate xy with hue and saturation
+        CapWindowCovering = 0x0200,
+        CapWarningDevice  = 0x0400,
+        CapInvertedLift   = 0x0800  // lumi.curtain reports 100% as open
+    };
+
+    bool has(quint32 f) const { return (flags & f) == f; }
+    quint16 boundedCt(quint16 ct) const;
+
+    quint32 flags = 0;
+    quint16 colorCapabilities = 0; // config/colorcapabilities
+    quint16 ctMin = 0;
+    quint16 ctMax = 0;
+};
+
 /*! \class LightNode
 
     Represents a HA or ZLL based light.
@@ -70,6 +103,8 @@ public:
     void setGroupCount(uint8_t groupCount);
     uint8_t sceneCapacity() const;
     void setSceneCapacity(uint8_t sceneCapacity);
+    const LightCapabilities &capabilities() const;
+    void invalidateCapabilities();
     void jsonToResourceItems(const QString &json);
     QString resourceItemsToJson();
 
@@ -88,6 +123,8 @@ private:
     deCONZ::SimpleDescriptor m_haEndpoint;
     uint8_t m_groupCount;
     uint8_t m_sceneCapacity;
+    mutable LightCapabilities m_caps;
+    mutable int m_capsItemCount; // itemCount() when m_caps was compiled, -1 if invalid
 };
 
 #endif // LIGHT_NODE_H
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2020 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <QStringBuilder>
+#include <QStringList>
+#include <math.h>
+#include <string.h>
+#include "metrics.h"
+
+/*! Constructor.
+ */
+MetricsHistogram::MetricsHistogram() :
+    count(0),
+    sum(0),
+    min(0),
+    max(0)
+{
+    memset(m_buckets, 0, sizeof(m_buckets));
+}
+
+/*! Returns the bucket for a value.
+ */
+int MetricsHistogram::bucketIndex(qint64 value)
+{
+    const qint64 linear = 1 << (SubBucketBits + 1);
+
+    if (value < linear)
+    {
+        return value < 0 ? 0 : int(value);
+    }
+
+    int msb = 0;
+    while ((value >> (msb + 1)) != 0)
+    {
+        msb++;
+    }
+
+    const int sub = int(value >> (msb - SubBucketBits)) & ((1 << SubBucketBits) - 1);
+    return ((msb - SubBucketBits + 1) << SubBucketBits) + sub;
+}
+
+/*! Returns the highest value which falls into a bucket.
+ */
+qint64 MetricsHistogram::bucketValue(int index)
+{
+    const int linear = 1 << (SubBucketBits + 1);
+
+    if (index < linear)
+    {
+        return index;
+    }
+
+    const int msb = (index >> SubBucketBits) + SubBucketBits - 1;
+    const qint64 sub = index & ((1 << SubBucketBits) - 1);
+    const qint64 lower = ((qint64(1) << SubBucketBits) + sub) << (msb - SubBucketBits);
+    return lower + (qint64(1) << (msb - SubBucketBits)) - 1;
+}
+
+/*! Adds a value to the histogram.
+ */
+void MetricsHistogram::record(qint64 value)
+{
+    if (count == 0 || value < min) { min = value; }
+    if (count == 0 || value > max) { max = value; }
+    count++;
+    sum += value;
+    m_buckets[bucketIndex(value)]++;
+}
+
+/*! Returns the estimated value at quantile \p q (0..1).
+ */
+qint64 MetricsHistogram::quantile(double q) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    const quint64 target = qMax(quint64(1), quint64(ceil(q * count)));
+    quint64 n = 0;
+
+    for (int i = 0; i < BucketCount; i++)
+    {
+        n += m_buckets[i];
+        if (n >= target)
+        {
+            return qBound(min, bucketValue(i), max);
+        }
+    }
+
+    return max;
+}
+
+/*! Returns the handle of a counter, the counter is created if needed.
+ */
+int Metrics::counter(const QString &name)
+{
+    auto i = m_counters.constFind(name);
+    if (i != m_counters.constEnd())
+    {
+        return i.value();
+    }
+
+    m_counterValues.push_back(0);
+    const int handle = int(m_counterValues.size()) - 1;
+    m_counters.insert(name, handle);
+    return handle;
+}
+
+/*! Returns the handle of a gauge, the gauge is created if needed.
+ */
+int Metrics::gauge(const QString &name)
+{
+    auto i = m_gauges.constFind(name);
+    if (i != m_gauges.constEnd())
+    {
+        return i.value();
+    }
+
+    m_gaugeValues.push_back(0);
+    const int handle = int(m_gaugeValues.size()) - 1;
+    m_gauges.insert(name, handle);
+    return handle;
+}
+
+/*! Returns the handle of a histogram, the histogram is created if needed.
+ */
+int Metrics::histogram(const QString &name)
+{
+    auto i = m_histograms.constFind(name);
+    if (i != m_histograms.constEnd())
+    {
+        return i.value();
+    }
+
+    m_histogramValues.push_back(MetricsHistogram());
+    const int handle = int(m_histogramValues.size()) - 1;
+    m_histograms.insert(name, handle);
+    return handle;
+}
+
+/*! Returns all metrics for JSON serialization.
+ */
+QVariantMap Metrics::toMap() const
+{
+    QVariantMap counters;
+    QVariantMap gauges;
+    QVariantMap histograms;
+
+    for (auto i = m_counters.constBegin(); i != m_counters.constEnd(); ++i)
+    {
+        counters[i.key()] = double(m_counterValues[i.value()]);
+    }
+
+    for (auto i = m_gauges.constBegin(); i != m_gauges.constEnd(); ++i)
+    {
+        gauges[i.key()] = double(m_gaugeValues[i.value()]);
+    }
+
+    for (auto i = m_histograms.constBegin(); i != m_histograms.constEnd(); ++i)
+    {
+        const MetricsHistogram &h = m_histogramValues[i.value()];
+        QVariantMap map;
+        map[QLatin1String("count")] = double(h.count);
+        map[QLatin1String("sum")] = double(h.sum);
+        map[QLatin1String("min")] = double(h.min);
+        map[QLatin1String("max")] = double(h.max);
+        map[QLatin1String("p50")] = double(h.quantile(0.5));
+        map[QLatin1String("p90")] = double(h.quantile(0.9));
+        map[QLatin1String("p99")] = double(h.quantile(0.99));
+        histograms[i.key()] = map;
+    }
+
+    QVariantMap map;
+    map[QLatin1String("counters")] = counters;
+    map[QLatin1String("gauges")] = gauges;
+    map[QLatin1String("histograms")] = histograms;
+    return map;
+}
+
+/*! Appends a label to a metric name which may already carry labels.
+ */
+static QString withLabel(const QString &name, const QString &label)
+{
+    if (name.endsWith(QLatin1Char('}')))
+    {
+        return name.left(name.size() - 1) % QLatin1Char(',') % label % QLatin1Char('}');
+    }
+    return name % QLatin1Char('{') % label % QLatin1Char('}');
+}
+
+/*! Appends a suffix to the base name of a metric which may carry labels.
+ */
+static QString withSuffix(const QString &name, const char *suffix)
+{
+    const int pos = name.indexOf(QLatin1Char('{'));
+    if (pos == -1)
+    {
+        return name % QLatin1String(suffix);
+    }
+    return name.left(pos) % QLatin1String(suffix) % name.mid(pos);
+}
+
+/*! Returns the base name of a metric without labels.
+ */
+static QString baseName(const QString &name)
+{
+    const int pos = name.indexOf(QLatin1Char('{'));
+    return pos == -1 ? name : name.left(pos);
+}
+
+/*! Returns all metrics in the Prometheus text exposition format.
+ */
+QString Metrics::toPrometheus() const
+{
+    QStringList lines;
+    QStringList types; // emit TYPE only once per base name
+
+    for (auto i = m_counters.constBegin(); i != m_counters.constEnd(); ++i)
+    {
+        const QString base = baseName(i.key());
+        if (!types.contains(base))
+        {
+            types.append(base);
+            lines.append(QLatin1String("# TYPE ") % base % QLatin1String(" counter"));
+        }
+        lines.append(i.key() % QLatin1Char(' ') % QString::number(m_counterValues[i.value()]));
+    }
+
+    for (auto i = m_gauges.constBegin(); i != m_gauges.constEnd(); ++i)
+    {
+        const QString base = baseName(i.key());
+        if (!types.contains(base))
+        {
+            types.append(base);
+            lines.append(QLatin1String("# TYPE ") % base % QLatin1String(" gauge"));
+        }
+        lines.append(i.key() % QLatin1Char(' ') % QString::number(m_gaugeValues[i.value()]));
+    }
+
+    for (auto i = m_histograms.constBegin(); i != m_histograms.constEnd(); ++i)
+    {
+        const MetricsHistogram &h = m_histogramValues[i.value()];
+        const QString base = baseName(i.key());
+        if (!types.contains(base))
+        {
+            types.append(base);
+            lines.append(QLatin1String("# TYPE ") % base % QLatin1String(" summary"));
+        }
+        lines.append(withLabel(i.key(), QLatin1String("quantile=\"0.5\"")) % QLatin1Char(' ') % QString::number(h.quantile(0.5)));
+        lines.append(withLabel(i.key(), QLatin1String("quantile=\"0.9\"")) % QLatin1Char(' ') % QString::number(h.quantile(0.9)));
+        lines.append(withLabel(i.key(), QLatin1String("quantile=\"0.99\"")) % QLatin1Char(' ') % QString::number(h.quantile(0.99)));
+        lines.append(withSuffix(i.key(), "_sum") % QLatin1Char(' ') % QString::number(h.sum));
+        lines.append(withSuffix(i.key(), "_count") % QLatin1Char(' ') % QString::number(h.count));
+    }
+
+    lines.append(QString());
+    return lines.join(QLatin1Char('\n'));
+}
+
+/*! Constructor, starts measuring.
+    \param metrics - registry, may be 0
+    \param name - histogram name
+ */
+MetricsTimer::MetricsTimer(Metrics *metrics, const QString &name) :
+    m_metrics(metrics),
+    m_histogram(-1),
+    m_name(name)
+{
+    m_timer.start();
+}
+
+/*! Constructor, starts measuring.
+    \param metrics - registry, may be 0
+    \param histogram - histogram handle, see Metrics::histogram()
+ */
+MetricsTimer::MetricsTimer(Metrics *metrics, int histogram) :
+    m_metrics(metrics),
+    m_histogram(histogram)
+{
+    m_timer.start();
+}
+
+/*! Destructor, records the elapsed time in microseconds.
+ */
+MetricsTimer::~MetricsTimer()
+{
+    if (m_metrics && m_histogram >= 0)
+    {
+        m_metrics->record(m_histogram, m_timer.nsecsElapsed() / 1000);
+    }
+    else if (m_metrics)
+    {
+        m_metrics->record(m_name, m_timer.nsecsElapsed() / 1000);
+    }
+}
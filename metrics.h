@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2020 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QVariantMap>
+#include <vector>
+
+/*! \class MetricsHistogram
+
+    Log-linear latency histogram in the spirit of HDR histograms.
+    Values are bucketed by power of two with 4 sub-buckets each,
+    which keeps the relative error of quantiles below 25%.
+ */
+class MetricsHistogram
+{
+public:
+    MetricsHistogram();
+    void record(qint64 value);
+    qint64 quantile(double q) const;
+
+    quint64 count;
+    qint64 sum;
+    qint64 min;
+    qint64 max;
+
+private:
+    enum { SubBucketBits = 2, BucketCount = 64 << SubBucketBits };
+    static int bucketIndex(qint64 value);
+    static qint64 bucketValue(int index);
+
+    quint32 m_buckets[BucketCount];
+};
+
+/*! \class Metrics
+
+    Registry of counters, gauges and histograms for runtime telemetry.
+    Names follow the Prometheus conventions and may carry labels,
+    e.g. http_request_duration_us{resource="lights"}.
+
+    Metrics updated on hot paths should be registered once via counter(),
+    gauge() or histogram() and then be updated through the returned handle,
+    which avoids building the name and looking it up for each update.
+ */
+class Metrics
+{
+public:
+    int counter(const QString &name);
+    int gauge(const QString &name);
+    int histogram(const QString &name);
+
+    void increment(int counter, quint64 n = 1) { m_counterValues[counter] += n; }
+    void setGauge(int gauge, qint64 value) { m_gaugeValues[gauge] = value; }
+    void record(int histogram, qint64 value) { m_histogramValues[histogram].record(value); }
+
+    void increment(const QString &name, quint64 n = 1) { increment(counter(name), n); }
+    void setGauge(const QString &name, qint64 value) { setGauge(gauge(name), value); }
+    void record(const QString &name, qint64 value) { record(histogram(name), value); }
+
+    QVariantMap toMap() const;
+    QString toPrometheus() const;
+
+private:
+    // name -> index into the value vectors, indices are the handles
+    QHash<QString, int> m_counters;
+    QHash<QString, int> m_gauges;
+    QHash<QString, int> m_histograms;
+    std::vector<quint64> m_counterValues;
+    std::vector<qint64> m_gaugeValues;
+    std::vector<MetricsHistogram> m_histogramValues;
+};
+
+/*! \class MetricsTimer
+
+    Records the lifetime of the object in microseconds into a histogram.
+ */
+class MetricsTimer
+{
+public:
+    MetricsTimer(Metrics *metrics, const QString &name);
+    MetricsTimer(Metrics *metrics, int histogram);
+    ~MetricsTimer();
+    void setName(const QString &name) { m_name = name; m_histogram = -1; }
+
+private:
+    Metrics *m_metrics;
+    int m_histogram;
+    QString m_name;
+    QElapsedTimer m_timer;
+};
+
+#endif // METRICS_H
@@ -457,12 +457,11 @@ void PollManager::pollTimerFired()
     }
 
     size_t fresh = 0;
-    const int reportWaitTime = 360;
     const int reportWaitTimeXAL = 60 * 30;
     for (quint16 attrId : attributes)
     {
         // force polling after node becomes reachable, since reporting might not be active
-//        if (dtReachable < reportWaitTime)
+//        if (dtReachable < POLL_REPORT_WAIT_TIME)
 //        {
 //            break;
 //        }
@@ -473,7 +472,7 @@ void PollManager::pollTimerFired()
         {
             fresh++; // rely on reporting for ikea lights
         }
-        else if (val.timestampLastReport.isValid() && val.timestampLastReport.secsTo(now) < reportWaitTime)
+        else if (val.isFreshByReport(now))
         {
             fresh++;
         }
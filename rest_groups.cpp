@@ -30,78 +30,8 @@ int DeRestPluginPrivate::handleGroupsApi(const ApiRequest &req, ApiResponse &rsp
         return REQ_NOT_HANDLED;
     }
 
-    // GET /api/<apikey>/groups
-    if ((req.path.size() == 3) && (req.hdr.method() == "GET"))
-    {
-        return getAllGroups(req, rsp);
-    }
-    // POST /api/<apikey>/groups
-    else if ((req.path.size() == 3) && (req.hdr.method() == "POST"))
-    {
-        return createGroup(req, rsp);
-    }
-    // GET /api/<apikey>/groups/<id>
-    else if ((req.path.size() == 4) && (req.hdr.method() == "GET"))
-    {
-        return getGroupAttributes(req, rsp);
-    }
-    // PUT, PATCH /api/<apikey>/groups/<id>
-    else if ((req.path.size() == 4) && (req.hdr.method() == "PUT" || req.hdr.method() == "PATCH"))
-    {
-        return setGroupAttributes(req, rsp);
-    }
-    // PUT, PATCH /api/<apikey>/groups/<id>/action
-    else if ((req.path.size() == 5) && (req.hdr.method() == "PUT" || req.hdr.method() == "PATCH") && (req.path[4] == "action"))
-    {
-        return setGroupState(req, rsp);
-    }
-    // DELETE /api/<apikey>/groups/<id>
-    else if ((req.path.size() == 4) && (req.hdr.method() == "DELETE"))
-    {
-        return deleteGroup(req, rsp);
-    }
-    // POST /api/<apikey>/groups/<group_id>/scenes
-    else if ((req.path.size() == 5) && (req.hdr.method() == "POST")  && (req.path[4] == "scenes"))
-    {
-        return createScene(req, rsp);
-    }
-    // GET /api/<apikey>/groups/<group_id>/scenes
-    else if ((req.path.size() == 5) && (req.hdr.method() == "GET")  && (req.path[4] == "scenes"))
-    {
-        return getAllScenes(req, rsp);
-    }
-    // GET /api/<apikey>/groups/<group_id>/scenes/<scene_id>
-    else if ((req.path.size() == 6) && (req.hdr.method() == "GET")  && (req.path[4] == "scenes"))
-    {
-        return getSceneAttributes(req, rsp);
-    }
-    // PUT /api/<apikey>/groups/<group_id>/scenes/<scene_id>
-    else if ((req.path.size() == 6) && (req.hdr.method() == "PUT" || req.hdr.method() == "PATCH")  && (req.path[4] == "scenes"))
-    {
-        return setSceneAttributes(req, rsp);
-    }
-    // PUT /api/<apikey>/groups/<group_id>/scenes/<scene_id>/store
-    else if ((req.path.size() == 7) && (req.hdr.method() == "PUT")  && (req.path[4] == "scenes") && (req.path[6] == "store"))
-    {
-        return storeScene(req, rsp);
-    }
-    // PUT /api/<apikey>/groups/<group_id>/scenes/<scene_id>/recall
-    else if ((req.path.size() == 7) && (req.hdr.method() == "PUT")  && (req.path[4] == "scenes") && (req.path[6] == "recall"))
-    {
-        return recallScene(req, rsp);
-    }
-    // PUT, PATCH /api/<apikey>/groups/<group_id>/scenes/<scene_id>/lights/<light_id>/state
-    else if ((req.path.size() == 9) && (req.hdr.method() == "PUT" || req.hdr.method() == "PATCH")  && (req.path[4] == "scenes") && (req.path[6] == "lights"))
-    {
-        return modifyScene(req, rsp);
-    }
-    // DELETE /api/<apikey>/groups/<group_id>/scenes/<scene_id>
-    else if ((req.path.size() == 6) && (req.hdr.method() == "DELETE")  && (req.path[4] == "scenes"))
-    {
-        return deleteScene(req, rsp);
-    }
-
-    return REQ_NOT_HANDLED;
+    // routes are defined in initRestRouter()
+    return restRouter.dispatch(req, rsp);
 }
 
 /*! GET /api/<apikey>/groups
@@ -718,6 +648,43 @@ static void copyTaskReq(TaskItem &a, TaskItem &b)
     b.transitionTime = a.transitionTime;
 }
 
+/*! Deactivates a running colorloop of a group and its member lights.
+    \param group - the group
+    \param taskRef - task with group destination parameters
+ */
+void DeRestPluginPrivate::stopGroupColorLoop(Group *group, TaskItem &taskRef)
+{
+    if (group->isColorLoopActive())
+    {
+        TaskItem task;
+        copyTaskReq(taskRef, task);
+        addTaskSetColorLoop(task, false, 15);
+        group->setColorLoopActive(false); // deactivate colorloop if active
+    }
+    std::vector<LightNode>::iterator i = nodes.begin();
+    std::vector<LightNode>::iterator end = nodes.end();
+
+    for (; i != end; ++i)
+    {
+        if (isLightNodeInGroup(&(*i), group->address()))
+        {
+            if (i->isColorLoopActive() && i->isAvailable() && i->state() != LightNode::StateDeleted)
+            {
+                TaskItem task2;
+                task2.lightNode = &(*i);
+                task2.req.dstAddress() = task2.lightNode->address();
+                task2.req.setTxOptions(deCONZ::ApsTxAcknowledgedTransmission);
+                task2.req.setDstEndpoint(task2.lightNode->haEndpoint().endpoint());
+                task2.req.setSrcEndpoint(getSrcEndpoint(task2.lightNode, task2.req));
+                task2.req.setDstAddressMode(deCONZ::ApsExtAddress);
+
+                addTaskSetColorLoop(task2, false, 15);
+                i->setColorLoopActive(false);
+            }
+        }
+    }
+}
+
 /*! PUT, PATCH /api/<apikey>/groups/<id>/action
     \return REQ_READY_SEND
             REQ_NOT_HANDLED
@@ -853,35 +820,7 @@ int DeRestPluginPrivate::setGroupState(const ApiRequest &req, ApiResponse &rsp)
                 }
             }
 
-            if (group->isColorLoopActive())
-            {
-                TaskItem task;
-                copyTaskReq(taskRef, task);
-                addTaskSetColorLoop(task, false, 15);
-                group->setColorLoopActive(false); // deactivate colorloop if active
-            }
-            std::vector<LightNode>::iterator i = nodes.begin();
-            std::vector<LightNode>::iterator end = nodes.end();
-
-            for (; i != end; ++i)
-            {
-                if (isLightNodeInGroup(&(*i), group->address()))
-                {
-                    if (i->isColorLoopActive() && i->isAvailable() && i->state() != LightNode::StateDeleted)
-                    {
-                        TaskItem task2;
-                        task2.lightNode = &(*i);
-                        task2.req.dstAddress() = task2.lightNode->address();
-                        task2.req.setTxOptions(deCONZ::ApsTxAcknowledgedTransmission);
-                        task2.req.setDstEndpoint(task2.lightNode->haEndpoint().endpoint());
-                        task2.req.setSrcEndpoint(getSrcEndpoint(task2.lightNode, task2.req));
-                        task2.req.setDstAddressMode(deCONZ::ApsExtAddress);
-
-                        addTaskSetColorLoop(task2, false, 15);
-                        i->setColorLoopActive(false);
-                    }
-                }
-            }
+            stopGroupColorLoop(group, taskRef);
 
             TaskItem task;
             copyTaskReq(taskRef, task);
@@ -1707,6 +1646,100 @@ int DeRestPluginPrivate::setGroupState(const ApiRequest &req, ApiResponse &rsp)
     return REQ_READY_SEND;
 }
 
+/*! Executes a compiled group action of a rule directly on the task layer.
+    Mirrors setGroupState() for the on, toggle, bri and transitiontime parameters.
+    \param action - action with RuleAction::CommandGroupAction
+    \return true if executed, false if the REST handler path must be used
+ */
+bool DeRestPluginPrivate::triggerGroupActionCommand(const RuleAction &action)
+{
+    DBG_Assert(action.command() == RuleAction::CommandGroupAction);
+    Group *group = getGroupForId(action.targetId());
+
+    if (!isInNetwork() || !group || group->state() != Group::StateNormal)
+    {
+        return false; // let setGroupState() report the error
+    }
+
+    TaskItem taskRef;
+    taskRef.req.dstAddress().setGroup(group->address());
+    taskRef.req.setDstAddressMode(deCONZ::ApsGroupAddress);
+    taskRef.req.setDstEndpoint(0xFF); // broadcast endpoint
+    taskRef.req.setSrcEndpoint(getSrcEndpoint(0, taskRef.req));
+
+    if (action.transitionTime() >= 0)
+    {
+        taskRef.transitionTime = action.transitionTime();
+    }
+
+    bool hasOn = action.hasOn();
+    bool on = action.on();
+    const bool hasBri = action.bri() >= 0;
+
+    if (action.toggle())
+    {
+        ResourceItem *item = group->item(RStateAnyOn);
+        hasOn = true;
+        on = item && item->toBool() ? false : true;
+    }
+
+    if (hasOn)
+    {
+        group->setIsOn(on);
+        stopGroupColorLoop(group, taskRef);
+
+        if (!hasBri) // onOff task only if no bri is given
+        {
+            TaskItem task;
+            copyTaskReq(taskRef, task);
+            addTaskSetOnOff(task, on ? ONOFF_COMMAND_ON : ONOFF_COMMAND_OFF, 0);
+        }
+    }
+
+    if (hasBri)
+    {
+        group->level = action.bri();
+        TaskItem task;
+        copyTaskReq(taskRef, task);
+        addTaskSetBrightness(task, action.bri(), hasOn);
+    }
+
+    for (LightNode &lightNode : nodes)
+    {
+        if (lightNode.state() == LightNode::StateDeleted || !isLightNodeInGroup(&lightNode, group->address()))
+        {
+            continue;
+        }
+
+        bool modified = false;
+        ResourceItem *item = lightNode.item(RStateOn);
+        if (hasOn && item && group->isOn() != item->toBool())
+        {
+            item->setValue(group->isOn());
+            enqueueEvent(Event(RLights, RStateOn, lightNode.id(), item));
+            modified = true;
+        }
+
+        item = lightNode.item(RStateBri);
+        if (hasBri && item && group->level != item->toNumber())
+        {
+            item->setValue(group->level);
+            enqueueEvent(Event(RLights, RStateBri, lightNode.id(), item));
+            modified = true;
+        }
+
+        if (modified)
+        {
+            updateLightEtag(&lightNode);
+        }
+    }
+
+    updateGroupEtag(group);
+    processTasks();
+
+    return true;
+}
+
 /*! DELETE /api/<apikey>/groups/<id>
     \return REQ_READY_SEND
             REQ_NOT_HANDLED
@@ -1876,6 +1909,13 @@ bool DeRestPluginPrivate::groupToMap(const ApiRequest &req, const Group *group,
         }
 
         map["lightsequence"] = lightsequence;
+
+        QVariantMap sendstats;
+        sendstats["sent"] = (double)group->sendCount;
+        sendstats["fused"] = (double)group->fusedCount;
+        sendstats["latencyavg"] = group->sendCount > 0 ? (double)(group->sendLatencySum / group->sendCount) : 0.0;
+        sendstats["latencymax"] = (double)group->sendLatencyMax;
+        map["sendstats"] = sendstats;
     }
 
     QStringList deviceIds;
@@ -32,68 +32,8 @@ int DeRestPluginPrivate::handleLightsApi(const ApiRequest &req, ApiResponse &rsp
         return REQ_NOT_HANDLED;
     }
 
-    // GET /api/<apikey>/lights
-    if ((req.path.size() == 3) && (req.hdr.method() == "GET"))
-    {
-        return getAllLights(req, rsp);
-    }
-    // POST /api/<apikey>/lights
-    else if ((req.path.size() == 3) && (req.hdr.method() == "POST"))
-    {
-        return searchNewLights(req, rsp);
-    }
-    // GET /api/<apikey>/lights/new
-    else if ((req.path.size() == 4) && (req.hdr.method() == "GET") && (req.path[3] == "new"))
-    {
-        return getNewLights(req, rsp);
-    }
-    // GET /api/<apikey>/lights/<id>
-    else if ((req.path.size() == 4) && (req.hdr.method() == "GET"))
-    {
-        return getLightState(req, rsp);
-    }
-    // GET /api/<apikey>/lights/<id>/data?maxrecords=<maxrecords>&fromtime=<ISO 8601>
-    else if ((req.path.size() == 5) && (req.hdr.method() == "GET") && (req.path[4] == "data"))
-    {
-        return getLightData(req, rsp);
-    }
-    // PUT, PATCH /api/<apikey>/lights/<id>/state
-    else if ((req.path.size() == 5) && (req.hdr.method() == "PUT" || req.hdr.method() == "PATCH") && (req.path[4] == "state"))
-    {
-        return setLightState(req, rsp);
-    }
-    // PUT, PATCH /api/<apikey>/lights/<id>
-    else if ((req.path.size() == 4) && (req.hdr.method() == "PUT" || req.hdr.method() == "PATCH"))
-    {
-        return setLightAttributes(req, rsp);
-    }
-    // GET /api/<apikey>/lights/<id>/connectivity
-    if ((req.path.size() == 5) && (req.hdr.method() == "GET") && (req.path[4] == "connectivity"))
-    {
-        return getConnectivity(req, rsp, false);
-    }
-    // GET /api/<apikey>/lights/<id>/connectivity
-    if ((req.path.size() == 5) && (req.hdr.method() == "GET") && (req.path[4] == "connectivity2"))
-    {
-        return getConnectivity(req, rsp, true);
-    }
-    // DELETE /api/<apikey>/lights/<id>
-    else if ((req.path.size() == 4) && (req.hdr.method() == "DELETE"))
-    {
-        return deleteLight(req, rsp);
-    }
-    // DELETE /api/<apikey>/lights/<id>/scenes
-    else if ((req.path.size() == 5) && (req.path[4] == "scenes") && (req.hdr.method() == "DELETE"))
-    {
-        return removeAllScenes(req, rsp);
-    }
-    // DELETE /api/<apikey>/lights/<id>/groups
-    else if ((req.path.size() == 5) && (req.path[4] == "groups") && (req.hdr.method() == "DELETE"))
-    {
-        return removeAllGroups(req, rsp);
-    }
-
-    return REQ_NOT_HANDLED;
+    // routes are defined in initRestRouter()
+    return restRouter.dispatch(req, rsp);
 }
 
 /*! GET /api/<apikey>/lights
@@ -477,6 +417,222 @@ static void copyTaskReq(TaskItem &a, TaskItem &b)
     b.lightNode = a.lightNode;
 }
 
+/*! Decoded and validated parameters of a PUT /lights/<id>/state request. */
+struct LightStateChange
+{
+    bool hasOn = false;
+    bool on = false;
+    bool hasBri = false;
+    bool briStop = false;
+    uint bri = 0;
+    bool hasBriInc = false;
+    int briInc = 0;
+    bool wrap = false;
+    bool hasHue = false;
+    uint hue = 0;
+    bool hasSat = false;
+    uint sat = 0;
+    bool hasXy = false;
+    double x = 0;
+    double y = 0;
+    bool hasCt = false;
+    uint16_t ct = 0;
+    bool hasCtInc = false;
+    int ctInc = 0;
+    bool hasEffect = false;
+    bool colorLoop = false;
+    bool hasColorLoopSpeed = false;
+    uint colorLoopSpeed = 15;
+    bool hasAlert = false;
+    QString alert;
+};
+
+/*! Validates and decodes all parameters of a light state request in a single pass,
+    so that no command is queued for a request which is rejected afterwards.
+    \param map - the request body
+    \param id - the light id
+    \param caps - the capabilities of the light
+    \param change - the decoded request
+    \param rsp - response data, receives the error if any
+    \return true - if all parameters are valid
+            false - on error, rsp is set to HttpStatusBadRequest
+ */
+bool DeRestPluginPrivate::decodeLightState(const QVariantMap &map, const QString &id, const LightCapabilities &caps, LightStateChange &change, ApiResponse &rsp)
+{
+    bool ok;
+    QVariantMap::const_iterator i = map.find(QLatin1String("on"));
+
+    if (i != map.end())
+    {
+        if (i.value().type() != QVariant::Bool)
+        {
+            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/on").arg(id), QString("invalid value, %1, for parameter, on").arg(i.value().toString())));
+            rsp.httpStatus = HttpStatusBadRequest;
+            return false;
+        }
+        change.hasOn = true;
+        change.on = i.value().toBool();
+    }
+
+    i = map.find(QLatin1String("bri"));
+    if (i != map.end())
+    {
+        change.bri = i.value().toUInt(&ok);
+
+        if ((i.value().type() == QVariant::String) && i.value().toString() == QLatin1String("stop"))
+        {
+            change.briStop = true;
+        }
+        else if (!ok || (i.value().type() != QVariant::Double) || (change.bri > 255))
+        {
+            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/bri").arg(id), QString("invalid value, %1, for parameter, bri").arg(i.value().toString())));
+            rsp.httpStatus = HttpStatusBadRequest;
+            return false;
+        }
+        change.hasBri = true;
+    }
+
+    i = map.find(QLatin1String("bri_inc"));
+    if (i != map.end() && !change.hasBri)
+    {
+        change.briInc = i.value().toInt(&ok);
+
+        if (!ok || (i.value().type() != QVariant::Double) || change.briInc < -254 || change.briInc > 254)
+        {
+            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/bri_inc").arg(id), QString("invalid value, %1, for parameter, bri_inc").arg(i.value().toString())));
+            rsp.httpStatus = HttpStatusBadRequest;
+            return false;
+        }
+        change.hasBriInc = true;
+        change.wrap = map.value(QLatin1String("wrap")).type() == QVariant::Bool && map.value(QLatin1String("wrap")).toBool();
+    }
+
+    i = map.find(QLatin1String("effect"));
+    if (i != map.end())
+    {
+        const QString effect = i.value().toString();
+
+        if (effect != QLatin1String("none") && effect != QLatin1String("colorloop"))
+        {
+            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/effect").arg(id), QString("invalid value, %1, for parameter, effect").arg(i.value().toString())));
+            rsp.httpStatus = HttpStatusBadRequest;
+            return false;
+        }
+        change.hasEffect = true;
+        change.colorLoop = effect == QLatin1String("colorloop");
+
+        i = map.find(QLatin1String("colorloopspeed"));
+        if (change.colorLoop && i != map.end())
+        {
+            change.colorLoopSpeed = i.value().toUInt(&ok);
+            // an invalid speed is reported but doesn't reject the request
+            change.hasColorLoopSpeed = ok && (i.value().type() == QVariant::Double) && (change.colorLoopSpeed < 256) && (change.colorLoopSpeed > 0);
+            if (!change.hasColorLoopSpeed)
+            {
+                change.colorLoopSpeed = 15;
+            }
+        }
+    }
+
+    i = map.find(QLatin1String("hue"));
+    if (i != map.end())
+    {
+        change.hue = i.value().toUInt(&ok);
+
+        if (!ok || (i.value().type() != QVariant::Double) || (change.hue > MAX_ENHANCED_HUE))
+        {
+            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/hue").arg(id), QString("invalid value, %1, for parameter, hue").arg(i.value().toString())));
+            rsp.httpStatus = HttpStatusBadRequest;
+            return false;
+        }
+        change.hasHue = true;
+    }
+
+    i = map.find(QLatin1String("sat"));
+    if (i != map.end())
+    {
+        change.sat = i.value().toUInt(&ok);
+
+        if (!ok || (i.value().type() != QVariant::Double) || (change.sat > 255))
+        {
+            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/sat").arg(id), QString("invalid value, %1, for parameter, sat").arg(i.value().toString())));
+            rsp.httpStatus = HttpStatusBadRequest;
+            return false;
+        }
+        change.hasSat = true;
+    }
+
+    i = map.find(QLatin1String("ct_inc"));
+    if (i != map.end())
+    {
+        change.ctInc = i.value().toInt(&ok);
+
+        if (!ok || (i.value().type() != QVariant::Double) || change.ctInc < -65534 || change.ctInc > 65534)
+        {
+            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/ct_inc").arg(id), QString("invalid value, %1, for parameter, ct_inc").arg(i.value().toString())));
+            rsp.httpStatus = HttpStatusBadRequest;
+            return false;
+        }
+        change.hasCtInc = true;
+    }
+
+    i = map.find(QLatin1String("xy"));
+    if (i != map.end() && !caps.has(LightCapabilities::CapXyViaHueSat))
+    {
+        const QVariantList ls = i.value().toList();
+
+        if ((ls.size() != 2) || (ls[0].type() != QVariant::Double) || (ls[1].type() != QVariant::Double))
+        {
+            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/xy").arg(id), QString("invalid value, %1, for parameter, xy").arg(i.value().toString())));
+            rsp.httpStatus = HttpStatusBadRequest;
+            return false;
+        }
+        change.hasXy = true;
+        change.x = ls[0].toDouble();
+        change.y = ls[1].toDouble();
+    }
+
+    i = map.find(QLatin1String("ct"));
+    if (i != map.end())
+    {
+        change.ct = i.value().toUInt(&ok);
+
+        if (!ok || (i.value().type() != QVariant::Double))
+        {
+            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/ct").arg(id), QString("invalid value, %1, for parameter, ct").arg(i.value().toString())));
+            rsp.httpStatus = HttpStatusBadRequest;
+            return false;
+        }
+        change.hasCt = true;
+    }
+
+    i = map.find(QLatin1String("alert"));
+    if (i != map.end())
+    {
+        change.alert = i.value().toString();
+        const bool isWarningDevice = caps.has(LightCapabilities::CapWarningDevice);
+
+        if (change.alert != QLatin1String("none") &&
+            change.alert != QLatin1String("select") &&
+            change.alert != QLatin1String("lselect") &&
+            change.alert != QLatin1String("blink") &&
+            (isWarningDevice ||
+             (change.alert != QLatin1String("breathe") &&
+              change.alert != QLatin1String("okay") &&
+              change.alert != QLatin1String("channelchange") &&
+              change.alert != QLatin1String("finish") &&
+              change.alert != QLatin1String("stop"))))
+        {
+            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/alert").arg(id), QString("invalid value, %1, for parameter, alert").arg(i.value().toString())));
+            rsp.httpStatus = HttpStatusBadRequest;
+            return false;
+        }
+        change.hasAlert = true;
+    }
+
+    return true;
+}
+
 /*! PUT, PATCH /api/<apikey>/lights/<id>/state
     \return REQ_READY_SEND
             REQ_NOT_HANDLED
@@ -528,20 +684,22 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
         return REQ_READY_SEND;
     }
 
-    // TODO: check for valid attributes in body
+    const LightCapabilities &caps = taskRef.lightNode->capabilities();
+    LightStateChange change;
+
+    if (!decodeLightState(map, id, caps, change, rsp))
+    {
+        return REQ_READY_SEND;
+    }
+
     bool isOn = false;
-    bool hasOn = map.contains("on");
-    bool hasBri = map.contains("bri");
-    bool hasHue = map.contains("hue");
-    bool hasSat = map.contains("sat");
-    bool hasXy = map.contains("xy");
-    bool hasCt = map.contains("ct");
-    bool hasCtInc = map.contains("ct_inc");
-    bool hasBriInc = map.contains("bri_inc");
-    bool hasEffect = map.contains("effect");
-    bool hasEffectColorLoop = false;
-    bool hasAlert = map.contains("alert");
-    bool hasWrap = map.contains("wrap");
+    const bool hasOn = change.hasOn;
+    const bool hasBri = change.hasBri;
+    const bool hasHue = change.hasHue;
+    const bool hasSat = change.hasSat;
+    const bool hasXy = change.hasXy;
+    const bool hasCt = change.hasCt;
+    const bool hasEffectColorLoop = change.hasEffect && change.colorLoop;
 
     {
         ResourceItem *item = taskRef.lightNode->item(RStateOn);
@@ -549,11 +707,6 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
         isOn = item ? item->toBool() : false;
     }
 
-    if (taskRef.lightNode->modelId() == QLatin1String("FLS-PP")) // old FLS-PP
-    {
-        hasXy = false;
-    }
-
     // transition time
     if (map.contains("transitiontime"))
     {
@@ -575,79 +728,68 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
     }
 
     // FIXME temporary workaround to support window_covering
-    bool isWindowCoveringDevice = false;
-    if (taskRef.lightNode->type() == QLatin1String("Window covering device"))
-    {
-    	isWindowCoveringDevice = true;
-    }
+    const bool isWindowCoveringDevice = caps.has(LightCapabilities::CapWindowCovering);
 
     // on/off
+    // Only on/off and brightness share a ZCL command (move to level with on/off),
+    // color and color temperature always need a frame of their own.
     if (hasOn)
     {
-        if (map["on"].type() == QVariant::Bool)
-        {
-            isOn = map["on"].toBool();
-
-            if (!isOn && taskRef.lightNode->isColorLoopActive())
-            {
-                TaskItem task;
-                copyTaskReq(taskRef, task);
-                addTaskSetColorLoop(task, false, 15);
-                taskRef.lightNode->setColorLoopActive(false); // deactivate colorloop if active
-            }
+        isOn = change.on;
 
+        if (!isOn && taskRef.lightNode->isColorLoopActive())
+        {
             TaskItem task;
             copyTaskReq(taskRef, task);
-            //FIXME workaround window_convering
-            if (isWindowCoveringDevice
-            		&& addTaskWindowCovering(task, isOn ? 0x01 /*down*/ : 0x00 /*up*/, 0, 0))
-            {
-                QVariantMap rspItem;
-                QVariantMap rspItemState;
-                rspItemState[QString("/lights/%1/state/on").arg(id)] = isOn;
-                rspItem["success"] = rspItemState;
-                rsp.list.append(rspItem);
-                taskToLocalData(task);
-            } // FIXME end workaround window_covering
-            else if (isOn && taskRef.onTime > 0 && addTaskSetOnOff(task, ONOFF_COMMAND_ON_WITH_TIMED_OFF, taskRef.onTime))
-            {
-                QVariantMap rspItem;
-                QVariantMap rspItemState;
-                rspItemState[QString("/lights/%1/state/on").arg(id)] = isOn;
-                rspItem["success"] = rspItemState;
-                rsp.list.append(rspItem);
-                taskToLocalData(task);
-            }
-            else if (hasBri ||
-                // map.contains("transitiontime") || // FIXME: use bri if transitionTime is given
-                addTaskSetOnOff(task, isOn ? ONOFF_COMMAND_ON : ONOFF_COMMAND_OFF, 0)) // onOff task only if no bri or transitionTime is given
-            {
-                QVariantMap rspItem;
-                QVariantMap rspItemState;
-                rspItemState[QString("/lights/%1/state/on").arg(id)] = isOn;
-                rspItem["success"] = rspItemState;
-                rsp.list.append(rspItem);
-                taskToLocalData(task);
-            }
-            else
-            {
-                rsp.list.append(errorToMap(ERR_INTERNAL_ERROR, QString("/lights/%1").arg(id), QString("Internal error, %1").arg(ERR_BRIDGE_BUSY)));
-            }
+            addTaskSetColorLoop(task, false, 15);
+            taskRef.lightNode->setColorLoopActive(false); // deactivate colorloop if active
+        }
+
+        TaskItem task;
+        copyTaskReq(taskRef, task);
+        //FIXME workaround window_convering
+        if (isWindowCoveringDevice
+                && addTaskWindowCovering(task, isOn ? 0x01 /*down*/ : 0x00 /*up*/, 0, 0))
+        {
+            QVariantMap rspItem;
+            QVariantMap rspItemState;
+            rspItemState[QString("/lights/%1/state/on").arg(id)] = isOn;
+            rspItem["success"] = rspItemState;
+            rsp.list.append(rspItem);
+            taskToLocalData(task);
+        } // FIXME end workaround window_covering
+        else if (isOn && taskRef.onTime > 0 && addTaskSetOnOff(task, ONOFF_COMMAND_ON_WITH_TIMED_OFF, taskRef.onTime))
+        {
+            QVariantMap rspItem;
+            QVariantMap rspItemState;
+            rspItemState[QString("/lights/%1/state/on").arg(id)] = isOn;
+            rspItem["success"] = rspItemState;
+            rsp.list.append(rspItem);
+            taskToLocalData(task);
+        }
+        else if ((hasBri && !change.briStop) || // merged into move to level (with on/off)
+            // map.contains("transitiontime") || // FIXME: use bri if transitionTime is given
+            addTaskSetOnOff(task, isOn ? ONOFF_COMMAND_ON : ONOFF_COMMAND_OFF, 0)) // onOff task only if no bri or transitionTime is given
+        {
+            QVariantMap rspItem;
+            QVariantMap rspItemState;
+            rspItemState[QString("/lights/%1/state/on").arg(id)] = isOn;
+            rspItem["success"] = rspItemState;
+            rsp.list.append(rspItem);
+            taskToLocalData(task);
         }
         else
         {
-            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/on").arg(id), QString("invalid value, %1, for parameter, on").arg(map["on"].toString())));
-            rsp.httpStatus = HttpStatusBadRequest;
-            return REQ_READY_SEND;
+            rsp.list.append(errorToMap(ERR_INTERNAL_ERROR, QString("/lights/%1").arg(id), QString("Internal error, %1").arg(ERR_BRIDGE_BUSY)));
         }
     }
 
     // brightness
     if (hasBri)
     {
-        uint bri = map["bri"].toUInt(&ok);
+        uint bri = change.bri;
 
-        if (hasOn && map["on"].type() == QVariant::Bool)
+        if (hasOn)
         {
             if (!isOn)
             {
@@ -662,54 +804,44 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
         //FIXME workaround window_covering
         if (isWindowCoveringDevice)
         {
-        	if ((map["bri"].type() == QVariant::String) && map["bri"].toString() == "stop")
-        	{
-        		TaskItem task;
-        		copyTaskReq(taskRef, task);
-        		if (addTaskWindowCovering(task, 0x02 /*stop motion*/, 0, 0))
-        		{
-        			QVariantMap rspItem;
-        			QVariantMap rspItemState;
-        			rspItemState[QString("/groups/%1/action/bri").arg(id)] = map["bri"];
-        			rspItem["success"] = rspItemState;
-        			rsp.list.append(rspItem);
-        			taskToLocalData(task);
-        		}
-        		else
-        		{
-        			rsp.list.append(errorToMap(ERR_INTERNAL_ERROR, QString("/lights/%1").arg(id), QString("Internal error, %1").arg(ERR_BRIDGE_BUSY)));
-        		}
-        	}
-        	else if (ok && (map["bri"].type() == QVariant::Double) && (bri < 256))
-        	{
-        		TaskItem task;
-        		copyTaskReq(taskRef, task);
-        		uint8_t moveToPct = 0x00;
-        		moveToPct = bri * 100 / 255;  // Percent 0 - 100 (0x00 - 0x64)
-                if (taskRef.lightNode->modelId().startsWith(QLatin1String("lumi.curtain")))
+            TaskItem task;
+            copyTaskReq(taskRef, task);
+            bool ret;
+
+            if (change.briStop)
+            {
+                ret = addTaskWindowCovering(task, 0x02 /*stop motion*/, 0, 0);
+            }
+            else
+            {
+                uint8_t moveToPct = 0x00;
+                moveToPct = bri * 100 / 255;  // Percent 0 - 100 (0x00 - 0x64)
+                if (caps.has(LightCapabilities::CapInvertedLift))
                 {
                     moveToPct = 100 - moveToPct;
                 }
-        		if (addTaskWindowCovering(task, 0x05 /*move to Lift Percent*/, 0, moveToPct))
-        		{
-        			QVariantMap rspItem;
-        			QVariantMap rspItemState;
-        			rspItemState[QString("/lights/%1/state/bri").arg(id)] = map["bri"];
-        			rspItem["success"] = rspItemState;
-        			rsp.list.append(rspItem);
-        			taskToLocalData(task);
-        		}
-        		else
-        		{
-        			rsp.list.append(errorToMap(ERR_INTERNAL_ERROR, QString("/lights/%1").arg(id), QString("Internal error, %1").arg(ERR_BRIDGE_BUSY)));
-        		}
-        	}
+                ret = addTaskWindowCovering(task, 0x05 /*move to Lift Percent*/, 0, moveToPct);
+            }
+
+            if (ret)
+            {
+                QVariantMap rspItem;
+                QVariantMap rspItemState;
+                rspItemState[QString("/lights/%1/state/bri").arg(id)] = map["bri"];
+                rspItem["success"] = rspItemState;
+                rsp.list.append(rspItem);
+                taskToLocalData(task);
+            }
+            else
+            {
+                rsp.list.append(errorToMap(ERR_INTERNAL_ERROR, QString("/lights/%1").arg(id), QString("Internal error, %1").arg(ERR_BRIDGE_BUSY)));
+            }
         } // FIXME end workaround window_covering
         else if (!isOn && !hasOn)
         {
             rsp.list.append(errorToMap(ERR_DEVICE_OFF, QString("/lights/%1").arg(id), QString("parameter, /lights/%1/bri, is not modifiable. Device is set to off.").arg(id)));
         }
-        else if ((map["bri"].type() == QVariant::String) && map["bri"].toString() == "stop")
+        else if (change.briStop)
         {
             TaskItem task;
             copyTaskReq(taskRef, task);
@@ -727,7 +859,7 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
                 rsp.list.append(errorToMap(ERR_INTERNAL_ERROR, QString("/lights/%1").arg(id), QString("Internal error, %1").arg(ERR_BRIDGE_BUSY)));
             }
         }
-        else if (ok && (map["bri"].type() == QVariant::Double) && (bri < 256))
+        else
         {
             TaskItem task;
             copyTaskReq(taskRef, task);
@@ -745,48 +877,32 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
                 rsp.list.append(errorToMap(ERR_INTERNAL_ERROR, QString("/lights/%1").arg(id), QString("Internal error, %1").arg(ERR_BRIDGE_BUSY)));
             }
         }
-        else
-        {
-            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/bri").arg(id), QString("invalid value, %1, for parameter, bri").arg(map["bri"].toString())));
-            rsp.httpStatus = HttpStatusBadRequest;
-            return REQ_READY_SEND;
-        }
     }
 
     // colorloop
-    if (hasEffect)
+    if (change.hasEffect)
     {
-        QString effect = map["effect"].toString();
-
         if (!isOn)
         {
             rsp.list.append(errorToMap(ERR_DEVICE_OFF, QString("/lights/%1").arg(id), QString("parameter, /lights/%1/effect, is not modifiable. Device is set to off.").arg(id)));
         }
-        else if ((effect == "none") || (effect == "colorloop"))
+        else
         {
-            hasEffectColorLoop = effect == "colorloop";
-            uint16_t speed = 15;
-
-            if (hasEffectColorLoop)
+            if (hasEffectColorLoop && map.contains("colorloopspeed"))
             {
-                if (map.contains("colorloopspeed"))
+                if (change.hasColorLoopSpeed)
                 {
-                    speed = map["colorloopspeed"].toUInt(&ok);
-                    if (ok && (map["colorloopspeed"].type() == QVariant::Double) && (speed < 256) && (speed > 0))
-                    {
-                        // ok
-                        taskRef.lightNode->setColorLoopSpeed(speed);
-                    }
-                    else
-                    {
-                        rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/colorloopspeed").arg(id), QString("invalid value, %1, for parameter, colorloopspeed").arg(map["colorloopspeed"].toString())));
-                    }
+                    taskRef.lightNode->setColorLoopSpeed(change.colorLoopSpeed);
+                }
+                else
+                {
+                    rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/colorloopspeed").arg(id), QString("invalid value, %1, for parameter, colorloopspeed").arg(map["colorloopspeed"].toString())));
                 }
             }
 
             TaskItem task;
             copyTaskReq(taskRef, task);
-            if (addTaskSetColorLoop(task, hasEffectColorLoop, speed))
+            if (addTaskSetColorLoop(task, hasEffectColorLoop, change.colorLoopSpeed))
             {
                 QVariantMap rspItem;
                 QVariantMap rspItemState;
@@ -800,26 +916,18 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
                 rsp.list.append(errorToMap(ERR_INTERNAL_ERROR, QString("/lights/%1").arg(id), QString("Internal error, %1").arg(ERR_BRIDGE_BUSY)));
             }
         }
-        else
-        {
-            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/effect").arg(id), QString("invalid value, %1, for parameter, effect").arg(map["effect"].toString())));
-            rsp.httpStatus = HttpStatusBadRequest;
-            return REQ_READY_SEND;
-        }
     }
 
     // hue
     if (hasHue)
     {
-        uint hue2 = map["hue"].toUInt(&ok);
-
         if (!isOn)
         {
             rsp.list.append(errorToMap(ERR_DEVICE_OFF, QString("/lights/%1").arg(id), QString("parameter, /lights/%1/hue, is not modifiable. Device is set to off.").arg(id)));
         }
-        else if (ok && (map["hue"].type() == QVariant::Double) && (hue2 <= MAX_ENHANCED_HUE))
+        else
         {
-            hue = hue2;
+            hue = change.hue;
             TaskItem task;
             copyTaskReq(taskRef, task);
             { // TODO: this is needed if saturation is set and addTaskSetEnhancedHue() will not be called
@@ -903,47 +1011,38 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
                 rsp.list.append(errorToMap(ERR_INTERNAL_ERROR, QString("/lights/%1").arg(id), QString("Internal error, %1").arg(ERR_BRIDGE_BUSY)));
             }
         }
-        else
-        {
-            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/hue").arg(id), QString("invalid value, %1, for parameter, hue").arg(map["hue"].toString())));
-            rsp.httpStatus = HttpStatusBadRequest;
-            return REQ_READY_SEND;
-        }
     }
 
     // saturation
     if (hasSat)
     {
-        uint sat2 = map["sat"].toUInt(&ok);
+        uint sat2 = change.sat;
 
         //FIXME workaround window_covering
         if (isWindowCoveringDevice)
         {
-        	if (ok && (map["sat"].type() == QVariant::Double) && (sat2 < 256))
-        	{
-        		TaskItem task;
-        		copyTaskReq(taskRef, task);
-        		uint8_t moveToPct = 0x00;
-        		moveToPct = sat2 * 100 / 255;  // Percent 0 - 100 (0x00 - 0x64)
-        		if (addTaskWindowCovering(task, 0x08 /*move to Tilt Percent*/, 0, moveToPct))
-        		{
-        			QVariantMap rspItem;
-        			QVariantMap rspItemState;
-        			rspItemState[QString("/lights/%1/state/sat").arg(id)] = map["sat"];
-        			rspItem["success"] = rspItemState;
-        			rsp.list.append(rspItem);
-        		}
-        		else
-        		{
-        			rsp.list.append(errorToMap(ERR_INTERNAL_ERROR, QString("/lights/%1").arg(id), QString("Internal error, %1").arg(ERR_BRIDGE_BUSY)));
-        		}
-        	}
+            TaskItem task;
+            copyTaskReq(taskRef, task);
+            uint8_t moveToPct = 0x00;
+            moveToPct = sat2 * 100 / 255;  // Percent 0 - 100 (0x00 - 0x64)
+            if (addTaskWindowCovering(task, 0x08 /*move to Tilt Percent*/, 0, moveToPct))
+            {
+                QVariantMap rspItem;
+                QVariantMap rspItemState;
+                rspItemState[QString("/lights/%1/state/sat").arg(id)] = map["sat"];
+                rspItem["success"] = rspItemState;
+                rsp.list.append(rspItem);
+            }
+            else
+            {
+                rsp.list.append(errorToMap(ERR_INTERNAL_ERROR, QString("/lights/%1").arg(id), QString("Internal error, %1").arg(ERR_BRIDGE_BUSY)));
+            }
         } //FIXME workaround window_covering
         else if (!isOn)
         {
             rsp.list.append(errorToMap(ERR_DEVICE_OFF, QString("/lights/%1").arg(id), QString("parameter, /lights/%1/sat, is not modifiable. Device is set to off.").arg(id)));
         }
-        else if (ok && (map["sat"].type() == QVariant::Double) && (sat2 < 256))
+        else
         {
             if (sat2 == 255)
             {
@@ -1016,20 +1115,13 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
                 rsp.list.append(errorToMap(ERR_INTERNAL_ERROR, QString("/lights/%1").arg(id), QString("Internal error, %1").arg(ERR_BRIDGE_BUSY)));
             }
         }
-        else
-        {
-            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/sat").arg(id), QString("invalid value, %1, for parameter, sat").arg(map["sat"].toString())));
-            rsp.httpStatus = HttpStatusBadRequest;
-            return REQ_READY_SEND;
-        }
     }
 
     // ct_inc
-    if (hasCtInc)
+    if (change.hasCtInc)
     {
         ResourceItem *item = taskRef.lightNode->item(RStateCt);
-
-        int ct_inc = map["ct_inc"].toInt(&ok);
+        const int ct_inc = change.ctInc;
 
         if (!item)
         {
@@ -1043,7 +1135,7 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
         {
             rsp.list.append(errorToMap(ERR_PARAMETER_NOT_MODIFIEABLE, QString("/lights/%1").arg(id), QString("parameter, /lights/%1/ct_inc, is not modifiable. ct was specified.").arg(id)));
         }
-        else if (ok && (map["ct_inc"].type() == QVariant::Double) && (ct_inc >= -65534 && ct_inc <= 65534))
+        else
         {
             TaskItem task;
             copyTaskReq(taskRef, task);
@@ -1064,21 +1156,15 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
                 rsp.list.append(errorToMap(ERR_INTERNAL_ERROR, QString("/lights/%1").arg(id), QString("Internal error, %1").arg(ERR_BRIDGE_BUSY)));
             }
         }
-        else
-        {
-            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/ct_inc").arg(id), QString("invalid value, %1, for parameter, ct_inc").arg(map["ct_inc"].toString())));
-            rsp.httpStatus = HttpStatusBadRequest;
-            return REQ_READY_SEND;
-        }
     }
 
-    if (hasBriInc && !hasBri)
+    if (change.hasBriInc)
     {
         ResourceItem *item = taskRef.lightNode->item(RStateBri);
 
-        int briInc = map["bri_inc"].toInt(&ok);
+        int briInc = change.briInc;
 
-        if (ok && hasWrap && map["wrap"].type() == QVariant::Bool && map["wrap"].toBool() == true) {
+        if (item && change.wrap) {
             const int bri = static_cast<int>(item->toNumber());
 
             if (briInc < 0 && bri + briInc <= -briInc)
@@ -1098,7 +1184,7 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
         //FIXME workaround window_covering
         else if (isWindowCoveringDevice)
         {
-            if (ok && (map["bri_inc"].type() == QVariant::Double) && (briInc == 0))
+            if (briInc == 0)
         	{
         		TaskItem task;
         		copyTaskReq(taskRef, task);
@@ -1121,7 +1207,7 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
         {
             rsp.list.append(errorToMap(ERR_DEVICE_OFF, QString("/lights/%1").arg(id), QString("parameter, /lights/%1/bri, is not modifiable. Device is set to off.").arg(id)));
         }
-        else if (ok && (map["bri_inc"].type() == QVariant::Double) && (briInc >= -254 && briInc <= 254))
+        else
         {
             TaskItem task;
             copyTaskReq(taskRef, task);
@@ -1142,12 +1228,6 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
                 rsp.list.append(errorToMap(ERR_INTERNAL_ERROR, QString("/lights/%1").arg(id), QString("Internal error, %1").arg(ERR_BRIDGE_BUSY)));
             }
         }
-        else
-        {
-            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/bri_inc").arg(id), QString("invalid value, %1, for parameter, bri_inc").arg(map["bri_inc"].toString())));
-            rsp.httpStatus = HttpStatusBadRequest;
-            return REQ_READY_SEND;
-        }
     }
 
     // hue and saturation
@@ -1206,20 +1286,18 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
     // xy
     if (hasXy)
     {
-        QVariantList ls = map["xy"].toList();
-
         if (!isOn)
         {
             rsp.list.append(errorToMap(ERR_DEVICE_OFF, QString("/lights/%1").arg(id), QString("parameter, /lights/%1/xy, is not modifiable. Device is set to off.").arg(id)));
         }
-        else if ((ls.size() == 2) && (ls[0].type() == QVariant::Double) && (ls[1].type() == QVariant::Double))
+        else
         {
-            double x = ls[0].toDouble(&ok);
-            double y = ok ? ls[1].toDouble(&ok) : 0;
+            const double x = change.x;
+            const double y = change.y;
             TaskItem task;
             copyTaskReq(taskRef, task);
 
-            if (!ok || (x < 0) || (x > 1) || (y < 0) || (y > 1))
+            if ((x < 0) || (x > 1) || (y < 0) || (y > 1))
             {
                 rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1").arg(id), QString("invalid value, [%1,%2], for parameter, /lights/%3/xy").arg(x).arg(y).arg(id)));
             }
@@ -1238,29 +1316,21 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
                 rsp.list.append(errorToMap(ERR_INTERNAL_ERROR, QString("/lights/%1").arg(id), QString("Internal error, %1").arg(ERR_BRIDGE_BUSY)));
             }
         }
-        else
-        {
-            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/xy").arg(id), QString("invalid value, %1, for parameter, xy").arg(map["xy"].toString())));
-            rsp.httpStatus = HttpStatusBadRequest;
-            return REQ_READY_SEND;
-        }
     }
 
     // color temperature
     if (hasCt)
     {
-        uint16_t ct = map["ct"].toUInt(&ok);
-
         if (!isOn)
         {
             rsp.list.append(errorToMap(ERR_DEVICE_OFF, QString("/lights/%1").arg(id), QString("parameter, /lights/%1/ct, is not modifiable. Device is set to off.").arg(id)));
         }
-        else if (ok && (map["ct"].type() == QVariant::Double))
+        else
         {
             TaskItem task;
             copyTaskReq(taskRef, task);
             if (hasXy || hasEffectColorLoop ||
-                addTaskSetColorTemperature(task, ct)) // will only be evaluated if no xy and color loop is set
+                addTaskSetColorTemperature(task, change.ct)) // will only be evaluated if no xy and color loop is set
             {
                 QVariantMap rspItem;
                 QVariantMap rspItemState;
@@ -1277,21 +1347,15 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
                 rsp.list.append(errorToMap(ERR_INTERNAL_ERROR, QString("/lights/%1").arg(id), QString("Internal error, %1").arg(ERR_BRIDGE_BUSY)));
             }
         }
-        else
-        {
-            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/ct").arg(id), QString("invalid value, %1, for parameter, ct").arg(map["ct"].toString())));
-            rsp.httpStatus = HttpStatusBadRequest;
-            return REQ_READY_SEND;
-        }
     }
 
     // alert
-    if (hasAlert)
+    if (change.hasAlert)
     {
         TaskItem task;
         copyTaskReq(taskRef, task);
-        QString alert = map["alert"].toString();
-        bool isWarningDevice = taskRef.lightNode->type() == QLatin1String("Warning device");
+        const QString &alert = change.alert;
+        const bool isWarningDevice = caps.has(LightCapabilities::CapWarningDevice);
 
         if (alert == "none")
         {
@@ -1374,12 +1438,6 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
             task.taskType = TaskTriggerEffect;
             task.effectIdentifier = 0xff;
         }
-        else
-        {
-            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/lights/%1/state/alert").arg(id), QString("invalid value, %1, for parameter, alert").arg(map["alert"].toString())));
-            rsp.httpStatus = HttpStatusBadRequest;
-            return REQ_READY_SEND;
-        }
 
         taskToLocalData(task);
 
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2020 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include "de_web_plugin.h"
+#include "de_web_plugin_private.h"
+
+/*! Metrics REST API broker.
+    \param req - request data
+    \param rsp - response data
+    \return REQ_READY_SEND
+            REQ_NOT_HANDLED
+ */
+int DeRestPluginPrivate::handleMetricsApi(const ApiRequest &req, ApiResponse &rsp)
+{
+    if (req.hdr.method() != QLatin1String("GET"))
+    {
+        return REQ_NOT_HANDLED;
+    }
+
+    // GET /api/<apikey>/metrics
+    if (req.path.size() == 3)
+    {
+        return getMetrics(req, rsp);
+    }
+
+    // GET /api/<apikey>/metrics/prometheus
+    if ((req.path.size() == 4) && (req.path[3] == QLatin1String("prometheus")))
+    {
+        return getMetricsPrometheus(req, rsp);
+    }
+
+    return REQ_NOT_HANDLED;
+}
+
+/*! GET /api/<apikey>/metrics
+    \return REQ_READY_SEND
+            REQ_NOT_HANDLED
+ */
+int DeRestPluginPrivate::getMetrics(const ApiRequest &req, ApiResponse &rsp)
+{
+    Q_UNUSED(req);
+
+    metrics.setGauge(QLatin1String("uptime_seconds"), starttimeRef.elapsed() / 1000);
+    rsp.map = metrics.toMap();
+    rsp.httpStatus = HttpStatusOk;
+    return REQ_READY_SEND;
+}
+
+/*! GET /api/<apikey>/metrics/prometheus
+    \return REQ_READY_SEND
+            REQ_NOT_HANDLED
+ */
+int DeRestPluginPrivate::getMetricsPrometheus(const ApiRequest &req, ApiResponse &rsp)
+{
+    Q_UNUSED(req);
+
+    metrics.setGauge(QLatin1String("uptime_seconds"), starttimeRef.elapsed() / 1000);
+    rsp.str = metrics.toPrometheus();
+    rsp.contentType = HttpContentPrometheus;
+    rsp.httpStatus = HttpStatusOk;
+    return REQ_READY_SEND;
+}
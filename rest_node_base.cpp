@@ -267,7 +267,7 @@ void RestNodeBase::setMgmtBindSupported(bool supported)
  */
 void RestNodeBase::setZclValue(NodeValue::UpdateType updateType, quint16 clusterId, quint16 attributeId, const deCONZ::NumericUnion &value)
 {
-    QDateTime now = QDateTime::currentDateTime();
+    const QDateTime now = CachedClock::currentDateTime();
     std::vector<NodeValue>::iterator i = m_values.begin();
     std::vector<NodeValue>::iterator end = m_values.end();
 
@@ -375,5 +375,61 @@ const QDateTime &RestNodeBase::lastRx() const
 /*! Mark received command. */
 void RestNodeBase::rx()
 {
-    m_lastRx = QDateTime::currentDateTime();
+    m_lastRx = CachedClock::currentDateTime();
+}
+
+/*! Returns timestamp when a poll request was sent to the node the last time. */
+const QDateTime &RestNodeBase::lastPoll() const
+{
+    return m_lastPoll;
+}
+
+/*! Sets timestamp when a poll request was sent to the node the last time. */
+void RestNodeBase::setLastPoll(const QDateTime &lastPoll)
+{
+    m_lastPoll = lastPoll;
+}
+
+/*! Returns true if all values with attribute reporting are refreshed by reports.
+    Nodes which have no reporting values at all are not considered to be reporting.
+ */
+bool RestNodeBase::isReporting(const QDateTime &now) const
+{
+    int reporting = 0;
+
+    for (const NodeValue &val : m_values)
+    {
+        if (!val.timestampLastReport.isValid() && !val.timestampLastConfigured.isValid())
+        {
+            continue; // no reporting for this value
+        }
+
+        if (val.maxInterval == 0xFFFF)
+        {
+            continue; // reporting disabled by configuration
+        }
+
+        if (!val.isFreshByReport(now))
+        {
+            return false;
+        }
+        reporting++;
+    }
+
+    return reporting > 0;
+}
+
+/*! Returns true if the value was refreshed by a report within its reporting interval.
+    The configured max interval is extended by some slack, values without a known
+    interval are considered fresh for POLL_REPORT_WAIT_TIME seconds.
+ */
+bool NodeValue::isFreshByReport(const QDateTime &now) const
+{
+    if (!timestampLastReport.isValid())
+    {
+        return false;
+    }
+
+    const int maxAge = qMax(POLL_REPORT_WAIT_TIME, int(maxInterval) * 6 / 5 + 60);
+    return timestampLastReport.secsTo(now) < maxAge;
 }
@@ -34,11 +34,13 @@ public:
         value.u64 = 0;
     }
     bool isValid() const { return updateType != UpdateInvalid; }
+    bool isFreshByReport(const QDateTime &now) const;
 
     QDateTime timestamp;
     QDateTime timestampLastReport;
     QDateTime timestampLastReadRequest;
     QDateTime timestampLastConfigured;
+    QDateTime timestampLastVerified; // last Read Reporting Configuration
     UpdateType updateType;
     quint16 clusterId;
     quint16 attributeId;
@@ -87,6 +89,9 @@ public:
     const std::vector<NodeValue> &zclValues() const;
     const QDateTime &lastRx() const;
     void rx();
+    const QDateTime &lastPoll() const;
+    void setLastPoll(const QDateTime &lastPoll);
+    bool isReporting(const QDateTime &now) const;
 
 private:
     deCONZ::Node *m_node;
@@ -101,6 +106,7 @@ private:
     int m_lastAttributeReportBind; // copy of idleTotalCounter
     std::vector<QTime> m_nextReadTime;
     QDateTime m_lastRx;
+    QDateTime m_lastPoll;
 
     NodeValue m_invalidValue;
     std::vector<NodeValue> m_values;
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2020 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include "de_web_plugin.h"
+#include "de_web_plugin_private.h"
+#include "rest_router.h"
+
+/*! Constructor, creates the root node.
+ */
+RestRouter::RestRouter() :
+    m_metrics(nullptr)
+{
+    m_nodes.push_back(Node());
+}
+
+/*! Returns the RestRouter::Method bit of a HTTP method or 0 if not supported.
+ */
+int RestRouter::methodFromString(const QString &method)
+{
+    if (method == QLatin1String("GET"))    { return MethodGet; }
+    if (method == QLatin1String("PUT"))    { return MethodPut; }
+    if (method == QLatin1String("PATCH"))  { return MethodPatch; }
+    if (method == QLatin1String("POST"))   { return MethodPost; }
+    if (method == QLatin1String("DELETE")) { return MethodDelete; }
+    return 0;
+}
+
+/*! Adds a route to the trie.
+    \param methods - bitmap of RestRouter::Method
+    \param pattern - path relative to /api/<apikey>
+    \param handler - function which handles the request
+ */
+void RestRouter::addRoute(int methods, const QString &pattern, const Handler &handler)
+{
+    int node = 0;
+    const QStringList segments = pattern.split(QLatin1Char('/'), QString::SkipEmptyParts);
+
+    for (const QString &seg : segments)
+    {
+        int next = -1;
+
+        if (seg == QLatin1String("*"))
+        {
+            next = m_nodes[node].wildcard;
+        }
+        else if (seg.startsWith(QLatin1Char(':')))
+        {
+            next = m_nodes[node].param;
+        }
+        else
+        {
+            next = m_nodes[node].children.value(seg, -1);
+        }
+
+        if (next == -1)
+        {
+            next = int(m_nodes.size());
+            m_nodes.push_back(Node());
+
+            if (seg == QLatin1String("*"))          { m_nodes[node].wildcard = next; }
+            else if (seg.startsWith(QLatin1Char(':'))) { m_nodes[node].param = next; }
+            else                                      { m_nodes[node].children.insert(seg, next); }
+        }
+
+        node = next;
+    }
+
+    Route route;
+    route.methods = methods;
+    route.name = pattern;
+    route.metric = m_metrics ? m_metrics->histogram(QLatin1String("http_route_duration_us{route=\"") + pattern + QLatin1String("\"}")) : -1;
+    route.handler = handler;
+    m_nodes[node].routes.push_back(int(m_routes.size()));
+    m_routes.push_back(route);
+}
+
+/*! Returns true if routes exist below the top level \p resource.
+ */
+bool RestRouter::hasResource(const QString &resource) const
+{
+    return m_nodes[0].children.contains(resource);
+}
+
+/*! Returns the route of a node which accepts \p method or -1.
+ */
+int RestRouter::routeForMethod(int node, int method) const
+{
+    for (int r : m_nodes[node].routes)
+    {
+        if (m_routes[r].methods & method)
+        {
+            return r;
+        }
+    }
+    return -1;
+}
+
+/*! Matches path segments from \p pos on, backtracks from literals to parameters.
+    \return the route index or -1
+ */
+int RestRouter::match(int node, const QStringList &path, int pos, int method) const
+{
+    const Node &n = m_nodes[node];
+
+    if (pos == path.size())
+    {
+        const int r = routeForMethod(node, method);
+        if (r != -1 || n.wildcard == -1)
+        {
+            return r;
+        }
+        return routeForMethod(n.wildcard, method);
+    }
+
+    const int literal = n.children.value(path[pos], -1);
+    if (literal != -1)
+    {
+        const int r = match(literal, path, pos + 1, method);
+        if (r != -1)
+        {
+            return r;
+        }
+    }
+
+    if (n.param != -1)
+    {
+        const int r = match(n.param, path, pos + 1, method);
+        if (r != -1)
+        {
+            return r;
+        }
+    }
+
+    if (n.wildcard != -1)
+    {
+        return routeForMethod(n.wildcard, method);
+    }
+
+    return -1;
+}
+
+/*! Dispatches a request to the matching route.
+    \return the handler result or REQ_NOT_HANDLED if no route matches
+ */
+int RestRouter::dispatch(const ApiRequest &req, ApiResponse &rsp) const
+{
+    const int method = methodFromString(req.hdr.method());
+
+    if (method == 0 || req.path.size() < 3)
+    {
+        return REQ_NOT_HANDLED;
+    }
+
+    const int r = match(0, req.path, 2, method); // skip api/<apikey>
+
+    if (r == -1)
+    {
+        return REQ_NOT_HANDLED;
+    }
+
+    const Route &route = m_routes[r];
+    MetricsTimer timer(route.metric != -1 ? m_metrics : nullptr, route.metric);
+    return route.handler(req, rsp);
+}
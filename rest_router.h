@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2020 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef REST_ROUTER_H
+#define REST_ROUTER_H
+
+#include <functional>
+#include <vector>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+class ApiRequest;
+struct ApiResponse;
+class Metrics;
+
+/*! \class RestRouter
+
+    Dispatches REST API requests through a path trie compiled from a route table.
+    Patterns are relative to /api/<apikey> and consist of literal segments,
+    ":name" parameters which match any single segment and a trailing "*" which
+    matches all remaining segments, e.g. "lights/:id/state" or "config/*".
+    Literal segments take precedence over parameters. Matched parameters stay
+    accessible by position in ApiRequest::path.
+ */
+class RestRouter
+{
+public:
+    enum Method
+    {
+        MethodGet    = 0x01,
+        MethodPut    = 0x02,
+        MethodPatch  = 0x04,
+        MethodPost   = 0x08,
+        MethodDelete = 0x10
+    };
+
+    typedef std::function<int (const ApiRequest &req, ApiResponse &rsp)> Handler;
+
+    RestRouter();
+    void setMetrics(Metrics *metrics) { m_metrics = metrics; } // call before addRoute()
+    void addRoute(int methods, const QString &pattern, const Handler &handler);
+    bool hasResource(const QString &resource) const;
+    int dispatch(const ApiRequest &req, ApiResponse &rsp) const;
+
+    static int methodFromString(const QString &method);
+
+private:
+    struct Node
+    {
+        QHash<QString, int> children; // literal segment -> node index
+        int param = -1; // node index of ":name" child
+        int wildcard = -1; // node index of "*" child
+        std::vector<int> routes; // route indexes ending here
+    };
+
+    struct Route
+    {
+        int methods;
+        QString name;
+        int metric; // http_route_duration_us handle or -1
+        Handler handler;
+    };
+
+    int match(int node, const QStringList &path, int pos, int method) const;
+    int routeForMethod(int node, int method) const;
+
+    std::vector<Node> m_nodes;
+    std::vector<Route> m_routes;
+    Metrics *m_metrics;
+};
+
+#endif // REST_ROUTER_H
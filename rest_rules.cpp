@@ -8,13 +8,11 @@
  *
  */
 
-#include <QBuffer>
 #include <QString>
 #include <QVariantMap>
 #include <QRegExp>
 #include <QStringBuilder>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
+#include <QUrl>
 #include "de_web_plugin.h"
 #include "de_web_plugin_private.h"
 #include "json.h"
@@ -31,33 +29,13 @@
  */
 int DeRestPluginPrivate::handleRulesApi(const ApiRequest &req, ApiResponse &rsp)
 {
-    // GET /api/<apikey>/rules
-    if ((req.path.size() == 3) && (req.hdr.method() == "GET")  && (req.path[2] == "rules"))
+    if (req.path.size() < 3 || req.path[2] != QLatin1String("rules"))
     {
-        return getAllRules(req, rsp);
-    }
-    // GET /api/<apikey>/rules/<id>
-    else if ((req.path.size() == 4) && (req.hdr.method() == "GET") && (req.path[2] == "rules"))
-    {
-        return getRule(req, rsp);
-    }
-    // POST /api/<apikey>/rules
-    else if ((req.path.size() == 3) && (req.hdr.method() == "POST") && (req.path[2] == "rules"))
-    {
-        return createRule(req, rsp);
-    }
-    // PUT, PATCH /api/<apikey>/rules/<id>
-    else if ((req.path.size() == 4) && (req.hdr.method() == "PUT" || req.hdr.method() == "PATCH") && (req.path[2] == "rules"))
-    {
-        return updateRule(req, rsp);
-    }
-    // DELETE /api/<apikey>/rules/<id>
-    else if ((req.path.size() == 4) && (req.hdr.method() == "DELETE") && (req.path[2] == "rules"))
-    {
-        return deleteRule(req, rsp);
+        return REQ_NOT_HANDLED;
     }
 
-    return REQ_NOT_HANDLED;
+    // routes are defined in initRestRouter()
+    return restRouter.dispatch(req, rsp);
 }
 
 
@@ -963,12 +941,14 @@ bool DeRestPluginPrivate::queueBindingTask(const BindingTask &bindingTask)
         return false;
     }
 
-    const std::list<BindingTask>::const_iterator i = std::find(bindingQueue.begin(), bindingQueue.end(), bindingTask);
+    const BindingTaskKey key = bindingTask.key();
 
-    if (i == bindingQueue.end())
+    if (!bindingQueueIndex.contains(key))
     {
         DBG_Printf(DBG_INFO_L2, "queue binding task for 0x%016llX, cluster 0x%04X\n", bindingTask.binding.srcAddress, bindingTask.binding.clusterId);
         bindingQueue.push_back(bindingTask);
+        bindingQueue.back().deadline = starttimeRef.elapsed() + bindingTask.timeout * 1000;
+        bindingQueueIndex.insert(key, std::prev(bindingQueue.end()));
     }
     else
     {
@@ -1231,7 +1211,7 @@ bool DeRestPluginPrivate::evaluateRule(Rule &rule, const Event &e, Resource *eRe
         return false;
     }
 
-    const QDateTime now = QDateTime::currentDateTime();
+    const QDateTime now = CachedClock::currentDateTime();
 
     if (rule.triggerPeriodic() > 0)
     {
@@ -1435,6 +1415,7 @@ void DeRestPluginPrivate::indexRuleTriggers(Rule &rule)
 {
     ResourceItem *itemDx = 0;
     ResourceItem *itemDdx = 0;
+    ResourceItem *itemDdxSource = 0;
     std::vector<ResourceItem*> items;
 
     for (const RuleCondition &c : rule.conditions())
@@ -1470,6 +1451,7 @@ void DeRestPluginPrivate::indexRuleTriggers(Rule &rule)
             DBG_Assert(itemDx == 0);
             DBG_Assert(itemDdx == 0);
             itemDdx = item;
+            itemDdxSource = item;
         }
         else if (c.op() == RuleCondition::OpStable) { }
         else if (c.op() == RuleCondition::OpNotStable) { }
@@ -1495,6 +1477,8 @@ void DeRestPluginPrivate::indexRuleTriggers(Rule &rule)
         {
             items.push_back(itemDdx);
         }
+        // changes of the source item move the ddx deadline, see handleRuleEvent()
+        items.push_back(itemDdxSource);
     }
 
     for (ResourceItem *item : items)
@@ -1502,6 +1486,133 @@ void DeRestPluginPrivate::indexRuleTriggers(Rule &rule)
         item->inRule(rule.handle());
         DBG_Printf(DBG_INFO_L2, "\t%s (trigger)\n", item->descriptor().suffix);
     }
+
+    scheduleRuleTimeTrigger(rule, CachedClock::wallMs());
+}
+
+/*! Returns the first local time at or after \p from with the time of day \p t.
+ */
+static QDateTime nextTimeOfDay(const QDateTime &from, const QTime &t)
+{
+    QDateTime dt(from.date(), t);
+    if (dt < from)
+    {
+        dt = QDateTime(from.date().addDays(1), t);
+    }
+    return dt;
+}
+
+/*! Queues the next instant at which a rule needs to be evaluated for config/localtime.
+    These are the window edges of "in" and "not in" conditions and "ddx" deadlines.
+    Other operators on config/localtime have no known edge and are queued every second.
+    \param rule - the rule to schedule
+    \param fromMs - earliest instant in ms since epoch
+ */
+void DeRestPluginPrivate::scheduleRuleTimeTrigger(const Rule &rule, qint64 fromMs)
+{
+    for (auto i = ruleTimeTriggers.begin(); i != ruleTimeTriggers.end(); )
+    {
+        if (i->second == rule.handle())
+        {
+            i = ruleTimeTriggers.erase(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    if (rule.state() == Rule::StateDeleted)
+    {
+        return;
+    }
+
+    const QDateTime from = QDateTime::fromMSecsSinceEpoch(fromMs);
+    qint64 due = -1;
+
+    for (const RuleCondition &c : rule.conditions())
+    {
+        QDateTime dt;
+
+        if (c.op() == RuleCondition::OpDdx)
+        {
+            Resource *resource = getResource(c.resource(), c.id());
+            ResourceItem *item = resource ? resource->item(c.suffix()) : 0;
+
+            if (item && item->lastChanged().isValid())
+            {
+                dt = item->lastChanged().addSecs(c.seconds());
+            }
+        }
+        else if (c.suffix() != RConfigLocalTime)
+        {
+            continue;
+        }
+        else if (c.op() == RuleCondition::OpIn)
+        {
+            dt = nextTimeOfDay(from, c.time0());
+        }
+        else if (c.op() == RuleCondition::OpNotIn)
+        {
+            dt = nextTimeOfDay(from, c.time1());
+        }
+        else
+        {
+            dt = from;
+        }
+
+        if (!dt.isValid() || dt < from)
+        {
+            continue;
+        }
+
+        const qint64 ms = dt.toMSecsSinceEpoch();
+        if (due == -1 || ms < due)
+        {
+            due = ms;
+        }
+    }
+
+    if (due != -1)
+    {
+        ruleTimeTriggers.insert(std::make_pair(due, rule.handle()));
+    }
+}
+
+/*! Takes the due entries from the rule time trigger queue and schedules their next instant.
+    \param nowMs - current time in ms since epoch
+    \return true if a config/localtime event needs to be generated
+ */
+bool DeRestPluginPrivate::ruleTimeTriggersDue(qint64 nowMs)
+{
+    std::vector<std::pair<qint64, int>> due;
+
+    // evaluateRule() compares the whole seconds of the window edges, so fire only once
+    // the instant is reached, i.e. within the edge second for the 1000 ms idle timer
+    while (!ruleTimeTriggers.empty() && ruleTimeTriggers.begin()->first <= nowMs)
+    {
+        due.push_back(*ruleTimeTriggers.begin());
+        ruleTimeTriggers.erase(ruleTimeTriggers.begin());
+    }
+
+    for (const auto &d : due)
+    {
+        for (const Rule &rule : rules)
+        {
+            if (rule.handle() == d.second)
+            {
+                scheduleRuleTimeTrigger(rule, qMax(d.first, nowMs) + 1000);
+                break;
+            }
+        }
+    }
+
+    if (!due.empty())
+    {
+        metrics.increment(QLatin1String("rule_time_triggers_total"));
+    }
+
+    return !due.empty();
 }
 
 /*! Triggers actions of a rule.
@@ -1536,8 +1647,15 @@ void DeRestPluginPrivate::triggerRule(Rule &rule)
         if (ai->method() != QLatin1String("PUT") && ai->method() != QLatin1String("POST"))
             return;
 
+        if (ai->command() == RuleAction::CommandGroupAction && triggerGroupActionCommand(*ai))
+        {
+            metrics.increment(QLatin1String("rule_actions_total{path=\"command\"}"));
+            triggered = true;
+            continue;
+        }
 
-        QStringList path = ai->address().split(QChar('/'), QString::SkipEmptyParts);
+        metrics.increment(QLatin1String("rule_actions_total{path=\"rest\"}"));
+        QStringList path = ai->path();
 
         if (path.isEmpty()) // at least: /config, /groups, /lights, /sensors
             return;
@@ -1632,67 +1750,24 @@ void DeRestPluginPrivate::triggerRule(Rule &rule)
     }
 }
 
-/*! Sends a HTTP request aka webhook based on a rule action.
+/*! Queues a HTTP request aka webhook based on a rule action in the WebhookDispatcher.
     \param action - the action holding the request details
+    \return REQ_READY_SEND or REQ_NOT_HANDLED if the queue is full
  */
 int DeRestPluginPrivate::handleWebHook(const RuleAction &action)
 {
-    QNetworkRequest req(QUrl(action.address()));
+    bool ok = false;
+    Json::parse(action.body(), ok);
+    const QByteArray contentType = ok ? QByteArray("application/json") : QByteArray();
 
-    QBuffer *data = new QBuffer(this);
-    DBG_Assert(data);
-    if (!data)
+    if (webhookDispatcher->enqueue(QUrl(action.address()), action.method().toLatin1(), action.body().toUtf8(), contentType))
     {
-        return REQ_NOT_HANDLED;
-    }
-
-    data->setData(action.body().toUtf8());
-
-    QNetworkReply *reply = webhookManager->sendCustomRequest(req, action.method().toLatin1(), data);
-    DBG_Assert(reply);
-    if (reply)
-    {
-        reply->setProperty("buf", QVariant::fromValue(data));
         return REQ_READY_SEND;
     }
 
     return REQ_NOT_HANDLED;
 }
 
-/*! Handler for finished webhooks.
-  */
-void DeRestPluginPrivate::webhookFinishedRequest(QNetworkReply *reply)
-{
-    if (!reply)
-    {
-        return;
-    }
-
-    if (reply->property("buf").canConvert<QBuffer*>())
-    {
-        QBuffer *buf  = reply->property("buf").value<QBuffer*>();
-        buf->deleteLater();
-    }
-
-    DBG_Printf(DBG_INFO, "Webhook finished: %s (code: %d)\n", qPrintable(reply->url().toString()), reply->error());
-
-    if (DBG_IsEnabled(DBG_HTTP))
-    {
-        for (const auto &hdr : reply->rawHeaderPairs())
-        {
-            DBG_Printf(DBG_HTTP, "%s: %s\n", qPrintable(hdr.first), qPrintable(hdr.second));
-        }
-
-        QByteArray data = reply->readAll();
-        if (!data.isEmpty())
-        {
-            DBG_Printf(DBG_HTTP, "%s\n", qPrintable(data));
-        }
-    }
-
-    reply->deleteLater();
-}
-
 /*! Verifies that rule bindings are valid. */
 void DeRestPluginPrivate::verifyRuleBindingsTimerFired()
 {
@@ -1806,6 +1881,18 @@ void DeRestPluginPrivate::handleRuleEvent(const Event &e)
                 continue;
             }
 
+            if (e.what() != RConfigLocalTime)
+            {
+                for (const RuleCondition &c : rules[i].conditions())
+                {
+                    if (c.op() == RuleCondition::OpDdx)
+                    {
+                        scheduleRuleTimeTrigger(rules[i], CachedClock::wallMs());
+                        break;
+                    }
+                }
+            }
+
             if (evaluateRule(rules[i], e, resource, item))
             {
                 rulesToTrigger.push_back(i);
@@ -1813,6 +1900,9 @@ void DeRestPluginPrivate::handleRuleEvent(const Event &e)
         }
     }
 
+    // tasks queued by rules of a button event carry the probe start
+    ruleTriggerStartUs = (e.what() == RStateButtonEvent) ? buttonEventStartUs : 0;
+
     for (size_t i : rulesToTrigger)
     {
         DBG_Assert(i < rules.size());
@@ -1822,6 +1912,8 @@ void DeRestPluginPrivate::handleRuleEvent(const Event &e)
         }
     }
 
+    ruleTriggerStartUs = 0;
+
     //int dt = t.elapsed();
     //if  (dt > 0)
     //{
@@ -1046,7 +1046,7 @@ void DeRestPluginPrivate::scheduleTimerFired()
     std::vector<Schedule>::iterator i = schedules.begin();
     std::vector<Schedule>::iterator end = schedules.end();
 
-    QDateTime now = QDateTime::currentDateTime();
+    QDateTime now = CachedClock::currentDateTime();
 
     for (; i != end; ++i)
     {
@@ -31,64 +31,8 @@ int DeRestPluginPrivate::handleSensorsApi(const ApiRequest &req, ApiResponse &rs
         return REQ_NOT_HANDLED;
     }
 
-    // GET /api/<apikey>/sensors
-    if ((req.path.size() == 3) && (req.hdr.method() == "GET"))
-    {
-        return getAllSensors(req, rsp);
-    }
-    // GET /api/<apikey>/sensors/new
-    else if ((req.path.size() == 4) && (req.hdr.method() == "GET") && (req.path[3] == "new"))
-    {
-        return getNewSensors(req, rsp);
-    }
-    // GET /api/<apikey>/sensors/<id>
-    else if ((req.path.size() == 4) && (req.hdr.method() == "GET"))
-    {
-        return getSensor(req, rsp);
-    }
-    // GET /api/<apikey>/sensors/<id>/data?maxrecords=<maxrecords>&fromtime=<ISO 8601>
-    else if ((req.path.size() == 5) && (req.hdr.method() == "GET") && (req.path[4] == "data"))
-    {
-        return getSensorData(req, rsp);
-    }
-    // POST /api/<apikey>/sensors
-    else if ((req.path.size() == 3) && (req.hdr.method() == "POST"))
-    {
-        bool ok;
-        QVariant var = Json::parse(req.content, ok);
-        QVariantMap map = var.toMap();
-
-        if (map.isEmpty())
-        {
-            return searchNewSensors(req, rsp);
-        }
-        else
-        {
-            return createSensor(req, rsp);
-        }
-    }
-    // PUT, PATCH /api/<apikey>/sensors/<id>
-    else if ((req.path.size() == 4) && (req.hdr.method() == "PUT" || req.hdr.method() == "PATCH"))
-    {
-        return updateSensor(req, rsp);
-    }
-    // DELETE /api/<apikey>/sensors/<id>
-    else if ((req.path.size() == 4) && (req.hdr.method() == "DELETE"))
-    {
-        return deleteSensor(req, rsp);
-    }
-    // PUT, PATCH /api/<apikey>/sensors/<id>/config
-    else if ((req.path.size() == 5) && (req.hdr.method() == "PUT" || req.hdr.method() == "PATCH") && (req.path[4] == "config"))
-    {
-        return changeSensorConfig(req, rsp);
-    }
-    // PUT, PATCH /api/<apikey>/sensors/<id>/state
-    else if ((req.path.size() == 5) && (req.hdr.method() == "PUT" || req.hdr.method() == "PATCH") && (req.path[4] == "state"))
-    {
-        return changeSensorState(req, rsp);
-    }
-
-    return REQ_NOT_HANDLED;
+    // routes are defined in initRestRouter()
+    return restRouter.dispatch(req, rsp);
 }
 
 /*! GET /api/<apikey>/sensors
@@ -2398,6 +2342,7 @@ void DeRestPluginPrivate::startSearchSensors()
     {
         pollNodes.clear();
         bindingQueue.clear();
+        bindingQueueIndex.clear();
         sensors.reserve(sensors.size() + 10);
         searchSensorsCandidates.clear();
         searchSensorsResult.clear();
@@ -2476,7 +2421,7 @@ void DeRestPluginPrivate::checkSensorStateTimerFired()
 
         if (sensor->durationDue.isValid())
         {
-            QDateTime now = QDateTime::currentDateTime();
+            const QDateTime now = CachedClock::currentDateTime();
             if (sensor->durationDue <= now)
             {
                 // automatically set presence to false, if not triggered in config.duration
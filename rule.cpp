@@ -8,6 +8,7 @@
  *
  */
 
+#include <QHash>
 #include "rule.h"
 
 static int _ruleHandle = 1;
@@ -308,7 +309,13 @@ std::vector<RuleCondition> Rule::jsonToConditions(const QString &json)
 RuleAction::RuleAction() :
     m_address(""),
     m_method(""),
-    m_body("")
+    m_body(""),
+    m_command(CommandNone),
+    m_hasOn(false),
+    m_on(false),
+    m_toggle(false),
+    m_bri(-1),
+    m_transitionTime(-1)
 {
 }
 
@@ -319,6 +326,8 @@ RuleAction::RuleAction() :
 void RuleAction::setAddress(const QString &address)
 {
     m_address = address;
+    m_path = m_address.split(QLatin1Char('/'), QString::SkipEmptyParts);
+    compile();
 }
 
 /*! Returns the action address.
@@ -342,6 +351,7 @@ void RuleAction::setMethod(const QString &method)
         return;
     }
     m_method = method;
+    compile();
 }
 
 /*! Returns the action method.
@@ -359,6 +369,78 @@ void RuleAction::setBody(const QString &body)
 {
     QString str = body;
     m_body = str.replace( " ", "" );
+    compile();
+}
+
+/*! Decodes address, method and body into a typed command once.
+    Actions which can't be represented as Command keep CommandNone and
+    are dispatched through the REST handlers, which also report their errors.
+ */
+void RuleAction::compile()
+{
+    m_command = CommandNone;
+    m_targetId.clear();
+    m_hasOn = false;
+    m_on = false;
+    m_toggle = false;
+    m_bri = -1;
+    m_transitionTime = -1;
+
+    if (m_method != QLatin1String("PUT") || m_body.isEmpty() ||
+        m_path.size() != 3 || m_path[0] != QLatin1String("groups") || m_path[2] != QLatin1String("action"))
+    {
+        return;
+    }
+
+    bool ok;
+    const QVariantMap map = Json::parse(m_body, ok).toMap();
+
+    if (!ok || map.isEmpty())
+    {
+        return;
+    }
+
+    for (auto i = map.constBegin(); i != map.constEnd(); ++i)
+    {
+        if (i.key() == QLatin1String("on") && i.value().type() == QVariant::Bool)
+        {
+            m_hasOn = true;
+            m_on = i.value().toBool();
+        }
+        else if (i.key() == QLatin1String("toggle") && i.value().type() == QVariant::Bool)
+        {
+            m_toggle = i.value().toBool();
+        }
+        else if (i.key() == QLatin1String("bri") && i.value().type() == QVariant::Double)
+        {
+            const uint bri = i.value().toUInt(&ok);
+            if (!ok || bri > 255)
+            {
+                return;
+            }
+            m_bri = int(bri);
+        }
+        else if (i.key() == QLatin1String("transitiontime") && i.value().type() == QVariant::Double)
+        {
+            const uint tt = i.value().toUInt(&ok);
+            if (ok && tt < 0xFFFFUL)
+            {
+                m_transitionTime = int(tt);
+            }
+        }
+        else
+        {
+            return; // anything else is up to setGroupState()
+        }
+    }
+
+    if (!m_hasOn && !m_toggle && m_bri == -1)
+    {
+        return;
+    }
+
+    m_targetId = m_path[1];
+    m_command = CommandGroupAction;
 }
 
 bool RuleAction::operator==(const RuleAction &other) const
@@ -678,3 +760,47 @@ bool BindingTask::operator!=(const BindingTask &rhs) const
 {
     return !(*this == rhs);
 }
+
+/*! Returns the key of the BindingTask, equal keys imply equal tasks.
+ */
+BindingTaskKey BindingTask::key() const
+{
+    return key(binding, action);
+}
+
+/*! Returns the key of a BindingTask for \p binding and \p action.
+ */
+BindingTaskKey BindingTask::key(const Binding &binding, Action action)
+{
+    BindingTaskKey key;
+    key.srcAddress = binding.srcAddress;
+    key.dstAddress = binding.dstAddress.ext; // also covers group, the union is zero initialised
+    key.clusterId = binding.clusterId;
+    key.srcEndpoint = binding.srcEndpoint;
+    key.dstEndpoint = binding.dstEndpoint;
+    key.dstAddrMode = binding.dstAddrMode;
+    key.action = action;
+    return key;
+}
+
+/*! Returns true if two BindingTaskKeys are equal.
+ */
+bool BindingTaskKey::operator==(const BindingTaskKey &rhs) const
+{
+    return srcAddress == rhs.srcAddress &&
+           dstAddress == rhs.dstAddress &&
+           clusterId == rhs.clusterId &&
+           srcEndpoint == rhs.srcEndpoint &&
+           dstEndpoint == rhs.dstEndpoint &&
+           dstAddrMode == rhs.dstAddrMode &&
+           action == rhs.action;
+}
+
+/*! Hash function for BindingTaskKey to be used in QHash.
+ */
+uint qHash(const BindingTaskKey &key, uint seed)
+{
+    const quint64 ep = (quint64(key.clusterId) << 32) | (quint64(key.srcEndpoint) << 24) |
+                       (quint64(key.dstEndpoint) << 16) | (quint64(key.dstAddrMode) << 8) | key.action;
+    return qHash(key.srcAddress, seed) ^ qHash(key.dstAddress, seed + 1) ^ qHash(ep, seed + 2);
+}
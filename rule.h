@@ -13,6 +13,7 @@
 
 #include <stdint.h>
 #include <QString>
+#include <QStringList>
 #include <vector>
 #include <QDateTime>
 #include <deconz.h>
@@ -24,6 +25,22 @@ class RuleCondition;
 class RuleAction;
 class RestNodeBase;
 
+/*! Identifies a BindingTask in the binding queue. */
+struct BindingTaskKey
+{
+    quint64 srcAddress;
+    quint64 dstAddress;
+    quint16 clusterId;
+    quint8 srcEndpoint;
+    quint8 dstEndpoint;
+    quint8 dstAddrMode;
+    quint8 action;
+
+    bool operator==(const BindingTaskKey &rhs) const;
+};
+
+uint qHash(const BindingTaskKey &key, uint seed = 0);
+
 /*! Helper class to handle ZigBee binding/unbinding for Rules. */
 class BindingTask
 {
@@ -53,6 +70,7 @@ public:
         action(ActionBind),
         state(StateCheck),
         timeout(BindingTask::Timeout),
+        deadline(0),
         retries(BindingTask::Retries),
         restNode(0)
     {
@@ -60,12 +78,15 @@ public:
 
     bool operator==(const BindingTask &rhs) const;
     bool operator!=(const BindingTask &rhs) const;
+    BindingTaskKey key() const;
+    static BindingTaskKey key(const Binding &binding, Action action);
 
     Action action;
     State state;
 
     quint8 zdpSeqNum;
     int timeout; // seconds
+    qint64 deadline; // ms since plugin start when the current state times out
     int retries;
     RestNodeBase *restNode; // TODO refactor, this can become dangling pointer after each nodes, sensors .push_back()
 
@@ -144,6 +165,13 @@ private:
 class RuleAction
 {
 public:
+    /*! Typed form of an action which can be executed without the REST handlers. */
+    enum Command
+    {
+        CommandNone,       // dispatch through the REST handlers
+        CommandGroupAction // PUT /groups/<id>/action with on, toggle, bri and transitiontime only
+    };
+
     RuleAction();
 
     const QString &address() const;
@@ -154,10 +182,31 @@ public:
     void setBody(const QString &body);
     bool operator==(const RuleAction &other) const;
 
+    const QStringList &path() const { return m_path; }
+    Command command() const { return m_command; }
+    const QString &targetId() const { return m_targetId; }
+    bool hasOn() const { return m_hasOn; }
+    bool on() const { return m_on; }
+    bool toggle() const { return m_toggle; }
+    int bri() const { return m_bri; }
+    int transitionTime() const { return m_transitionTime; }
+
 private:
+    void compile();
+
     QString m_address;
     QString m_method;
     QString m_body;
+
+    // compiled from the above
+    QStringList m_path;
+    Command m_command;
+    QString m_targetId;
+    bool m_hasOn;
+    bool m_on;
+    bool m_toggle;
+    int m_bri; // -1 if not set
+    int m_transitionTime; // -1 if not set
 };
 
 
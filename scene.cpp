@@ -7,9 +7,35 @@
  * the LICENSE.txt file.
  *
  */
+#include <QDataStream>
 #include <QStringBuilder>
+#include "deconz/dbg_trace.h"
 #include "scene.h"
 
+/*! Prefix of base64 encoded binary light state records, the digit is the format version.
+    Such records were written by an intermediate version and are only read, the lights
+    column is written as JSON array which all plugin versions can parse.
+ */
+static const char *LightsDataPrefix = "#1:";
+static const quint8 LightsDataVersion = 1;
+
+/*! Color modes as stored in binary light state records. */
+enum LightsDataColorMode
+{
+    LightsDataColorModeNone = 0,
+    LightsDataColorModeXy = 1,
+    LightsDataColorModeHs = 2,
+    LightsDataColorModeCt = 3,
+    LightsDataColorModeOther = 0xFF // followed by the color mode string
+};
+
+/*! Light state record flags. */
+enum LightsDataFlags
+{
+    LightsDataFlagOn = 0x01,
+    LightsDataFlagColorloop = 0x02
+};
+
 /*! Constructor.
  */
 Scene::Scene() :
@@ -40,6 +66,7 @@ void Scene::setTransitiontime(const uint16_t &transitiontime)
  */
 std::vector<LightState> &Scene::lights()
 {
+    decodeLights();
     return m_lights;
 }
 
@@ -47,6 +74,7 @@ std::vector<LightState> &Scene::lights()
  */
 const std::vector<LightState> &Scene::lights() const
 {
+    decodeLights();
     return m_lights;
 }
 
@@ -55,14 +83,52 @@ const std::vector<LightState> &Scene::lights() const
  */
 void Scene::setLights(const std::vector<LightState> &lights)
 {
+    m_lightsData.clear();
     m_lights = lights;
 }
 
+/*! Sets the encoded lights of the scene as stored in the database.
+    Decoding is deferred until the lights are accessed the first time.
+    \param data the lights column of the scenes table
+ */
+void Scene::setLightsData(const QString &data)
+{
+    m_lights.clear();
+    m_lightsData = data;
+}
+
+/*! Returns the lights of the scene encoded for the database.
+    Undecoded JSON records are returned as is.
+ */
+QString Scene::lightsData() const
+{
+    if (!m_lightsData.isEmpty() && m_lightsData.startsWith(QLatin1Char('[')))
+    {
+        return m_lightsData;
+    }
+
+    return lightsToString(lights());
+}
+
+/*! Decodes pending lights data from the database.
+ */
+void Scene::decodeLights() const
+{
+    if (m_lightsData.isEmpty())
+    {
+        return;
+    }
+
+    m_lights = dbStringToLights(m_lightsData);
+    m_lightsData.clear();
+}
+
 /*! Adds a light to the lights of the scene.
     \param light the light that should be added
  */
 void Scene::addLightState(const LightState &light)
 {
+    decodeLights();
     m_lights.push_back(light);
 }
 
@@ -72,6 +138,7 @@ void Scene::addLightState(const LightState &light)
  */
 bool Scene::deleteLight(const QString &lid)
 {
+    decodeLights();
     std::vector<LightState>::const_iterator l = m_lights.begin();
     std::vector<LightState>::const_iterator lend = m_lights.end();
     int position = 0;
@@ -98,6 +165,7 @@ bool Scene::deleteLight(const QString &lid)
  */
 LightState *Scene::getLightState(const QString &lid)
 {
+    decodeLights();
     std::vector<LightState>::iterator i = m_lights.begin();
     std::vector<LightState>::iterator end = m_lights.end();
 
@@ -232,6 +300,132 @@ std::vector<LightState> Scene::jsonToLights(const QString &json)
     return lights;
 }
 
+/*! Decodes lights of a scene as stored in the database.
+    Handles JSON records as well as binary records of the intermediate format.
+    \param data the lights column of the scenes table
+ */
+std::vector<LightState> Scene::dbStringToLights(const QString &data)
+{
+    std::vector<LightState> lights;
+
+    if (data.startsWith(QLatin1Char('[')))
+    {
+        return jsonToLights(data);
+    }
+
+    if (!data.startsWith(QLatin1String(LightsDataPrefix)))
+    {
+        DBG_Printf(DBG_ERROR, "unknown scene lights format\n");
+        return lights;
+    }
+
+    const QByteArray bin = QByteArray::fromBase64(data.midRef(QLatin1String(LightsDataPrefix).size()).toLatin1());
+    QDataStream stream(bin);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    quint8 version = 0;
+    quint16 count = 0;
+    stream >> version;
+    stream >> count;
+
+    if (stream.status() != QDataStream::Ok || version != LightsDataVersion)
+    {
+        DBG_Printf(DBG_ERROR, "unsupported scene lights record version %u\n", version);
+        return lights;
+    }
+
+    lights.reserve(count);
+
+    for (quint16 n = 0; n < count && stream.status() == QDataStream::Ok; n++)
+    {
+        LightState state;
+        quint8 len;
+        quint8 flags;
+        quint8 bri;
+        quint16 tt;
+        quint8 cm;
+        char buf[256];
+
+        stream >> len;
+        if (stream.readRawData(buf, len) != len)
+        {
+            break;
+        }
+        state.setLightId(QString::fromUtf8(buf, len));
+
+        stream >> flags;
+        stream >> bri;
+        stream >> tt;
+        stream >> cm;
+
+        state.setOn(flags & LightsDataFlagOn);
+        state.setColorloopActive(flags & LightsDataFlagColorloop);
+        state.setBri(bri);
+        state.setTransitionTime(tt);
+
+        switch (cm)
+        {
+        case LightsDataColorModeNone: state.setColorMode(QLatin1String("none")); break;
+        case LightsDataColorModeXy:   state.setColorMode(QLatin1String("xy")); break;
+        case LightsDataColorModeHs:   state.setColorMode(QLatin1String("hs")); break;
+        case LightsDataColorModeCt:   state.setColorMode(QLatin1String("ct")); break;
+        default:
+        {
+            stream >> len;
+            if (stream.readRawData(buf, len) != len)
+            {
+                break;
+            }
+            state.setColorMode(QString::fromUtf8(buf, len));
+        }
+            break;
+        }
+
+        if (cm != LightsDataColorModeNone)
+        {
+            quint16 x;
+            quint16 y;
+            quint8 clTime;
+            stream >> x;
+            stream >> y;
+            stream >> clTime;
+            state.setX(x);
+            state.setY(y);
+            state.setColorloopTime(clTime);
+
+            if (cm == LightsDataColorModeHs)
+            {
+                quint16 ehue;
+                quint8 sat;
+                stream >> ehue;
+                stream >> sat;
+                state.setEnhancedHue(ehue);
+                state.setSaturation(sat);
+            }
+            else if (cm == LightsDataColorModeCt)
+            {
+                quint16 ct;
+                stream >> ct;
+                state.setColorTemperature(ct);
+            }
+        }
+
+        if (stream.status() != QDataStream::Ok)
+        {
+            break;
+        }
+
+        lights.push_back(state);
+    }
+
+    if (lights.size() != count)
+    {
+        DBG_Printf(DBG_ERROR, "truncated scene lights record, %d of %u lights\n", int(lights.size()), count);
+    }
+
+    return lights;
+}
+
 
 // LightState
 
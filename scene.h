@@ -50,12 +50,19 @@ public:
     bool deleteLight(const QString &lid);
     LightState *getLightState(const QString &lid);
 
+    void setLightsData(const QString &data);
+    QString lightsData() const;
+
     static QString lightsToString(const std::vector<LightState> &lights);
     static std::vector<LightState> jsonToLights(const QString &json);
+    static std::vector<LightState> dbStringToLights(const QString &data);
 
 private:
+    void decodeLights() const;
+
     uint16_t m_transitiontime;
-    std::vector<LightState> m_lights;
+    mutable std::vector<LightState> m_lights;
+    mutable QString m_lightsData; // encoded lights from the database, decoded on first access
 };
 
 
@@ -629,6 +629,9 @@ Sensor::Sensor() :
     m_mode(ModeTwoGroups),
     m_resetRetryCount(0),
     m_buttonMap(nullptr),
+    m_buttonMapIndex(nullptr),
+    m_buttonHandling(ButtonHandlingGeneric),
+    m_buttonFlags(0),
     m_rxCounter(0)
 {
     QDateTime now = QDateTime::currentDateTime();
@@ -737,6 +740,7 @@ const QString &Sensor::modelId() const
 void Sensor::setModelId(const QString &mid)
 {
     item(RAttrModelId)->setValue(mid.trimmed());
+    m_buttonMap = nullptr; // resolve again
 }
 
 /*! Returns the resetRetryCount.
@@ -1036,7 +1040,83 @@ const Sensor::ButtonMap *Sensor::buttonMap()
         {
             if      (modelid.startsWith(QLatin1String("ICZB-KPD1"))) { m_buttonMap = icasaKeypadMap; }
         }
+
+        if (m_buttonMap)
+        {
+            resolveButtonHandling(modelid, manufacturer);
+        }
     }
 
     return m_buttonMap;
 }
+
+/*! Returns the key of a button map entry in a ButtonMapIndex.
+ */
+static quint64 buttonMapKey(Sensor::SensorMode mode, quint8 endpoint, quint16 clusterId, quint8 zclCommandId)
+{
+    return (quint64(mode) << 32) | (quint64(endpoint) << 24) | (quint64(clusterId) << 8) | zclCommandId;
+}
+
+/*! Precomputes the model specific handling and the button map index.
+    Indexes are built once per button map and shared by all sensors using it.
+ */
+void Sensor::resolveButtonHandling(const QString &modelid, const QString &manufacturer)
+{
+    static QHash<const ButtonMap*, ButtonMapIndex> indexes;
+
+    auto idx = indexes.find(m_buttonMap);
+    if (idx == indexes.end())
+    {
+        idx = indexes.insert(m_buttonMap, ButtonMapIndex());
+        for (const ButtonMap *b = m_buttonMap; b->mode != ModeNone; b++)
+        {
+            (*idx)[buttonMapKey(b->mode, b->endpoint, b->clusterId, b->zclCommandId)].push_back(b);
+        }
+    }
+    m_buttonMapIndex = &idx.value();
+
+    // keep in sync with DeRestPluginPrivate::checkSensorButtonEvent()
+    if      (modelid == QLatin1String("Lighting Switch"))        { m_buttonHandling = ButtonHandlingDeLightingSwitch; }
+    else if (modelid == QLatin1String("RM01") ||
+             modelid == QLatin1String("RB01"))                   { m_buttonHandling = ButtonHandlingBuschJaeger; }
+    else if (modelid == QLatin1String("TRADFRI remote control")) { m_buttonHandling = ButtonHandlingIkeaRemote; }
+    else if (modelid == QLatin1String("TRADFRI wireless dimmer")) { m_buttonHandling = ButtonHandlingIkeaDimmer; }
+    else if (modelid == QLatin1String("TRADFRI on/off switch"))  { m_buttonHandling = ButtonHandlingIkeaOnOff; }
+    else if (modelid == QLatin1String("TRADFRI motion sensor"))  { m_buttonHandling = ButtonHandlingIkeaMotion; }
+    else if (modelid.startsWith(QLatin1String("RWL02")))         { m_buttonHandling = ButtonHandlingHueDimmer; }
+    else                                                         { m_buttonHandling = ButtonHandlingGeneric; }
+
+    m_buttonFlags = 0;
+    if (manufacturer == QLatin1String("LUMI"))               { m_buttonFlags |= ButtonFlagLumi; }
+    if (modelid == QLatin1String("lumi.sensor_switch"))      { m_buttonFlags |= ButtonFlagLumiSwitch; }
+    if (modelid.startsWith(QLatin1String("TRADFRI")))        { m_buttonFlags |= ButtonFlagTradfri; }
+    if (manufacturer == QLatin1String("ubisys"))             { m_buttonFlags |= ButtonFlagUbisys; }
+}
+
+/*! Returns the model specific button handling.
+ */
+Sensor::ButtonHandling Sensor::buttonHandling()
+{
+    return buttonMap() ? m_buttonHandling : ButtonHandlingGeneric;
+}
+
+/*! Returns Sensor::ButtonFlags of the model.
+ */
+int Sensor::buttonFlags()
+{
+    return buttonMap() ? m_buttonFlags : 0;
+}
+
+/*! Returns the button map entries matching the current mode and a ZCL command in map order.
+    \return the entries or nullptr if none match
+ */
+const std::vector<const Sensor::ButtonMap*> *Sensor::buttonMapEntries(quint8 endpoint, quint16 clusterId, quint8 zclCommandId)
+{
+    if (!buttonMap() || !m_buttonMapIndex)
+    {
+        return nullptr;
+    }
+
+    const auto i = m_buttonMapIndex->constFind(buttonMapKey(m_mode, endpoint, clusterId, zclCommandId));
+    return i != m_buttonMapIndex->constEnd() ? &i.value() : nullptr;
+}
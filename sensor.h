@@ -11,7 +11,9 @@
 #ifndef SENSOR_H
 #define SENSOR_H
 
+#include <QHash>
 #include <QString>
+#include <vector>
 #include <deconz.h>
 #include "resource.h"
 #include "rest_node_base.h"
@@ -99,6 +101,30 @@ public:
         const char *name;
     };
 
+    /*! Model specific handling of button events, resolved together with the button map. */
+    enum ButtonHandling
+    {
+        ButtonHandlingGeneric,
+        ButtonHandlingDeLightingSwitch,
+        ButtonHandlingBuschJaeger,
+        ButtonHandlingIkeaRemote,
+        ButtonHandlingIkeaDimmer,
+        ButtonHandlingIkeaOnOff,
+        ButtonHandlingIkeaMotion,
+        ButtonHandlingHueDimmer
+    };
+
+    enum ButtonFlags
+    {
+        ButtonFlagLumi = 0x01,       // manufacturer LUMI
+        ButtonFlagLumiSwitch = 0x02, // lumi.sensor_switch
+        ButtonFlagTradfri = 0x04,    // modelid TRADFRI*
+        ButtonFlagUbisys = 0x08      // manufacturer ubisys
+    };
+
+    /*! Button map entries by mode, endpoint, cluster and command in map order. */
+    typedef QHash<quint64, std::vector<const ButtonMap*> > ButtonMapIndex;
+
     Sensor();
 
     DeletedState deletedState() const;
@@ -134,17 +160,25 @@ public:
 
     QString etag;
     const ButtonMap *buttonMap();
+    ButtonHandling buttonHandling();
+    int buttonFlags();
+    const std::vector<const ButtonMap*> *buttonMapEntries(quint8 endpoint, quint16 clusterId, quint8 zclCommandId);
     uint8_t previousDirection;
     QDateTime lastConfigPush;
     QDateTime durationDue;
 
 private:
+    void resolveButtonHandling(const QString &modelid, const QString &manufacturer);
+
     DeletedState m_deletedstate;
     SensorFingerprint m_fingerPrint;
     SensorMode m_mode;
     uint8_t m_resetRetryCount;
     uint8_t m_zdpResetSeq;
     const ButtonMap *m_buttonMap;
+    const ButtonMapIndex *m_buttonMapIndex;
+    ButtonHandling m_buttonHandling;
+    int m_buttonFlags;
     int m_rxCounter;
 };
 
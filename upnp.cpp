@@ -18,11 +18,26 @@
 #include "de_web_plugin_private.h"
 #include "gateway_scanner.h"
 
+#define UPNP_MAX_RESPONSES  20  // M-SEARCH responses per second
+#define UPNP_MAX_PENDING    32
+#define UPNP_MAX_JITTER     500 // ms
+
+#define UPNP_TARGET_ROOT  0x01
+#define UPNP_TARGET_UUID  0x02
+#define UPNP_TARGET_BASIC 0x04
+
 /*! Inits the UPnP discorvery. */
 void DeRestPluginPrivate::initUpnpDiscovery()
 {
     DBG_Assert(udpSock == 0);
 
+    upnpResponseWindow = 0;
+    upnpResponseCount = 0;
+    upnpResponseTimer = new QTimer(this);
+    upnpResponseTimer->setSingleShot(true);
+    connect(upnpResponseTimer, SIGNAL(timeout()),
+            this, SLOT(upnpResponseTimerFired()));
+
     initDescriptionXml();
 
     if (deCONZ::appArgumentNumeric("--upnp", 1) == 0)
@@ -45,7 +60,9 @@ void DeRestPluginPrivate::initUpnpDiscovery()
     upnpTimer->start(1000); // setup phase fast interval
 }
 
-/*! Replaces description_in.xml template with dynamic content. */
+/*! Replaces description_in.xml template with dynamic content.
+    The HTTP response and the SSDP packets are prepared here, since they change only with the same parameters.
+ */
 void DeRestPluginPrivate::initDescriptionXml()
 {
     deCONZ::ApsController *apsCtrl = deCONZ::ApsController::instance();
@@ -75,6 +92,72 @@ void DeRestPluginPrivate::initDescriptionXml()
              } while (!line.isEmpty());
         }
     }
+
+    descriptionXmlResponse.clear();
+    if (!descriptionXml.isEmpty())
+    {
+        descriptionXmlResponse.append("HTTP/1.1 ").append(HttpStatusOk).append("\r\n");
+        descriptionXmlResponse.append("Content-Type: application/xml\r\n");
+        descriptionXmlResponse.append("Content-Length:").append(QByteArray::number(descriptionXml.size())).append("\r\n");
+        descriptionXmlResponse.append("Connection: close\r\n");
+        descriptionXmlResponse.append("\r\n");
+        descriptionXmlResponse.append(descriptionXml);
+    }
+
+    initUpnpPackets();
+}
+
+/*! Builds the SSDP NOTIFY packets and M-SEARCH responses.
+    Index 0, 1, 2 correspond to UPNP_TARGET_ROOT, UPNP_TARGET_UUID and UPNP_TARGET_BASIC.
+ */
+void DeRestPluginPrivate::initUpnpPackets()
+{
+    const QString uuid = gwConfig["uuid"].toString();
+
+    const QByteArray notify = QString(QLatin1String(
+        "NOTIFY * HTTP/1.1\r\n"
+        "HOST: 239.255.255.250:1900\r\n"
+        "CACHE-CONTROL: max-age=100\r\n"
+        "LOCATION: http://%1:%2/description.xml\r\n"
+        "SERVER: Linux/3.14.0 UPnP/1.0 IpBridge/1.26.0\r\n"
+        "GWID.phoscon.de: %3\r\n"
+        "hue-bridgeid: %3\r\n"
+        "NTS: ssdp:alive\r\n"))
+            .arg(gwConfig["ipaddress"].toString())
+            .arg(gwConfig["port"].toDouble())
+            .arg(gwBridgeId.toUpper()).toLocal8Bit();
+
+    const QByteArray response = QString(QLatin1String(
+        "HTTP/1.1 200 OK\r\n"
+        "CACHE-CONTROL: max-age=100\r\n"
+        "EXT:\r\n"
+        "LOCATION: http://%1:%2/description.xml\r\n"
+        "SERVER: Linux/3.14.0 UPnP/1.0 IpBridge/1.26.0\r\n"
+        "GWID.phoscon.de: %3\r\n"
+        "hue-bridgeid: %3\r\n"))
+            .arg(gwConfig["ipaddress"].toString())
+            .arg(gwConfig["port"].toDouble())
+            .arg(gwBridgeId.toUpper()).toLocal8Bit();
+
+    const QByteArray types[3] = {
+        QByteArray("upnp:rootdevice"),
+        QString(QLatin1String("uuid:%1")).arg(uuid).toLocal8Bit(),
+        QByteArray("urn:schemas-upnp-org:device:basic:1")
+    };
+
+    const QByteArray usns[3] = {
+        QString(QLatin1String("uuid:%1::upnp:rootdevice")).arg(uuid).toLocal8Bit(),
+        QString(QLatin1String("uuid:%1")).arg(uuid).toLocal8Bit(),
+        QString(QLatin1String("uuid:%1::urn:schemas-upnp-org:device:basic:1")).arg(uuid).toLocal8Bit()
+    };
+
+    for (int i = 0; i < 3; i++)
+    {
+        upnpNotify[i] = notify + "NT: " + types[i] + "\r\nUSN: " + usns[i] + "\r\n\r\n";
+        upnpSearchResponse[i] = response + "ST: " + types[i] + "\r\nUSN: " + usns[i] + "\r\n\r\n";
+    }
+
+    upnpSearchTargetUuid = QString(QLatin1String("ST: uuid:%1")).arg(uuid);
 }
 
 /*! Sends SSDP broadcast for announcement. */
@@ -106,43 +189,15 @@ void DeRestPluginPrivate::announceUpnp()
     if (upnpTimer->interval() != (20 * 1000))
         upnpTimer->start(20 * 1000);
 
-    QByteArray datagram = QString(QLatin1String(
-        "NOTIFY * HTTP/1.1\r\n"
-        "HOST: 239.255.255.250:1900\r\n"
-        "CACHE-CONTROL: max-age=100\r\n"
-        "LOCATION: http://%1:%2/description.xml\r\n"
-        "SERVER: Linux/3.14.0 UPnP/1.0 IpBridge/1.26.0\r\n"
-        "GWID.phoscon.de: %3\r\n"
-        "hue-bridgeid: %3\r\n"
-        "NTS: ssdp:alive\r\n"))
-            .arg(gwConfig["ipaddress"].toString())
-            .arg(gwConfig["port"].toDouble())
-            .arg(gwBridgeId.toUpper()).toLocal8Bit();
-    QByteArray nt1 = QString(QLatin1String(
-        "NT: upnp:rootdevice\r\n"
-        "USN: uuid:%1::upnp:rootdevice\r\n")).arg(gwConfig["uuid"].toString()).toLocal8Bit();
-    QByteArray nt2 = QString(QLatin1String(
-        "NT: uuid:%1\r\n"
-        "USN: uuid:%1\r\n")).arg(gwConfig["uuid"].toString()).toLocal8Bit();
-    QByteArray nt3 = QString(QLatin1String(
-        "NT: urn:schemas-upnp-org:device:basic:1\r\n"
-        "USN: uuid:%1::urn:schemas-upnp-org:device:basic:1\r\n")).arg(gwConfig["uuid"].toString()).toLocal8Bit();
-
     quint16 port = 1900;
-    QHostAddress host;
-    host.setAddress(QLatin1String("239.255.255.250"));
+    const QHostAddress host(QLatin1String("239.255.255.250"));
 
-    if (udpSock->writeDatagram(datagram + nt1 + "\r\n", host, port) == -1)
+    for (const QByteArray &datagram : upnpNotify)
     {
-        DBG_Printf(DBG_ERROR, "UDP send error %s\n", qPrintable(udpSock->errorString()));
-    }
-    if (udpSock->writeDatagram(datagram + nt2 + "\r\n", host, port) == -1)
-    {
-        DBG_Printf(DBG_ERROR, "UDP send error %s\n", qPrintable(udpSock->errorString()));
-    }
-    if (udpSock->writeDatagram(datagram + nt3 + "\r\n", host, port) == -1)
-    {
-        DBG_Printf(DBG_ERROR, "UDP send error %s\n", qPrintable(udpSock->errorString()));
+        if (udpSock->writeDatagram(datagram, host, port) == -1)
+        {
+            DBG_Printf(DBG_ERROR, "UDP send error %s\n", qPrintable(udpSock->errorString()));
+        }
     }
 }
 
@@ -170,137 +225,175 @@ void DeRestPluginPrivate::upnpReadyRead()
 
         if (datagram.startsWith("M-SEARCH *"))
         {
+            int mx = 1;
+
             while (!stream.atEnd())
             {
                 QString line = stream.readLine();
-                if (line.startsWith(QLatin1String("ST:")))
+                if (line.startsWith(QLatin1String("ST:")) && st == SearchTargetOther)
                 {
                     if (line.contains(QLatin1String("ssdp:all")))
                     {
                         st = SearchTargetAll;
-                        break;
                     }
                     else if (line.contains(QLatin1String("upnp:rootdevice")))
                     {
                         st = SearchTargetRoot;
-                        break;
                     }
-                    else if (line.contains(QString(QLatin1String("ST: uuid:%1")).arg(gwConfig["uuid"].toString())))
+                    else if (line.contains(upnpSearchTargetUuid))
                     {
                         st = SearchTargetUUID;
-                        break;
                     }
                     else if (line.contains(QLatin1String("urn:schemas-upnp-org:device:basic:1")))
                     {
                         st = SearchTargetBasic;
-                        break;
                     }
                 }
+                else if (line.startsWith(QLatin1String("MX:"), Qt::CaseInsensitive))
+                {
+                    mx = line.mid(3).trimmed().toInt();
+                }
             }
 
             if (st != SearchTargetOther)
             {
-                QByteArray response = QString(QLatin1String(
-                    "HTTP/1.1 200 OK\r\n"
-                    "CACHE-CONTROL: max-age=100\r\n"
-                    "EXT:\r\n"
-                    "LOCATION: http://%1:%2/description.xml\r\n"
-                    "SERVER: Linux/3.14.0 UPnP/1.0 IpBridge/1.26.0\r\n"
-                    "GWID.phoscon.de: %3\r\n"
-                    "hue-bridgeid: %3\r\n"))
-                        .arg(gwConfig["ipaddress"].toString())
-                        .arg(gwConfig["port"].toDouble())
-                        .arg(gwBridgeId.toUpper()).toLocal8Bit();
-                QByteArray st1 = QString(QLatin1String(
-                    "ST: upnp:rootdevice\r\n"
-                    "USN: uuid:%1::upnp:rootdevice\r\n")).arg(gwConfig["uuid"].toString()).toLocal8Bit();
-                QByteArray st2 = QString(QLatin1String(
-                    "ST: uuid:%1\r\n"
-                    "USN: uuid:%1\r\n")).arg(gwConfig["uuid"].toString()).toLocal8Bit();
-                QByteArray st3 = QString(QLatin1String(
-                    "ST: urn:schemas-upnp-org:device:basic:1\r\n"
-                    "USN: uuid:%1::urn:schemas-upnp-org:device:basic:1\r\n")).arg(gwConfig["uuid"].toString()).toLocal8Bit();
-
-                datagram.clear();
-                if (st == SearchTargetAll || st == SearchTargetRoot)
+                quint8 targets = 0;
+                if (st == SearchTargetAll || st == SearchTargetRoot)  { targets |= UPNP_TARGET_ROOT; }
+                if (st == SearchTargetAll || st == SearchTargetUUID)  { targets |= UPNP_TARGET_UUID; }
+                if (st == SearchTargetAll || st == SearchTargetBasic) { targets |= UPNP_TARGET_BASIC; }
+                queueUpnpResponse(host, port, targets, mx);
+            }
+        }
+        else if (datagram.startsWith("NOTIFY *"))
+        {
+            while (!stream.atEnd())
+            {
+                QString line = stream.readLine();
+                if (line.startsWith(QLatin1String("LOCATION:")))
                 {
-                    datagram.append(response);
-                    datagram.append(st1);
-                    datagram.append("\r\n");
-                    if (udpSock->writeDatagram(datagram.data(), datagram.size(), host, port) == -1)
-                    {
-                        DBG_Printf(DBG_ERROR, "UDP send error %s\n", qPrintable(udpSock->errorString()));
-                    }
-                    datagram.clear();
+                    location = line;
                 }
-                if (st == SearchTargetAll || st == SearchTargetUUID)
+                else if (line.startsWith(QLatin1String("GWID.phoscon.de")))
                 {
-                    datagram.append(response);
-                    datagram.append(st2);
-                    datagram.append("\r\n");
-                    if (udpSock->writeDatagram(datagram.data(), datagram.size(), host, port) == -1)
-                    {
-                        DBG_Printf(DBG_ERROR, "UDP send error %s\n", qPrintable(udpSock->errorString()));
-                    }
-                    datagram.clear();
+                    gwid = line;
+                    break;
                 }
-                if (st == SearchTargetAll || st == SearchTargetBasic)
+                else if (line.startsWith(QLatin1String("hue-bridgeid")))
                 {
-                    datagram.append(response);
-                    datagram.append(st3);
-                    datagram.append("\r\n");
-                    if (udpSock->writeDatagram(datagram.data(), datagram.size(), host, port) == -1)
-                    {
-                        DBG_Printf(DBG_ERROR, "UDP send error %s\n", qPrintable(udpSock->errorString()));
-                    }
-                    datagram.clear();
+                    gwid = line;
+                    break;
                 }
             }
-            else if (datagram.startsWith("NOTIFY *") && !location.isEmpty())
+
+            // phoscon gateway or hue bridge
+            QStringList ls = gwid.split(' ');
+            if (ls.size() != 2)
             {
-                while (!stream.atEnd())
-                {
-                    QString line = stream.readLine();
-                    if (line.startsWith(QLatin1String("LOCATION:")))
-                    {
-                        location = line;
-                    }
-                    else if (line.startsWith(QLatin1String("GWID.phoscon.de")))
-                    {
-                        gwid = line;
-                        break;
-                    }
-                    else if (line.startsWith(QLatin1String("hue-bridgeid")))
-                    {
-                        gwid = line;
-                        break;
-                    }
-                }
+                continue;
+            }
 
-                // phoscon gateway or hue bridge
-                QStringList ls = gwid.split(' ');
-                if (ls.size() != 2)
-                {
-                    continue;
-                }
+            if (ls[1] == gwBridgeId)
+            {
+                continue; // self
+            }
 
-                if (ls[1] == gwBridgeId)
-                {
-                    continue; // self
-                }
+            ls = location.split(' ');
+            if (ls.size() != 2 || !ls[1].startsWith(QLatin1String("http://")))
+            {
+                continue;
+            }
 
-                ls = location.split(' ');
-                if (ls.size() != 2 || !ls[1].startsWith(QLatin1String("http://")))
-                {
-                    continue;
-                }
+            // http://192.168.14.103:80/description.xml
 
-                // http://192.168.14.103:80/description.xml
+            QUrl url(ls[1]);
+            location = QString("http://%1:%2/api/config").arg(url.host()).arg(url.port(80));
+            gwScanner->queryGateway(location);
+        }
+    }
+}
+
+/*! Queues the response to an M-SEARCH request.
+    The response is delayed by a random time within the MX window of the client (at most UPNP_MAX_JITTER),
+    repeated searches of a client are merged and at most UPNP_MAX_RESPONSES are answered per second.
+    \param targets - UPNP_TARGET_* bitmap
+    \param mx - MX header value in seconds
+ */
+void DeRestPluginPrivate::queueUpnpResponse(const QHostAddress &host, quint16 port, quint8 targets, int mx)
+{
+    const qint64 now = starttimeRef.elapsed();
 
-                QUrl url(ls[1]);
-                location = QString("http://%1:%2/api/config").arg(url.host()).arg(url.port(80));
-                gwScanner->queryGateway(location);
+    for (UpnpPendingResponse &pending : upnpPendingResponses)
+    {
+        if (pending.port == port && pending.host == host)
+        {
+            pending.targets |= targets;
+            metrics.increment(QLatin1String("upnp_msearch_total{result=\"merged\"}"));
+            return;
+        }
+    }
+
+    if (now - upnpResponseWindow >= 1000)
+    {
+        upnpResponseWindow = now;
+        upnpResponseCount = 0;
+    }
+
+    if (upnpResponseCount >= UPNP_MAX_RESPONSES || upnpPendingResponses.size() >= size_t(UPNP_MAX_PENDING))
+    {
+        metrics.increment(QLatin1String("upnp_msearch_total{result=\"dropped\"}"));
+        return;
+    }
+
+    upnpResponseCount++;
+
+    UpnpPendingResponse pending;
+    pending.host = host;
+    pending.port = port;
+    pending.targets = targets;
+    pending.due = now + qrand() % qMin(qBound(1, mx, 5) * 1000, UPNP_MAX_JITTER);
+    upnpPendingResponses.push_back(pending);
+    metrics.increment(QLatin1String("upnp_msearch_total{result=\"queued\"}"));
+
+    const int wait = int(pending.due - now);
+    if (!upnpResponseTimer->isActive() || upnpResponseTimer->remainingTime() > wait)
+    {
+        upnpResponseTimer->start(wait);
+    }
+}
+
+/*! Sends the due M-SEARCH responses and waits for the next one.
+ */
+void DeRestPluginPrivate::upnpResponseTimerFired()
+{
+    const qint64 now = starttimeRef.elapsed();
+    qint64 next = -1;
+
+    for (auto i = upnpPendingResponses.begin(); i != upnpPendingResponses.end(); )
+    {
+        if (i->due > now)
+        {
+            if (next == -1 || i->due < next)
+            {
+                next = i->due;
+            }
+            ++i;
+            continue;
+        }
+
+        for (int t = 0; t < 3; t++)
+        {
+            if ((i->targets & (1 << t)) &&
+                udpSock->writeDatagram(upnpSearchResponse[t], i->host, i->port) == -1)
+            {
+                DBG_Printf(DBG_ERROR, "UDP send error %s\n", qPrintable(udpSock->errorString()));
             }
         }
+
+        i = upnpPendingResponses.erase(i);
+    }
+
+    if (next != -1)
+    {
+        upnpResponseTimer->start(int(next - now));
     }
 }
@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2020 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <QBuffer>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QTimer>
+#include <deconz.h>
+#include "metrics.h"
+#include "webhook_dispatcher.h"
+
+/*! Constructor.
+ */
+WebhookDispatcher::WebhookDispatcher(QObject *parent) :
+    QObject(parent),
+    m_metrics(nullptr),
+    m_batchWindow(0)
+{
+    m_manager = new QNetworkAccessManager(this);
+    connect(m_manager, SIGNAL(finished(QNetworkReply*)),
+            this, SLOT(requestFinished(QNetworkReply*)));
+
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(processQueue()));
+
+    m_time.start();
+}
+
+/*! Queues a webhook request.
+    \param contentType - Content-Type header, only application/json bodies are batched
+    \return false if the queue is full
+ */
+bool WebhookDispatcher::enqueue(const QUrl &url, const QByteArray &method, const QByteArray &body, const QByteArray &contentType)
+{
+    const qint64 now = m_time.elapsed();
+    const bool json = (contentType == "application/json");
+
+    if (m_batchWindow > 0 && json)
+    {
+        for (Job &job : m_queue)
+        {
+            if (job.retries == 0 && job.notBefore > now && job.url == url && job.method == method && job.contentType == contentType)
+            {
+                job.bodies.push_back(body);
+                if (m_metrics)
+                {
+                    m_metrics->increment(QLatin1String("webhook_batched_total"));
+                }
+                return true;
+            }
+        }
+    }
+
+    if (m_queue.size() >= MaxQueueSize)
+    {
+        DBG_Printf(DBG_INFO, "Webhook queue full, drop request to %s\n", qPrintable(url.toString()));
+        if (m_metrics)
+        {
+            m_metrics->increment(QLatin1String("webhook_dropped_total"));
+        }
+        return false;
+    }
+
+    Job job;
+    job.url = url;
+    job.method = method;
+    job.contentType = contentType;
+    job.bodies.push_back(body);
+    job.retries = 0;
+    job.notBefore = json ? now + m_batchWindow : now;
+    job.sendTime = 0;
+    m_queue.push_back(job);
+
+    processQueue();
+    return true;
+}
+
+/*! Sends due requests within the in-flight limits and schedules the next check.
+ */
+void WebhookDispatcher::processQueue()
+{
+    const qint64 now = m_time.elapsed();
+    qint64 next = -1;
+
+    for (auto i = m_queue.begin(); i != m_queue.end() && m_inFlight.size() < MaxInFlight; )
+    {
+        if (i->notBefore > now)
+        {
+            if (next == -1 || i->notBefore < next)
+            {
+                next = i->notBefore;
+            }
+            ++i;
+            continue;
+        }
+
+        if (m_inFlightPerHost.value(i->url.host()) >= MaxInFlightPerHost)
+        {
+            ++i; // wait for a reply from this host
+            continue;
+        }
+
+        Job job = *i;
+        i = m_queue.erase(i);
+        send(job);
+    }
+
+    if (next != -1 && m_inFlight.size() < MaxInFlight)
+    {
+        m_timer->start(int(qMax(qint64(0), next - now)));
+    }
+
+    updateGauges();
+}
+
+/*! Starts the request of a job, batched bodies are sent as JSON array.
+ */
+void WebhookDispatcher::send(Job &job)
+{
+    QByteArray body;
+
+    if (job.bodies.size() == 1)
+    {
+        body = job.bodies.front();
+    }
+    else
+    {
+        body.append('[');
+        for (size_t i = 0; i < job.bodies.size(); i++)
+        {
+            if (i > 0)
+            {
+                body.append(',');
+            }
+            body.append(job.bodies[i]);
+        }
+        body.append(']');
+    }
+
+    QNetworkRequest req(job.url);
+    req.setRawHeader("Connection", "keep-alive");
+    if (!job.contentType.isEmpty())
+    {
+        req.setHeader(QNetworkRequest::ContentTypeHeader, job.contentType);
+    }
+
+    QBuffer *data = new QBuffer;
+    data->setData(body);
+
+    QNetworkReply *reply = m_manager->sendCustomRequest(req, job.method, data);
+    DBG_Assert(reply);
+    if (!reply)
+    {
+        delete data;
+        return;
+    }
+
+    data->setParent(reply); // released together with the reply
+    job.sendTime = m_time.elapsed();
+    m_inFlight.insert(reply, job);
+    m_inFlightPerHost[job.url.host()]++;
+}
+
+/*! Handler for finished webhooks, retries failed requests with backoff.
+ */
+void WebhookDispatcher::requestFinished(QNetworkReply *reply)
+{
+    if (!reply)
+    {
+        return;
+    }
+
+    reply->deleteLater();
+
+    auto i = m_inFlight.find(reply);
+    if (i == m_inFlight.end())
+    {
+        return;
+    }
+
+    Job job = i.value();
+    m_inFlight.erase(i);
+
+    int &hostCount = m_inFlightPerHost[job.url.host()];
+    hostCount--;
+    if (hostCount <= 0)
+    {
+        m_inFlightPerHost.remove(job.url.host());
+    }
+
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const bool failed = (status == 0 && reply->error() != QNetworkReply::NoError) || status >= 500;
+
+    DBG_Printf(DBG_INFO, "Webhook finished: %s (code: %d, status: %d)\n", qPrintable(reply->url().toString()), reply->error(), status);
+
+    if (DBG_IsEnabled(DBG_HTTP))
+    {
+        for (const auto &hdr : reply->rawHeaderPairs())
+        {
+            DBG_Printf(DBG_HTTP, "%s: %s\n", qPrintable(hdr.first), qPrintable(hdr.second));
+        }
+
+        QByteArray data = reply->readAll();
+        if (!data.isEmpty())
+        {
+            DBG_Printf(DBG_HTTP, "%s\n", qPrintable(data));
+        }
+    }
+
+    if (m_metrics)
+    {
+        m_metrics->record(QLatin1String("webhook_duration_ms"), m_time.elapsed() - job.sendTime);
+        m_metrics->increment(failed ? QLatin1String("webhook_requests_total{result=\"error\"}")
+                                    : QLatin1String("webhook_requests_total{result=\"ok\"}"));
+    }
+
+    const bool retry = failed && job.retries < MaxRetries && shouldRetry(job, reply, status);
+
+    if (retry && m_queue.size() >= MaxQueueSize) // retries count against the queue limit
+    {
+        DBG_Printf(DBG_INFO, "Webhook queue full, drop retry to %s\n", qPrintable(job.url.toString()));
+        if (m_metrics)
+        {
+            m_metrics->increment(QLatin1String("webhook_dropped_total"));
+        }
+    }
+    else if (retry)
+    {
+        job.notBefore = m_time.elapsed() + (RetryDelay << job.retries);
+        job.retries++;
+        m_queue.push_back(job);
+
+        if (m_metrics)
+        {
+            m_metrics->increment(QLatin1String("webhook_retries_total"));
+        }
+    }
+
+    processQueue();
+}
+
+/*! Returns true if a failed request can be sent again.
+    Requests with idempotent methods are always retried. Others only if the server
+    didn't receive or process them, otherwise e.g. a POST might be executed twice.
+ */
+bool WebhookDispatcher::shouldRetry(const Job &job, const QNetworkReply *reply, int status)
+{
+    if (job.method == "GET" || job.method == "HEAD" || job.method == "PUT" ||
+        job.method == "DELETE" || job.method == "OPTIONS")
+    {
+        return true;
+    }
+
+    if (status == 503) // Service Unavailable
+    {
+        return true;
+    }
+
+    return status == 0 &&
+           (reply->error() == QNetworkReply::ConnectionRefusedError ||
+            reply->error() == QNetworkReply::HostNotFoundError);
+}
+
+/*! Updates the queue depth and in-flight gauges.
+ */
+void WebhookDispatcher::updateGauges()
+{
+    if (m_metrics)
+    {
+        m_metrics->setGauge(QLatin1String("webhook_queue_depth"), qint64(m_queue.size()));
+        m_metrics->setGauge(QLatin1String("webhook_in_flight"), qint64(m_inFlight.size()));
+    }
+}
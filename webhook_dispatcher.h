@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2020 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef WEBHOOK_DISPATCHER_H
+#define WEBHOOK_DISPATCHER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QUrl>
+#include <deque>
+#include <vector>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTimer;
+class Metrics;
+
+/*! \class WebhookDispatcher
+
+    Sends webhook requests of rule actions.
+    The requests are queued and at most MaxInFlight (MaxInFlightPerHost per host)
+    are running at a time, connections to a host are kept alive and reused by
+    the QNetworkAccessManager. Failed requests (network errors and HTTP 5xx)
+    are retried with exponential backoff, requests with non-idempotent methods
+    only if the server didn't get them. With a batch window > 0 the JSON bodies
+    of requests to the same URL within the window are sent as one JSON array.
+ */
+class WebhookDispatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Constants
+    {
+        MaxInFlight = 4,
+        MaxInFlightPerHost = 2,
+        MaxQueueSize = 100,
+        MaxRetries = 3,
+        RetryDelay = 1000 // ms, doubled per retry
+    };
+
+    WebhookDispatcher(QObject *parent = nullptr);
+    void setMetrics(Metrics *metrics) { m_metrics = metrics; }
+    void setBatchWindow(int ms) { m_batchWindow = ms; }
+    bool enqueue(const QUrl &url, const QByteArray &method, const QByteArray &body, const QByteArray &contentType = QByteArray());
+
+private Q_SLOTS:
+    void processQueue();
+    void requestFinished(QNetworkReply *reply);
+
+private:
+    struct Job
+    {
+        QUrl url;
+        QByteArray method;
+        QByteArray contentType;
+        std::vector<QByteArray> bodies;
+        int retries;
+        qint64 notBefore; // m_time.elapsed() based
+        qint64 sendTime;
+    };
+
+    void send(Job &job);
+    static bool shouldRetry(const Job &job, const QNetworkReply *reply, int status);
+    void updateGauges();
+
+    QNetworkAccessManager *m_manager;
+    QTimer *m_timer;
+    QElapsedTimer m_time;
+    std::deque<Job> m_queue;
+    QHash<QNetworkReply*, Job> m_inFlight;
+    QHash<QString, int> m_inFlightPerHost;
+    Metrics *m_metrics;
+    int m_batchWindow;
+};
+
+#endif // WEBHOOK_DISPATCHER_H
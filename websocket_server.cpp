@@ -11,6 +11,7 @@
 #ifdef USE_WEBSOCKETS
 
 #include "deconz/dbg_trace.h"
+#include "metrics.h"
 #include "websocket_server.h"
 
 /*! Constructor.
@@ -112,6 +113,14 @@ void WebSocketServer::onSocketError(QAbstractSocket::SocketError err)
  */
 void WebSocketServer::broadcastTextMessage(const QString &msg)
 {
+    MetricsTimer timer(m_metrics, QLatin1String("websocket_fanout_duration_us"));
+
+    if (m_metrics)
+    {
+        m_metrics->increment(QLatin1String("websocket_messages_total"));
+        m_metrics->setGauge(QLatin1String("websocket_clients"), qint64(clients.size()));
+    }
+
     for (size_t i = 0; i < clients.size(); i++)
     {
         QWebSocket *sock = clients[i];
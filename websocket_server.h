@@ -10,6 +10,7 @@
 
 class QWebSocket;
 class QWebSocketServer;
+class Metrics;
 
 /*! \class WebSocketServer
 
@@ -21,6 +22,7 @@ class WebSocketServer : public QObject
 public:
     explicit WebSocketServer(QObject *parent, quint16 port);
     quint16 port() const;
+    void setMetrics(Metrics *metrics) { m_metrics = metrics; }
 
 signals:
 
@@ -36,6 +38,7 @@ private slots:
 private:
     QWebSocketServer *srv;
     std::vector<QWebSocket*> clients;
+    Metrics *m_metrics = nullptr;
 };
 
 #endif // WEBSOCKET_SERVER_H
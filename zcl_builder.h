@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2020 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef ZCL_BUILDER_H
+#define ZCL_BUILDER_H
+
+#include <QByteArray>
+#include <vector>
+#include <deconz.h>
+
+/*! \class ZclBuilder
+
+    Writes little endian values into a byte array as a lightweight replacement
+    of QDataStream for ZCL payloads. The array is truncated on construction but
+    keeps its reserved capacity, no QBuffer is involved.
+ */
+class ZclBuilder
+{
+public:
+    enum Constants
+    {
+        MinCapacity = 16
+    };
+
+    explicit ZclBuilder(QByteArray &buf) :
+        m_buf(buf)
+    {
+        m_buf.resize(0);
+        if (m_buf.capacity() < MinCapacity)
+        {
+            m_buf.reserve(MinCapacity);
+        }
+    }
+
+    ZclBuilder &operator<<(bool v) { m_buf.append(char(v ? 1 : 0)); return *this; }
+    ZclBuilder &operator<<(quint8 v) { m_buf.append(char(v)); return *this; }
+    ZclBuilder &operator<<(qint8 v) { m_buf.append(char(v)); return *this; }
+    ZclBuilder &operator<<(quint16 v) { append(v, 2); return *this; }
+    ZclBuilder &operator<<(qint16 v) { append(quint16(v), 2); return *this; }
+    ZclBuilder &operator<<(quint32 v) { append(v, 4); return *this; }
+    ZclBuilder &operator<<(qint32 v) { append(quint32(v), 4); return *this; }
+    ZclBuilder &operator<<(quint64 v) { append(v, 8); return *this; }
+    void writeRawData(const char *data, int len) { m_buf.append(data, len); }
+
+private:
+    void append(quint64 v, int n)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            m_buf.append(char((v >> (i * 8)) & 0xff));
+        }
+    }
+
+    QByteArray &m_buf;
+};
+
+/*! \class ZclBufferPool
+
+    Keeps the ASDU buffers of finished tasks for reuse, so that queuing a task
+    for each light of a group or scene doesn't allocate a new buffer per task.
+ */
+class ZclBufferPool
+{
+public:
+    enum Constants
+    {
+        MaxBuffers = 32,
+        BufferSize = 64
+    };
+
+    /*! Replaces \p buf with an empty buffer of at least BufferSize capacity. */
+    void take(QByteArray &buf)
+    {
+        if (!m_free.empty())
+        {
+            buf = std::move(m_free.back());
+            m_free.pop_back();
+            buf.resize(0); // keeps the reserved capacity
+        }
+        else
+        {
+            buf = QByteArray();
+            buf.reserve(BufferSize);
+        }
+    }
+
+    /*! Takes over \p buf if no one else references it, \p buf is empty afterwards. */
+    void release(QByteArray &buf)
+    {
+        if (m_free.size() < MaxBuffers && buf.isDetached() && buf.capacity() >= BufferSize)
+        {
+            m_free.push_back(std::move(buf));
+        }
+        buf = QByteArray();
+    }
+
+private:
+    std::vector<QByteArray> m_free;
+};
+
+/*! Serializes \p frame into \p asdu like ZclFrame::writeToStream().
+ */
+inline void zclFrameToAsdu(const deCONZ::ZclFrame &frame, QByteArray &asdu)
+{
+    ZclBuilder builder(asdu);
+    builder << quint8(frame.frameControl());
+    if (frame.frameControl() & deCONZ::ZclFCManufacturerSpecific)
+    {
+        builder << quint16(frame.manufacturerCode());
+    }
+    builder << quint8(frame.sequenceNumber());
+    builder << quint8(frame.commandId());
+    asdu.append(frame.payload());
+}
+
+#endif // ZCL_BUILDER_H
@@ -26,6 +26,19 @@
 /** @brief Max of A, B, and C */
 #define MAX3(A,B,C)	(((A) >= (B)) ? MAX(A,C) : MAX(B,C))
 
+/*! Serializes the ZCL frame of a task into the ASDU of its request.
+    A buffer of zclBufferPool is used unless the ASDU already has an unshared one.
+ */
+void DeRestPluginPrivate::writeZclFrame(TaskItem &task)
+{
+    QByteArray &asdu = task.req.asdu();
+    if (!asdu.isDetached() || asdu.capacity() < ZclBufferPool::BufferSize)
+    {
+        zclBufferPool.take(asdu);
+    }
+    zclFrameToAsdu(task.zclFrame, asdu);
+}
+
 /*! Add a MoveLevel task to the queue
 
     \param task - the task item
@@ -67,20 +80,14 @@ bool DeRestPluginPrivate::addTaskMoveLevel(TaskItem &task, bool withOnOff, bool
 
     if (rate > 0)
     { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         quint8 direction = upDirection ? 0x00 : 0x01;
         stream << direction;
         stream << rate;
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -117,8 +124,7 @@ bool DeRestPluginPrivate::addTaskSetOnOff(TaskItem &task, quint8 cmd, quint16 on
     if (cmd == ONOFF_COMMAND_ON_WITH_TIMED_OFF)
     {
         const quint16 offWaitTime = 0;
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
         // stream << (quint8)0x80; // 0x01 accept only when on --> no, 0x80 overwrite ontime (yes, non standard)
         stream << flags;
         stream << ontime;
@@ -126,10 +132,7 @@ bool DeRestPluginPrivate::addTaskSetOnOff(TaskItem &task, quint8 cmd, quint16 on
     }
 
 
-    task.req.asdu().clear(); // cleanup old request data if there is any
-    QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-    stream.setByteOrder(QDataStream::LittleEndian);
-    task.zclFrame.writeToStream(stream);
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -165,19 +168,13 @@ bool DeRestPluginPrivate::addTaskSetBrightness(TaskItem &task, uint8_t bri, bool
                              deCONZ::ZclFCDisableDefaultResponse);
 
     { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         stream << task.level;
         stream << task.transitionTime;
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -217,8 +214,7 @@ bool DeRestPluginPrivate::addTaskIncColorTemperature(TaskItem &task, int32_t ct)
         quint8 direction = ct > 0 ? 1 : 3; // up, down
         quint16 stepSize = ct > 0 ? ct : -ct;
 
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         stream << direction;
         stream << stepSize;
@@ -227,12 +223,7 @@ bool DeRestPluginPrivate::addTaskIncColorTemperature(TaskItem &task, int32_t ct)
         stream << (quint16)0; // max dummy
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -269,20 +260,14 @@ bool DeRestPluginPrivate::addTaskIncBrightness(TaskItem &task, int16_t bri)
         quint8 mode = bri > 0 ? 0 : 1; // up, down
         quint8 stepSize = (bri > 0) ? bri : bri * -1;
 
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         stream << mode;
         stream << stepSize;
         stream << task.transitionTime;
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -308,12 +293,7 @@ bool DeRestPluginPrivate::addTaskStopBrightness(TaskItem &task)
                              deCONZ::ZclFCDirectionClientToServer |
                              deCONZ::ZclFCDisableDefaultResponse);
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -330,7 +310,7 @@ bool DeRestPluginPrivate::addTaskSetColorTemperature(TaskItem &task, uint16_t ct
 {
     // Workaround for interim FLS-H
     // which does not support the color temperature ZCL command
-    if (task.lightNode && (task.lightNode->manufacturerCode() == VENDOR_ATMEL) && (task.lightNode->modelId() == "FLS-H"))
+    if (task.lightNode && task.lightNode->capabilities().has(LightCapabilities::CapCtViaSat))
     {
         float ctMin = 153;
         float ctMax = 500;
@@ -358,15 +338,10 @@ bool DeRestPluginPrivate::addTaskSetColorTemperature(TaskItem &task, uint16_t ct
 
     if (task.lightNode)
     {
-        ResourceItem *ctMin = task.lightNode->item(RConfigCtMin);
-        ResourceItem *ctMax = task.lightNode->item(RConfigCtMax);
+        const LightCapabilities &caps = task.lightNode->capabilities();
 
         // keep ct in supported bounds
-        if (ctMin && ctMax && ctMin->toNumber() > 0 && ctMax->toNumber() > 0)
-        {
-            if      (ct < ctMin->toNumber()) { ct = static_cast<quint16>(ctMin->toNumber()); }
-            else if (ct > ctMax->toNumber()) { ct = static_cast<quint16>(ctMax->toNumber()); }
-        }
+        ct = caps.boundedCt(ct);
 
         if (task.lightNode->colorMode() != QLatin1String("ct"))
         {
@@ -375,16 +350,7 @@ bool DeRestPluginPrivate::addTaskSetColorTemperature(TaskItem &task, uint16_t ct
             enqueueEvent(e);
         }
 
-        // If light does not support "ct" but does suport "xy", we can emulate the former:
-        ResourceItem *colorCaps = task.lightNode->item(RConfigColorCapabilities);
-        bool supportsXy = colorCaps && colorCaps->toNumber() & 0x0008;
-        bool supportsCt = colorCaps && colorCaps->toNumber() & 0x0010;
-        bool useXy = supportsXy && !supportsCt;
-        // IKEA lights need to use "xy" because move to color temperature is broken and
-        // won't update x,y values resulting in broken scenes.
-        useXy = useXy || task.lightNode->manufacturerCode() == VENDOR_IKEA;
-
-        if (useXy)
+        if (caps.has(LightCapabilities::CapCtViaXy))
         {
             quint16 x;
             quint16 y;
@@ -415,19 +381,13 @@ bool DeRestPluginPrivate::addTaskSetColorTemperature(TaskItem &task, uint16_t ct
                              deCONZ::ZclFCDisableDefaultResponse);
 
     { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         stream << task.colorTemperature;
         stream << task.transitionTime;
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -478,8 +438,7 @@ bool DeRestPluginPrivate::addTaskSetEnhancedHue(TaskItem &task, uint16_t hue)
                              deCONZ::ZclFCDisableDefaultResponse);
 
     { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         uint8_t direction = 0x00;
         stream << task.enhancedHue;
@@ -487,12 +446,7 @@ bool DeRestPluginPrivate::addTaskSetEnhancedHue(TaskItem &task, uint16_t hue)
         stream << task.transitionTime;
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -536,19 +490,13 @@ bool DeRestPluginPrivate::addTaskSetSaturation(TaskItem &task, uint8_t sat)
                              deCONZ::ZclFCDisableDefaultResponse);
 
     { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         stream << task.sat;
         stream << task.transitionTime;
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -596,20 +544,14 @@ bool DeRestPluginPrivate::addTaskSetHueAndSaturation(TaskItem &task, uint8_t hue
                              deCONZ::ZclFCDisableDefaultResponse);
 
     { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         stream << task.hue;
         stream << task.sat;
         stream << task.transitionTime;
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -765,20 +707,14 @@ bool DeRestPluginPrivate::addTaskSetXyColor(TaskItem &task, double x, double y)
                              deCONZ::ZclFCDisableDefaultResponse);
 
     { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         stream << task.colorX;
         stream << task.colorY;
         stream << task.transitionTime;
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -818,8 +754,7 @@ bool DeRestPluginPrivate::addTaskSetColorLoop(TaskItem &task, bool colorLoopActi
                              deCONZ::ZclFCDisableDefaultResponse);
 
     { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         uint8_t updateFlags = 0x07; // update action 0x1, direction 0x02, time 0x04
         uint8_t action = colorLoopActive ? 0x02 /* activate color loop from current hue */
@@ -835,12 +770,7 @@ bool DeRestPluginPrivate::addTaskSetColorLoop(TaskItem &task, bool colorLoopActi
         stream << startHue;
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -868,18 +798,12 @@ bool DeRestPluginPrivate::addTaskIdentify(TaskItem &task, uint16_t identifyTime)
                              deCONZ::ZclFCDisableDefaultResponse);
 
     { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         stream << task.identifyTime;
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -907,19 +831,13 @@ bool DeRestPluginPrivate::addTaskTriggerEffect(TaskItem &task, uint8_t effectIde
                              deCONZ::ZclFCDisableDefaultResponse);
 
     { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         stream << task.effectIdentifier;
         stream << (uint8_t) 0x00; // default effectVariant
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -951,8 +869,7 @@ bool DeRestPluginPrivate::addTaskWarning(TaskItem &task, uint8_t options, uint16
                              deCONZ::ZclFCDisableDefaultResponse);
 
     { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         stream << task.options;
         stream << task.duration;
@@ -960,12 +877,7 @@ bool DeRestPluginPrivate::addTaskWarning(TaskItem &task, uint8_t options, uint16
         stream << strobe_level;
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -993,20 +905,14 @@ bool DeRestPluginPrivate::addTaskAddToGroup(TaskItem &task, uint16_t groupId)
                              deCONZ::ZclFCDisableDefaultResponse);
 
     { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         stream << task.groupId;
         uint8_t cstrlen = 0;
         stream << cstrlen; // mandatory parameter
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -1034,18 +940,12 @@ bool DeRestPluginPrivate::addTaskViewGroup(TaskItem &task, uint16_t groupId)
                              deCONZ::ZclFCDisableDefaultResponse);
 
     { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         stream << task.groupId;
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -1073,18 +973,12 @@ bool DeRestPluginPrivate::addTaskRemoveFromGroup(TaskItem &task, uint16_t groupI
                              deCONZ::ZclFCDisableDefaultResponse);
 
     { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         stream << task.groupId;
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }
@@ -1112,19 +1006,13 @@ bool DeRestPluginPrivate::addTaskStoreScene(TaskItem &task, uint16_t groupId, ui
                              deCONZ::ZclFCDisableDefaultResponse);
 
     { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         stream << groupId;
         stream << sceneId;
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     DBG_Printf(DBG_INFO, "add store scene task, aps-req-id: %u\n", task.req.id());
     return addTask(task);
@@ -1155,8 +1043,7 @@ bool DeRestPluginPrivate::addTaskAddEmptyScene(TaskItem &task, quint16 groupId,
                                   deCONZ::ZclFCDisableDefaultResponse);
 
     { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         if (transitionTime >= 10)
         {
@@ -1176,12 +1063,7 @@ bool DeRestPluginPrivate::addTaskAddEmptyScene(TaskItem &task, quint16 groupId,
         //stream << i->name;     // name not supported
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     queryTime = queryTime.addSecs(2);
     return addTask(task);
@@ -1235,8 +1117,7 @@ bool DeRestPluginPrivate::addTaskAddScene(TaskItem &task, uint16_t groupId, uint
                                               deCONZ::ZclFCDisableDefaultResponse);
 
                 { // payload
-                    QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-                    stream.setByteOrder(QDataStream::LittleEndian);
+                    ZclBuilder stream(task.zclFrame.payload());
 
                     uint8_t on = (l->on()) ? 0x01 : 0x00;
                     uint16_t tt;
@@ -1360,12 +1241,7 @@ bool DeRestPluginPrivate::addTaskAddScene(TaskItem &task, uint16_t groupId, uint
                     }
                 }
 
-                { // ZCL frame
-                    task.req.asdu().clear(); // cleanup old request data if there is any
-                    QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-                    stream.setByteOrder(QDataStream::LittleEndian);
-                    task.zclFrame.writeToStream(stream);
-                }
+                writeZclFrame(task);
 
                 queryTime = queryTime.addSecs(2);
 
@@ -1400,19 +1276,13 @@ bool DeRestPluginPrivate::addTaskRemoveScene(TaskItem &task, uint16_t groupId, u
                              deCONZ::ZclFCDisableDefaultResponse);
 
     { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ZclBuilder stream(task.zclFrame.payload());
 
         stream << groupId;
         stream << sceneId;
     }
 
-    { // ZCL frame
-        task.req.asdu().clear(); // cleanup old request data if there is any
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
-    }
+    writeZclFrame(task);
 
     return addTask(task);
 }